@@ -1,49 +1,87 @@
 #include "Arduino.h"
 #include "ALB-Communication.h"
 
+// Frames are collected by the Wire receive ISR into a ring
+// and handed to the message handler from the main loop
+byte ALBReceiveRing[ALB_RECEIVE_RING_MESSAGES][ALB_MAX_FRAME_LENGTH];
+unsigned long ALBReceiveRingTime[ALB_RECEIVE_RING_MESSAGES];
+volatile byte ALBReceiveRingFirst = 0;
+volatile byte ALBReceiveRingLast = 0;
 byte ALBMessageCounter = 0;
 byte ALBMessageExpectedLength = 0;
-byte *ALBMessage = NULL;
+byte ALBMessageCRC = 0;
 void (*ALBIncomingMessageHandler)(byte *) = NULL;
 
+volatile unsigned short ALBFramingErrors = 0;
+volatile unsigned short ALBChecksumErrors = 0;
+volatile unsigned short ALBOverruns = 0;
+
+
+byte ALBUpdateCRC(byte crc, byte nextByte) {
+  // CRC-8, polynomial 0x07
+  crc ^= nextByte;
+  for (byte bitCount = 0; bitCount < 8; bitCount++) {
+    if (crc & 0x80) crc = (crc << 1) ^ 0x07;
+    else crc <<= 1;
+  }
+  return crc;
+}
+
 
 void ProcessIncomingData(byte nextByte) {
-  if (ALBMessage==NULL) return;
+  byte *message = ALBReceiveRing[ALBReceiveRingLast];
 
   if (ALBMessageCounter==0) {
-    ALBMessageExpectedLength = 0;
     if (nextByte==ALB_HEADER_BYTE_1) {
-      ALBMessage[ALBMessageCounter] = nextByte;
+      message[ALBMessageCounter] = nextByte;
       ALBMessageCounter += 1;
     }
   } else if (ALBMessageCounter==1) {
     if (nextByte==ALB_HEADER_BYTE_2) {
-      ALBMessage[ALBMessageCounter] = nextByte;
+      message[ALBMessageCounter] = nextByte;
       ALBMessageCounter += 1;
     } else {
-      ALBMessageCounter = 0;
+      ALBMessageCounter = (nextByte==ALB_HEADER_BYTE_1) ? 1 : 0;
     }
   } else if (ALBMessageCounter==2) {
-    ALBMessage[ALBMessageCounter] = nextByte;
-    ALBMessageExpectedLength = ALBMessage[ALBMessageCounter];
+    if (nextByte<(ALB_FRAME_OVERHEAD+1) || nextByte>ALB_MAX_FRAME_LENGTH) {
+      ALBFramingErrors += 1;
+      ALBMessageCounter = 0;
+      return;
+    }
+    message[ALBMessageCounter] = nextByte;
+    ALBMessageExpectedLength = nextByte;
+    ALBMessageCRC = ALBUpdateCRC(0, nextByte);
     ALBMessageCounter += 1;
-  } else if (ALBMessageCounter>2 && ALBMessageCounter<(ALBMessageExpectedLength-1)) {
-    ALBMessage[ALBMessageCounter] = nextByte;
+  } else if (ALBMessageCounter<(ALBMessageExpectedLength-2)) {
+    message[ALBMessageCounter] = nextByte;
+    ALBMessageCRC = ALBUpdateCRC(ALBMessageCRC, nextByte);
     ALBMessageCounter += 1;
-  } else if (ALBMessageCounter==(ALBMessageExpectedLength-1)) {
-    if (nextByte==ALB_END_OF_MESSAGE) {
-      ALBMessage[ALBMessageCounter] = nextByte;
-      ALBMessageCounter += 1;
-      // This is a completed, well-formed message so we can parse it
-      ALBIncomingMessageHandler(ALBMessage);
-    } else {
-      // Something went awry with reception -- start over
+  } else if (ALBMessageCounter==(ALBMessageExpectedLength-2)) {
+    message[ALBMessageCounter] = nextByte;
+    ALBMessageCounter += 1;
+    if (nextByte!=ALBMessageCRC) {
+      ALBChecksumErrors += 1;
+      ALBMessageCounter = 0;
     }
-    ALBMessageCounter = 0;
   } else {
     ALBMessageCounter = 0;
+    if (nextByte!=ALB_END_OF_MESSAGE) {
+      ALBFramingErrors += 1;
+      return;
+    }
+    message[ALBMessageExpectedLength-1] = nextByte;
+
+    // This is a completed, well-formed message - if there's room,
+    // it's kept for ServiceIncomingMessages() to pass on
+    byte nextLast = (ALBReceiveRingLast + 1) % ALB_RECEIVE_RING_MESSAGES;
+    if (nextLast==ALBReceiveRingFirst) {
+      ALBOverruns += 1;
+    } else {
+      ALBReceiveRingTime[ALBReceiveRingLast] = millis();
+      ALBReceiveRingLast = nextLast;
+    }
   }
-    
 }
 
 
@@ -59,12 +97,34 @@ void DataReceive(int numBytes) {
 }
 
 
+byte ALBCommandLength(const byte *command) {
+  switch (command[0]) {
+    case ALB_COMMAND_PLAY_ANIMATION:
+    case ALB_COMMAND_LOOP_ANIMATION:
+    case ALB_COMMAND_STOP_ANIMATION:
+      return 2;
+    case ALB_COMMAND_SET_LAMP_BITMAP:
+      return 2 + command[1];
+    case ALB_COMMAND_SYNC_CLOCK:
+      return 7;
+    case ALB_COMMAND_START_ANIMATION_AT:
+      return 5;
+  }
+  return 1;
+}
+
+
 AccessoryLampBoard::AccessoryLampBoard() {
   m_targetDeviceAddress = 0;
   m_communicationInitialized = false;
-  ALBMessage = NULL;
   ALBIncomingMessageHandler = NULL;
   ALBMessageCounter = 0;
+  m_commandQueueLength = 0;
+  m_sharedFrameDuration = ALB_DEFAULT_FRAME_DURATION;
+  m_lastClockSync = 0;
+  m_clockSynced = false;
+  m_sharedClockOffset = 0;
+  ResetRemoteState();
 }
 
 AccessoryLampBoard::~AccessoryLampBoard() {  
@@ -81,96 +141,234 @@ void AccessoryLampBoard::InitOutogingCommunication() {
 
 void AccessoryLampBoard::InitIncomingCommunication(byte incomingDeviceAddress, void (*incomingMessageHandler)(byte *)) {
   ALBIncomingMessageHandler = incomingMessageHandler;
-  ALBMessage = (byte *)malloc(ALB_MAX_MESSAGE_LENGTH);
-  if (ALBIncomingMessageHandler!=NULL && ALBMessage!=NULL) {
+  if (ALBIncomingMessageHandler!=NULL) {
     m_communicationInitialized = true;
+    ALBReceiveRingFirst = 0;
+    ALBReceiveRingLast = 0;
+    ALBMessageCounter = 0;
     Wire.begin(incomingDeviceAddress);
     Wire.onReceive(DataReceive);
     Wire.onRequest(DataRequest);
-    ALBMessage[0] = ALB_END_OF_MESSAGE;
   }
 }
 
 
-boolean AccessoryLampBoard::EnableLamps() {
+byte AccessoryLampBoard::ServiceIncomingMessages(byte maxMessages) {
+  byte numHandled = 0;
+  while (ALBReceiveRingFirst!=ALBReceiveRingLast && numHandled<maxMessages) {
+    byte *message = ALBReceiveRing[ALBReceiveRingFirst];
+
+    // Clock syncs are applied here (against the time the frame
+    // started arriving), then passed on like any other command
+    byte *command = message + 3;
+    byte *commandsEnd = message + message[2] - 2;
+    if (command[0]==ALB_COMMAND_BATCH) command += 1;
+    while (command<commandsEnd) {
+      byte commandLength = ALBCommandLength(command);
+      if (commandLength==0 || (command + commandLength)>commandsEnd) break;
+      if (command[0]==ALB_COMMAND_SYNC_CLOCK) {
+        // The frame is stamped once it's all in - the address
+        // byte and the frame were on the wire before that
+        unsigned long wireTime = ((unsigned long)(message[2] + 1) * ALB_WIRE_MICROS_PER_BYTE + 500) / 1000;
+        ApplyClockSync(command, ALBReceiveRingTime[ALBReceiveRingFirst] - wireTime);
+      }
+      command += commandLength;
+    }
+
+    // The slot isn't released until the handler is done with
+    // it, so the ISR can't write over it in the meantime
+    if (ALBIncomingMessageHandler!=NULL) ALBIncomingMessageHandler(message);
+    ALBReceiveRingFirst = (ALBReceiveRingFirst + 1) % ALB_RECEIVE_RING_MESSAGES;
+    numHandled += 1;
+  }
+  return numHandled;
+}
+
+
+unsigned short AccessoryLampBoard::GetFramingErrors() {
+  byte oldSREG = SREG;
+  cli();
+  unsigned short numErrors = ALBFramingErrors;
+  SREG = oldSREG;
+  return numErrors;
+}
+
+unsigned short AccessoryLampBoard::GetChecksumErrors() {
+  byte oldSREG = SREG;
+  cli();
+  unsigned short numErrors = ALBChecksumErrors;
+  SREG = oldSREG;
+  return numErrors;
+}
+
+unsigned short AccessoryLampBoard::GetOverruns() {
+  byte oldSREG = SREG;
+  cli();
+  unsigned short numOverruns = ALBOverruns;
+  SREG = oldSREG;
+  return numOverruns;
+}
+
+void AccessoryLampBoard::ResetErrorCounters() {
+  byte oldSREG = SREG;
+  cli();
+  ALBFramingErrors = 0;
+  ALBChecksumErrors = 0;
+  ALBOverruns = 0;
+  SREG = oldSREG;
+}
+
+
+void AccessoryLampBoard::ResetRemoteState() {
+  m_remoteLampsEnabled = ALB_REMOTE_STATE_UNKNOWN;
+  m_remoteBitmapKnown = false;
+  for (byte count = 0; count < (ALB_TRACKED_ANIMATIONS/8); count++) {
+    m_remoteLoopingAnimations[count] = 0;
+    m_remotePlayedAnimations[count] = 0;
+  }
+  m_remoteAnimationsUnknown = true;
+}
+
+
+boolean AccessoryLampBoard::QueueCommand(byte command, byte numArgs, const byte *args) {
   if (!m_communicationInitialized) return false;
 
-  Wire.beginTransmission(m_targetDeviceAddress);
-  Wire.write(ALB_HEADER_BYTE_1);
-  Wire.write(ALB_HEADER_BYTE_2);
-  Wire.write(5); // length of messages
-  Wire.write(ALB_COMMAND_ENABLE_LAMPS);
-  Wire.write(ALB_END_OF_MESSAGE);
-  Wire.endTransmission();
+  // A one-shot animation asked for twice in the same loop is only sent once
+  if (command==ALB_COMMAND_PLAY_ANIMATION) {
+    for (byte offset = 0; offset < m_commandQueueLength; offset += ALBCommandLength(m_commandQueue + offset)) {
+      if (m_commandQueue[offset]==command && m_commandQueue[offset+1]==args[0]) return true;
+    }
+  }
+
+  if ((m_commandQueueLength + 1 + numArgs) > ALB_COMMAND_QUEUE_LENGTH) {
+    if (!SendQueuedCommands()) return false;
+  }
+
+  m_commandQueue[m_commandQueueLength++] = command;
+  for (byte count = 0; count < numArgs; count++) m_commandQueue[m_commandQueueLength++] = args[count];
   return true;
 }
 
 
-boolean AccessoryLampBoard::DisableLamps() {
-  if (!m_communicationInitialized) return false;
+boolean AccessoryLampBoard::SendFrame(byte *commands, byte length, boolean batch) {
+  // Clock syncs carry the time they actually go out
+  for (byte offset = 0; offset < length; offset += ALBCommandLength(commands + offset)) {
+    if (commands[offset]==ALB_COMMAND_SYNC_CLOCK) {
+      unsigned long sharedTime = millis();
+      for (byte count = 0; count < 4; count++) commands[offset + 1 + count] = (byte)(sharedTime >> (8*count));
+    }
+  }
+
+  byte frameLength = ALB_FRAME_OVERHEAD + length + (batch ? 1 : 0);
+  byte crc = ALBUpdateCRC(0, frameLength);
+  if (batch) crc = ALBUpdateCRC(crc, ALB_COMMAND_BATCH);
+  for (byte count = 0; count < length; count++) crc = ALBUpdateCRC(crc, commands[count]);
 
   Wire.beginTransmission(m_targetDeviceAddress);
   Wire.write(ALB_HEADER_BYTE_1);
   Wire.write(ALB_HEADER_BYTE_2);
-  Wire.write(5); // length of messages
-  Wire.write(ALB_COMMAND_DISABLE_LAMPS);
+  Wire.write(frameLength); // length of message
+  if (batch) Wire.write(ALB_COMMAND_BATCH);
+  Wire.write(commands, length);
+  Wire.write(crc);
   Wire.write(ALB_END_OF_MESSAGE);
-  Wire.endTransmission();
+  return (Wire.endTransmission()==0);
+}
+
+
+boolean AccessoryLampBoard::SendQueuedCommands() {
+  if (!m_communicationInitialized) return false;
+  if (m_commandQueueLength==0) return true;
+
+  boolean allSent = true;
+  byte frameStart = 0;
+  byte frameLength = 0;
+  byte frameCommands = 0;
+
+  for (byte offset = 0; offset < m_commandQueueLength; ) {
+    byte commandLength = ALBCommandLength(m_commandQueue + offset);
+    if (frameCommands && (frameLength + commandLength) > (ALB_MAX_FRAME_LENGTH - ALB_FRAME_OVERHEAD - 1)) {
+      if (!SendFrame(m_commandQueue + frameStart, frameLength, frameCommands>1)) allSent = false;
+      frameStart = offset;
+      frameLength = 0;
+      frameCommands = 0;
+    }
+    frameLength += commandLength;
+    frameCommands += 1;
+    offset += commandLength;
+  }
+  if (frameCommands && !SendFrame(m_commandQueue + frameStart, frameLength, frameCommands>1)) allSent = false;
+
+  m_commandQueueLength = 0;
+
+  // If anything was lost, our idea of the remote
+  // board can't be trusted any more
+  if (!allSent) ResetRemoteState();
+  return allSent;
+}
+
+
+boolean AccessoryLampBoard::EnableLamps() {
+  if (m_remoteLampsEnabled==ALB_REMOTE_STATE_ON) return true;
+  if (!QueueCommand(ALB_COMMAND_ENABLE_LAMPS)) return false;
+  m_remoteLampsEnabled = ALB_REMOTE_STATE_ON;
   return true;
 }
 
 
+boolean AccessoryLampBoard::DisableLamps() {
+  if (m_remoteLampsEnabled==ALB_REMOTE_STATE_OFF) return true;
+  if (!QueueCommand(ALB_COMMAND_DISABLE_LAMPS)) return false;
+  m_remoteLampsEnabled = ALB_REMOTE_STATE_OFF;
+  return true;
+}
 
-boolean AccessoryLampBoard::PlayAnimation(byte animationNum) {
-  if (!m_communicationInitialized) return false;
 
-  Wire.beginTransmission(m_targetDeviceAddress);
-  Wire.write(ALB_HEADER_BYTE_1);
-  Wire.write(ALB_HEADER_BYTE_2);
-  Wire.write(6); // length of messages
-  Wire.write(ALB_COMMAND_PLAY_ANIMATION);
-  Wire.write(animationNum);
-  Wire.write(ALB_END_OF_MESSAGE);
-  Wire.endTransmission();
 
+boolean AccessoryLampBoard::PlayAnimation(byte animationNum) {
+  // We can't tell when a one-shot animation finishes,
+  // so these are always sent
+  if (!QueueCommand(ALB_COMMAND_PLAY_ANIMATION, 1, &animationNum)) return false;
+  if (animationNum < ALB_TRACKED_ANIMATIONS) m_remotePlayedAnimations[animationNum/8] |= (0x01 << (animationNum % 8));
+  else m_remoteAnimationsUnknown = true;
   return true;
 }
 
 boolean AccessoryLampBoard::LoopAnimation(byte animationNum) {
-  if (!m_communicationInitialized) return false;
+  boolean tracked = (animationNum < ALB_TRACKED_ANIMATIONS);
+  byte animationBit = 0x01 << (animationNum % 8);
+  if (tracked && (m_remoteLoopingAnimations[animationNum/8] & animationBit)) return true;
 
-  Wire.beginTransmission(m_targetDeviceAddress);
-  Wire.write(ALB_HEADER_BYTE_1);
-  Wire.write(ALB_HEADER_BYTE_2);
-  Wire.write(6); // length of messages
-  Wire.write(ALB_COMMAND_LOOP_ANIMATION);
-  Wire.write(animationNum);
-  Wire.write(ALB_END_OF_MESSAGE);
-  Wire.endTransmission();
-  
+  if (!QueueCommand(ALB_COMMAND_LOOP_ANIMATION, 1, &animationNum)) return false;
+  if (tracked) m_remoteLoopingAnimations[animationNum/8] |= animationBit;
+  else m_remoteAnimationsUnknown = true;
   return true;
 }
 
 boolean AccessoryLampBoard::StopAnimation(byte animationNum) {
-  if (!m_communicationInitialized) return false;
-
   if (animationNum==ALB_ALL_ANIMATIONS) {
-    Wire.beginTransmission(m_targetDeviceAddress);
-    Wire.write(ALB_HEADER_BYTE_1);
-    Wire.write(ALB_HEADER_BYTE_2);
-    Wire.write(5); // length of messages
-    Wire.write(ALB_COMMAND_STOP_ALL_ANIMATIONS);
-    Wire.write(ALB_END_OF_MESSAGE);
-    Wire.endTransmission();
+    boolean anyRunning = m_remoteAnimationsUnknown;
+    for (byte count = 0; count < (ALB_TRACKED_ANIMATIONS/8); count++) {
+      if (m_remoteLoopingAnimations[count] || m_remotePlayedAnimations[count]) anyRunning = true;
+    }
+    if (!anyRunning) return true;
+
+    if (!QueueCommand(ALB_COMMAND_STOP_ALL_ANIMATIONS)) return false;
+    for (byte count = 0; count < (ALB_TRACKED_ANIMATIONS/8); count++) {
+      m_remoteLoopingAnimations[count] = 0;
+      m_remotePlayedAnimations[count] = 0;
+    }
+    m_remoteAnimationsUnknown = false;
   } else {
-    Wire.beginTransmission(m_targetDeviceAddress);
-    Wire.write(ALB_HEADER_BYTE_1);
-    Wire.write(ALB_HEADER_BYTE_2);
-    Wire.write(6); // length of messages
-    Wire.write(ALB_COMMAND_STOP_ANIMATION);
-    Wire.write(animationNum);
-    Wire.write(ALB_END_OF_MESSAGE);
-    Wire.endTransmission();
+    boolean tracked = (animationNum < ALB_TRACKED_ANIMATIONS);
+    byte animationBit = 0x01 << (animationNum % 8);
+    if (tracked && !m_remoteAnimationsUnknown && !((m_remoteLoopingAnimations[animationNum/8] | m_remotePlayedAnimations[animationNum/8]) & animationBit)) return true;
+
+    if (!QueueCommand(ALB_COMMAND_STOP_ANIMATION, 1, &animationNum)) return false;
+    if (tracked) {
+      m_remoteLoopingAnimations[animationNum/8] &= ~animationBit;
+      m_remotePlayedAnimations[animationNum/8] &= ~animationBit;
+    }
   }
 
   return true;
@@ -179,15 +377,107 @@ boolean AccessoryLampBoard::StopAnimation(byte animationNum) {
 
 
 boolean AccessoryLampBoard::AllLampsOff() {
-  if (!m_communicationInitialized) return false;
+  if (m_remoteBitmapKnown) {
+    boolean anyLampOn = false;
+    for (byte count = 0; count < ALB_LAMP_BITMAP_BYTES; count++) {
+      if (m_remoteLampBitmap[count]) anyLampOn = true;
+    }
+    if (!anyLampOn) return true;
+  }
 
-  Wire.beginTransmission(m_targetDeviceAddress);
-  Wire.write(ALB_HEADER_BYTE_1);
-  Wire.write(ALB_HEADER_BYTE_2);
-  Wire.write(5); // length of messages
-  Wire.write(ALB_COMMAND_ALL_LAMPS_OFF);
-  Wire.write(ALB_END_OF_MESSAGE);
-  Wire.endTransmission();
-  
+  if (!QueueCommand(ALB_COMMAND_ALL_LAMPS_OFF)) return false;
+  for (byte count = 0; count < ALB_LAMP_BITMAP_BYTES; count++) m_remoteLampBitmap[count] = 0;
+  m_remoteBitmapKnown = true;
   return true;
 }
+
+
+boolean AccessoryLampBoard::SetLampBitmap(const byte *lampBitmap) {
+  if (m_remoteBitmapKnown) {
+    boolean changed = false;
+    for (byte count = 0; count < ALB_LAMP_BITMAP_BYTES; count++) {
+      if (m_remoteLampBitmap[count]!=lampBitmap[count]) changed = true;
+    }
+    if (!changed) return true;
+  }
+
+  byte args[1 + ALB_LAMP_BITMAP_BYTES];
+  args[0] = ALB_LAMP_BITMAP_BYTES;
+  for (byte count = 0; count < ALB_LAMP_BITMAP_BYTES; count++) args[1+count] = lampBitmap[count];
+  if (!QueueCommand(ALB_COMMAND_SET_LAMP_BITMAP, sizeof(args), args)) return false;
+
+  for (byte count = 0; count < ALB_LAMP_BITMAP_BYTES; count++) m_remoteLampBitmap[count] = lampBitmap[count];
+  m_remoteBitmapKnown = true;
+  return true;
+}
+
+
+
+boolean AccessoryLampBoard::SyncClock(unsigned short frameDuration) {
+  if (frameDuration==0) frameDuration = ALB_DEFAULT_FRAME_DURATION;
+  m_sharedFrameDuration = frameDuration;
+
+  // The time is filled in by SendFrame()
+  byte args[6] = {0, 0, 0, 0, (byte)(frameDuration & 0xFF), (byte)(frameDuration >> 8)};
+  if (!QueueCommand(ALB_COMMAND_SYNC_CLOCK, sizeof(args), args)) return false;
+  m_lastClockSync = millis();
+  return true;
+}
+
+
+boolean AccessoryLampBoard::UpdateClockSync(unsigned long currentTime) {
+  if (m_lastClockSync && (currentTime - m_lastClockSync) < ALB_CLOCK_SYNC_INTERVAL) return true;
+  return SyncClock(m_sharedFrameDuration);
+}
+
+
+unsigned short AccessoryLampBoard::GetSharedFrame(unsigned long currentTime) {
+  return (unsigned short)(currentTime / m_sharedFrameDuration);
+}
+
+
+boolean AccessoryLampBoard::PlayAnimationAtFrame(byte animationNum, unsigned short startFrame, boolean loop) {
+  byte args[4] = {animationNum, (byte)(loop ? ALB_START_ANIMATION_LOOP : 0), (byte)(startFrame & 0xFF), (byte)(startFrame >> 8)};
+  if (!QueueCommand(ALB_COMMAND_START_ANIMATION_AT, sizeof(args), args)) return false;
+
+  if (animationNum < ALB_TRACKED_ANIMATIONS) {
+    byte animationBit = 0x01 << (animationNum % 8);
+    if (loop) m_remoteLoopingAnimations[animationNum/8] |= animationBit;
+    else m_remotePlayedAnimations[animationNum/8] |= animationBit;
+  } else {
+    m_remoteAnimationsUnknown = true;
+  }
+  return true;
+}
+
+
+void AccessoryLampBoard::ApplyClockSync(const byte *message, unsigned long receivedTime) {
+  unsigned long sharedTime = 0;
+  for (byte count = 0; count < 4; count++) sharedTime |= ((unsigned long)message[1 + count]) << (8*count);
+  unsigned short frameDuration = message[5] | (((unsigned short)message[6]) << 8);
+
+  m_sharedClockOffset = sharedTime - receivedTime;
+  if (frameDuration) m_sharedFrameDuration = frameDuration;
+  m_clockSynced = true;
+}
+
+
+boolean AccessoryLampBoard::IsClockSynced() {
+  return m_clockSynced;
+}
+
+
+unsigned long AccessoryLampBoard::GetSharedTime() {
+  return millis() + m_sharedClockOffset;
+}
+
+
+unsigned short AccessoryLampBoard::GetSharedFrame() {
+  return GetSharedFrame(GetSharedTime());
+}
+
+
+boolean AccessoryLampBoard::SharedFrameReached(unsigned short frame) {
+  // Frame numbers wrap, so compare the difference
+  return ((short)(GetSharedFrame() - frame) >= 0);
+}
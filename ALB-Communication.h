@@ -6,7 +6,6 @@
 #define ALB_HEADER_BYTE_2	0xBB
 #define ALB_END_OF_MESSAGE	0x55
 
-#define ALB_MAX_MESSAGE_LENGTH  250
 
 #define ALB_COMMAND_GET_ACCESSORY_ID      0
 #define ALB_COMMAND_ENABLE_LAMPS          1
@@ -15,10 +14,75 @@
 #define ALB_COMMAND_LOOP_ANIMATION        4
 #define ALB_COMMAND_STOP_ANIMATION        5
 #define ALB_COMMAND_STOP_ALL_ANIMATIONS   6
+#define ALB_COMMAND_BATCH                 7
+#define ALB_COMMAND_SET_LAMP_BITMAP       8
+#define ALB_COMMAND_SYNC_CLOCK            9
+#define ALB_COMMAND_START_ANIMATION_AT    10
 #define ALB_COMMAND_ALL_LAMPS_OFF         99
 
 #define ALB_ALL_ANIMATIONS                0xFF
 
+// Frame:  header, header, length, command, [args], crc, end
+// The length counts every byte of the frame. The crc is a CRC-8
+// (polynomial 0x07, starting from 0) of the length byte through
+// the last byte before the crc.
+//
+// Commands issued during a loop are queued and sent together by
+// SendQueuedCommands(). A frame with more than one command is sent as:
+//   header, header, length, ALB_COMMAND_BATCH, command, [args], command, [args]..., crc, end
+// Each command's length can be worked out with ALBCommandLength().
+//
+// The AVR Wire library can only send 32 bytes per transmission, so
+// a long queue is split into several frames (at command boundaries).
+#define ALB_MAX_FRAME_LENGTH              32
+#define ALB_FRAME_OVERHEAD                5   // 2 header bytes, length, crc, end
+#define ALB_COMMAND_QUEUE_LENGTH          48
+
+// ALB_COMMAND_SET_LAMP_BITMAP, numBytes, bitmap[numBytes]
+// (lamp 0 is bit 0 of the first byte). Animations play over
+// the bitmap, so they don't change what's tracked for it.
+#define ALB_LAMP_BITMAP_BYTES             8
+
+// Animations below this number are tracked so repeated
+// LoopAnimation / StopAnimation calls aren't sent
+#define ALB_TRACKED_ANIMATIONS            32
+
+// Both boards keep a shared clock (the main board's millis) so
+// animations can be started on the same frame on each side.
+//   ALB_COMMAND_SYNC_CLOCK, sharedTime[4], frameDuration[2]
+//   ALB_COMMAND_START_ANIMATION_AT, animationNum, flags, startFrame[2]
+// (little-endian). The shared frame is sharedTime/frameDuration,
+// truncated to 16 bits. The sync time is stamped just before the
+// frame goes out, and the receiver notes when the whole frame has
+// arrived. The frame's time on the wire (about 3 ms for a full frame
+// at the 100 kHz Wire default) is taken off the arrival time so it
+// doesn't put the receiver's clock behind. With the frame duration
+// set to the ShowLampAnimation() divisor, the shared frame modulo the
+// animation length is the playfield animation's step, but only until
+// the 16-bit frame wraps (65536 frames, about 55 minutes at 50 ms):
+// 65536 isn't a multiple of the 24-step cycle, so after a wrap the
+// two are out of step. Start frames are only compared with other
+// shared frames (see SharedFrameReached()), which is safe across it.
+#define ALB_START_ANIMATION_LOOP          0x01
+// Start, 8 data bits and an ack per byte at 100 kHz
+#define ALB_WIRE_MICROS_PER_BYTE          90
+#define ALB_DEFAULT_FRAME_DURATION        50
+// The clocks drift apart by a few ms a minute, so the
+// sync is resent this often by UpdateClockSync()
+#define ALB_CLOCK_SYNC_INTERVAL           10000
+
+#define ALB_REMOTE_STATE_UNKNOWN          0
+#define ALB_REMOTE_STATE_OFF              1
+#define ALB_REMOTE_STATE_ON               2
+
+// Received frames wait in a ring (filled by the Wire ISR) until
+// ServiceIncomingMessages() passes them to the handler. One slot
+// is always being received into, so the ring holds one less than
+// this. If it's full, new frames are dropped and counted as overruns.
+#define ALB_RECEIVE_RING_MESSAGES         4
+
+byte ALBCommandLength(const byte *command);
+
 class AccessoryLampBoard {
 
   public:
@@ -28,6 +92,13 @@ class AccessoryLampBoard {
     void InitOutogingCommunication();
     void SetTargetDeviceAddress(byte targetDeviceAddress);
     void InitIncomingCommunication(byte incomingDeviceAddress, void (*incomingMessageHandler)(byte *));
+    // Call from the main loop - the handler is
+    // never called from the interrupt
+    byte ServiceIncomingMessages(byte maxMessages = ALB_RECEIVE_RING_MESSAGES);
+    unsigned short GetFramingErrors();
+    unsigned short GetChecksumErrors();
+    unsigned short GetOverruns();
+    void ResetErrorCounters();
 
     boolean EnableLamps();
     boolean DisableLamps();
@@ -35,11 +106,51 @@ class AccessoryLampBoard {
     boolean LoopAnimation(byte animationNum);
     boolean StopAnimation(byte animationNum = ALB_ALL_ANIMATIONS);
     boolean AllLampsOff();
+    boolean SetLampBitmap(const byte *lampBitmap);
+
+    // Shared frame clock (sending side)
+    boolean SyncClock(unsigned short frameDuration = ALB_DEFAULT_FRAME_DURATION);
+    boolean UpdateClockSync(unsigned long currentTime);
+    unsigned short GetSharedFrame(unsigned long currentTime);
+    boolean PlayAnimationAtFrame(byte animationNum, unsigned short startFrame, boolean loop = false);
+
+    // Shared frame clock (receiving side) - synced by
+    // ServiceIncomingMessages() when a sync command arrives
+    boolean IsClockSynced();
+    unsigned long GetSharedTime();
+    unsigned short GetSharedFrame();
+    boolean SharedFrameReached(unsigned short frame);
+
+    // Call once per loop to send whatever was queued
+    boolean SendQueuedCommands();
+    // Forget what the remote board is showing (after it resets)
+    // so the next commands are all sent
+    void ResetRemoteState();
 
   private:
+    boolean   QueueCommand(byte command, byte numArgs = 0, const byte *args = NULL);
+    boolean   SendFrame(byte *commands, byte length, boolean batch);
+    void      ApplyClockSync(const byte *message, unsigned long receivedTime);
 
     byte      m_targetDeviceAddress;
     boolean   m_communicationInitialized;
+
+    byte      m_commandQueue[ALB_COMMAND_QUEUE_LENGTH];
+    byte      m_commandQueueLength;
+
+    // What the remote board will be showing once the queue is sent
+    byte      m_remoteLampsEnabled;
+    boolean   m_remoteBitmapKnown;
+    byte      m_remoteLampBitmap[ALB_LAMP_BITMAP_BYTES];
+    byte      m_remoteLoopingAnimations[ALB_TRACKED_ANIMATIONS/8];
+    // One-shots that were started and may still be playing
+    byte      m_remotePlayedAnimations[ALB_TRACKED_ANIMATIONS/8];
+    boolean   m_remoteAnimationsUnknown;
+
+    unsigned short  m_sharedFrameDuration;
+    unsigned long   m_lastClockSync;
+    boolean         m_clockSynced;
+    unsigned long   m_sharedClockOffset;
 };
 
 
@@ -7,11 +7,19 @@
    * it adds a bunch of audio management features:
    * 
    *   1) Different volume controls for FX, callouts, and music
-   *   2) Automatically ducks music behind callouts
-   *   3) Supports background soundtracks or looping songs
+   *   2) Automatically ducks music behind callouts (each bus has
+   *      one gain envelope, so overlapping ducks never fight)
+   *   3) Supports background soundtracks (shuffled, weighted,
+   *      per-mode playlists with the next song pre-loaded) or
+   *      looping songs
    *   4) A sound can be queued to play at a future time
    *   5) Callouts can be given different priorities
    *   6) Queued callouts at the same priority will be stacked
+   *   7) Higher priority callouts interrupt lower ones, identical
+   *      pending callouts are merged, and stale callouts expire
+   *   8) Track lengths are learned from WAV Trigger reports (Rev 4+)
+   *      and saved to EEPROM so callouts and soundtracks can be
+   *      timed without hand-entered lengths
  *   
  *   
  * Typical usage:
@@ -45,6 +53,7 @@
 
 #include <Arduino.h>
 #include "AudioHandler.h"
+#include "SerialChannels.h"
 
 
 #if defined(RPU_OS_USE_WAV_TRIGGER) || defined(RPU_OS_USE_WAV_TRIGGER_1p3)
@@ -55,6 +64,7 @@ uint8_t txbuf[5];
 
   versionRcvd = false;
   sysinfoRcvd = false;
+  resetTrafficStats();
   WTSerial.begin(57600);
   flush();
 
@@ -64,7 +74,7 @@ uint8_t txbuf[5];
   txbuf[2] = 0x05;
   txbuf[3] = CMD_GET_VERSION;
   txbuf[4] = EOM;
-  WTSerial.write(txbuf, 5);
+  sendFrame(txbuf, 5);
 
   // Request system info
   txbuf[0] = SOM1;
@@ -72,7 +82,31 @@ uint8_t txbuf[5];
   txbuf[2] = 0x05;
   txbuf[3] = CMD_GET_SYS_INFO;
   txbuf[4] = EOM;
-  WTSerial.write(txbuf, 5);
+  sendFrame(txbuf, 5);
+}
+
+// **************************************************************
+void wavTrigger::sendFrame(uint8_t *txbuf, uint8_t len) {
+
+  txBytes += len;
+  txFrames += 1;
+  WTSerial.write(txbuf, len);
+}
+
+// **************************************************************
+void wavTrigger::getTrafficStats(uint32_t *bytesSent, uint32_t *framesSent, uint32_t *reportsReceived) {
+
+  *bytesSent = txBytes;
+  *framesSent = txFrames;
+  *reportsReceived = rxReports;
+}
+
+// **************************************************************
+void wavTrigger::resetTrafficStats(void) {
+
+  txBytes = 0;
+  txFrames = 0;
+  rxReports = 0;
 }
 
 // **************************************************************
@@ -86,7 +120,11 @@ int i;
   rxMsgReady = false;
   for (i = 0; i < MAX_NUM_VOICES; i++) {
     voiceTable[i] = 0xffff;
+    voiceStartTime[i] = 0;
   }
+  voiceAbandoned = 0;
+  finishedFirst = 0;
+  finishedLast = 0;
   while(WTSerial.available())
     /*dat = */WTSerial.read();
 }
@@ -144,6 +182,7 @@ uint16_t track;
     }
 
     if (rxMsgReady) {
+      rxReports++;
       switch (rxMessage[0]) {
 
         case RSP_TRACK_REPORT:
@@ -152,11 +191,24 @@ uint16_t track;
           voice = rxMessage[3];
           if (voice < MAX_NUM_VOICES) {
             if (rxMessage[4] == 0) {
-              if (track == voiceTable[voice])
+              if (track == voiceTable[voice]) {
                 voiceTable[voice] = 0xffff;
+                // Only a track that ran to its natural end tells us its length
+                if (!(voiceAbandoned & (1<<voice))) {
+                  uint8_t nextLast = (finishedLast+1) % FINISHED_TRACK_QUEUE_SIZE;
+                  if (nextLast!=finishedFirst) {
+                    finishedTracks[finishedLast] = track;
+                    finishedTrackLengths[finishedLast] = millis() - voiceStartTime[voice];
+                    finishedLast = nextLast;
+                  }
+                }
+              }
             }
-            else
+            else {
               voiceTable[voice] = track;
+              voiceStartTime[voice] = millis();
+              voiceAbandoned &= ~(1<<voice);
+            }
           }
           // ==========================
           //Serial.print("Track ");
@@ -201,6 +253,28 @@ uint16_t track;
   
 }
 
+// **************************************************************
+bool wavTrigger::getFinishedTrack(uint16_t *trk, uint32_t *msPlayed) {
+
+  if (finishedFirst==finishedLast) return false;
+  *trk = finishedTracks[finishedFirst];
+  *msPlayed = finishedTrackLengths[finishedFirst];
+  finishedFirst = (finishedFirst+1) % FINISHED_TRACK_QUEUE_SIZE;
+  return true;
+}
+
+// **************************************************************
+void wavTrigger::abandonTrack(int trk) {
+
+int i;
+
+  // A track we stop, fade out or loop won't report its true length
+  for (i = 0; i < MAX_NUM_VOICES; i++) {
+    if (trk<0 || voiceTable[i] == ((uint16_t)trk))
+      voiceAbandoned |= (1<<i);
+  }
+}
+
 // **************************************************************
 bool wavTrigger::isTrackPlaying(int trk) {
 
@@ -238,7 +312,7 @@ unsigned short vol;
   txbuf[4] = (uint8_t)vol;
   txbuf[5] = (uint8_t)(vol >> 8);
   txbuf[6] = EOM;
-  WTSerial.write(txbuf, 7);
+  sendFrame(txbuf, 7);
 }
 
 // **************************************************************
@@ -252,7 +326,7 @@ uint8_t txbuf[6];
     txbuf[3] = CMD_AMP_POWER;
     txbuf[4] = enable;
     txbuf[5] = EOM;
-    WTSerial.write(txbuf, 6);
+    sendFrame(txbuf, 6);
 }
 
 // **************************************************************
@@ -266,7 +340,7 @@ uint8_t txbuf[6];
   txbuf[3] = CMD_SET_REPORTING;
   txbuf[4] = enable;
   txbuf[5] = EOM;
-  WTSerial.write(txbuf, 6);
+  sendFrame(txbuf, 6);
 }
 
 // **************************************************************
@@ -361,6 +435,8 @@ void wavTrigger::trackControl(int trk, int code) {
   
 uint8_t txbuf[8];
 
+  if (code==TRK_STOP || code==TRK_LOOP_ON) abandonTrack(trk);
+
   txbuf[0] = SOM1;
   txbuf[1] = SOM2;
   txbuf[2] = 0x08;
@@ -369,7 +445,7 @@ uint8_t txbuf[8];
   txbuf[5] = (uint8_t)trk;
   txbuf[6] = (uint8_t)(trk >> 8);
   txbuf[7] = EOM;
-  WTSerial.write(txbuf, 8);
+  sendFrame(txbuf, 8);
 }
 
 // **************************************************************
@@ -377,6 +453,8 @@ void wavTrigger::trackControl(int trk, int code, bool lock) {
   
 uint8_t txbuf[9];
 
+  if (code==TRK_STOP || code==TRK_LOOP_ON) abandonTrack(trk);
+
   txbuf[0] = SOM1;
   txbuf[1] = SOM2;
   txbuf[2] = 0x09;
@@ -386,19 +464,21 @@ uint8_t txbuf[9];
   txbuf[6] = (uint8_t)(trk >> 8);
   txbuf[7] = lock;
   txbuf[8] = EOM;
-  WTSerial.write(txbuf, 9);
+  sendFrame(txbuf, 9);
 }
 
 // **************************************************************
 void wavTrigger::stopAllTracks(void) {
 
 uint8_t txbuf[5];
+
+  abandonTrack(-1);
   txbuf[0] = SOM1;
   txbuf[1] = SOM2;
   txbuf[2] = 0x05;
   txbuf[3] = CMD_STOP_ALL;
   txbuf[4] = EOM;
-  WTSerial.write(txbuf, 5);
+  sendFrame(txbuf, 5);
 }
 
 // **************************************************************
@@ -411,7 +491,7 @@ uint8_t txbuf[5];
   txbuf[2] = 0x05;
   txbuf[3] = CMD_RESUME_ALL_SYNC;
   txbuf[4] = EOM;
-  WTSerial.write(txbuf, 5);
+  sendFrame(txbuf, 5);
 }
 
 // **************************************************************
@@ -430,7 +510,7 @@ unsigned short vol;
   txbuf[6] = (uint8_t)vol;
   txbuf[7] = (uint8_t)(vol >> 8);
   txbuf[8] = EOM;
-  WTSerial.write(txbuf, 9);
+  sendFrame(txbuf, 9);
 }
 
 // **************************************************************
@@ -439,6 +519,8 @@ void wavTrigger::trackFade(int trk, int gain, int time, bool stopFlag) {
 uint8_t txbuf[12];
 unsigned short vol;
 
+  if (stopFlag) abandonTrack(trk);
+
   txbuf[0] = SOM1;
   txbuf[1] = SOM2;
   txbuf[2] = 0x0c;
@@ -452,7 +534,7 @@ unsigned short vol;
   txbuf[9] = (uint8_t)(time >> 8);
   txbuf[10] = stopFlag;
   txbuf[11] = EOM;
-  WTSerial.write(txbuf, 12);
+  sendFrame(txbuf, 12);
 }
 
 // **************************************************************
@@ -469,7 +551,7 @@ unsigned short off;
   txbuf[4] = (uint8_t)off;
   txbuf[5] = (uint8_t)(off >> 8);
   txbuf[6] = EOM;
-  WTSerial.write(txbuf, 7);
+  sendFrame(txbuf, 7);
 }
 
 // **************************************************************
@@ -483,7 +565,7 @@ uint8_t txbuf[6];
   txbuf[3] = CMD_SET_TRIGGER_BANK;
   txbuf[4] = (uint8_t)bank;
   txbuf[5] = EOM;
-  WTSerial.write(txbuf, 6);
+  sendFrame(txbuf, 6);
 }
 
 #endif
@@ -493,9 +575,14 @@ uint8_t txbuf[6];
 AudioHandler::AudioHandler() {
   curSoundtrack = NULL;
   curSoundtrackEntries = 0;
-  soundFXGain = 0;
-  notificationsGain = 0;
-  musicGain = 0;
+  for (byte bus=0; bus<AUDIO_NUM_BUSES; bus++) {
+    busGain[bus] = 0;
+    busAppliedGain[bus] = 0;
+    busDuckReasons[bus] = 0;
+    for (byte reason=0; reason<AUDIO_NUM_DUCK_REASONS; reason++) busDuckAmount[bus][reason] = 0;
+  }
+  busDuckAmount[AUDIO_BUS_MUSIC][AUDIO_DUCK_REASON_NOTIFICATION] = 20;
+  busDuckAmount[AUDIO_BUS_SOUND_FX][AUDIO_DUCK_REASON_NOTIFICATION] = 20;
   ClearSoundQueue();
   ClearSoundCardQueue();
   ClearNotificationStack();
@@ -503,17 +590,30 @@ AudioHandler::AudioHandler() {
   musicStopped = true;
   soundtrackRandomOrder = true;
   nextSoundtrackPlayTime = 0;
+  backgroundSongStartTime = 0;
   backgroundSongEndTime = 0;
+  trafficStatsStartTime = 0;
   nextVoiceNotificationPlayTime = 0;
+  trackLengthNextEviction = 0;
+  for (byte count=0; count<TRACK_LENGTH_INDEX_SIZE; count++) {
+    trackLengthIndex[count].trackIndex = INVALID_SOUND_INDEX;
+    trackLengthIndex[count].lengthTenths = 0;
+  }
   
-  voiceNotificationStackFirst = 0;
-  voiceNotificationStackLast = 0;
+  nextVoiceNotificationSequence = 0;
   currentNotificationPriority = 0;
   currentNotificationPlaying = INVALID_SOUND_INDEX;
-  musicDucking = 20;
-  soundFXDucking = 20;
 
-  for (int count=0; count<NUMBER_OF_SONGS_REMEMBERED; count++) lastSongsPlayed[count] = BACKGROUND_TRACK_NONE;
+  soundtrackBagSize = 0;
+  soundtrackBagPosition = 0;
+  lastSoundtrackEntry = SOUNDTRACK_ENTRY_NONE;
+  prearmedSoundtrackEntry = SOUNDTRACK_ENTRY_NONE;
+  currentPlaylistSlot = 0;
+  soundtrackPlayedMask = 0;
+  for (byte count=0; count<SOUNDTRACK_NUM_PLAYLISTS; count++) {
+    playlistArray[count] = NULL;
+    playlistPlayedMask[count] = 0;
+  }
 
   InitSoundEffectQueue();
 }
@@ -533,6 +633,7 @@ boolean AudioHandler::InitDevices(byte audioType) {
     wTrig.stopAllTracks();
     wTrig.samplerateOffset(0);
     wTrig.setReporting(true);
+    LoadTrackLengthIndex();
   }
 #endif
 
@@ -551,6 +652,74 @@ boolean AudioHandler::InitDevices(byte audioType) {
 
 
 
+void AudioHandler::LoadTrackLengthIndex() {
+  unsigned short eepromByte = TRACK_LENGTH_INDEX_EEPROM_START_BYTE;
+
+  if (RPU_ReadByteFromEEProm(eepromByte)!=TRACK_LENGTH_INDEX_SIGNATURE) {
+    // Never been written (or written by something else) - start fresh
+    RPU_WriteByteToEEProm(eepromByte, TRACK_LENGTH_INDEX_SIGNATURE);
+    for (byte count=0; count<TRACK_LENGTH_INDEX_SIZE; count++) {
+      trackLengthIndex[count].trackIndex = INVALID_SOUND_INDEX;
+      trackLengthIndex[count].lengthTenths = 0;
+      WriteTrackLengthEntry(count);
+    }
+    return;
+  }
+
+  // Each entry is packed as an unsigned long: track in the low
+  // word and length in the high word
+  eepromByte += 1;
+  for (byte count=0; count<TRACK_LENGTH_INDEX_SIZE; count++) {
+    unsigned long entry = RPU_ReadULFromEEProm(eepromByte, (unsigned long)INVALID_SOUND_INDEX);
+    trackLengthIndex[count].trackIndex = (unsigned short)(entry & 0xFFFF);
+    trackLengthIndex[count].lengthTenths = (unsigned short)(entry >> 16);
+    eepromByte += 4;
+  }
+}
+
+
+void AudioHandler::WriteTrackLengthEntry(byte entryNum) {
+  unsigned short eepromByte = TRACK_LENGTH_INDEX_EEPROM_START_BYTE + 1 + 4*((unsigned short)entryNum);
+  RPU_WriteULToEEProm(eepromByte, (((unsigned long)trackLengthIndex[entryNum].lengthTenths)<<16) | trackLengthIndex[entryNum].trackIndex);
+}
+
+
+unsigned long AudioHandler::GetTrackLength(unsigned short trackIndex) {
+  for (byte count=0; count<TRACK_LENGTH_INDEX_SIZE; count++) {
+    if (trackLengthIndex[count].trackIndex==trackIndex) return ((unsigned long)trackLengthIndex[count].lengthTenths) * 100;
+  }
+  return 0;
+}
+
+
+void AudioHandler::LearnTrackLength(unsigned short trackIndex, unsigned long msPlayed) {
+  unsigned long lengthTenths = (msPlayed + 50) / 100;
+  if (lengthTenths==0 || lengthTenths>0xFFFF) return;
+
+  byte entryNum = TRACK_LENGTH_INDEX_SIZE;
+  for (byte count=0; count<TRACK_LENGTH_INDEX_SIZE; count++) {
+    if (trackLengthIndex[count].trackIndex==trackIndex) {
+      // Measurements jitter by a loop or two - only rewrite
+      // EEPROM when the length has really changed
+      unsigned short oldTenths = trackLengthIndex[count].lengthTenths;
+      if (lengthTenths+1>=oldTenths && lengthTenths<=((unsigned long)oldTenths)+1) return;
+      entryNum = count;
+      break;
+    }
+    if (entryNum==TRACK_LENGTH_INDEX_SIZE && trackLengthIndex[count].trackIndex==INVALID_SOUND_INDEX) entryNum = count;
+  }
+
+  if (entryNum==TRACK_LENGTH_INDEX_SIZE) {
+    entryNum = trackLengthNextEviction;
+    trackLengthNextEviction = (trackLengthNextEviction+1) % TRACK_LENGTH_INDEX_SIZE;
+  }
+
+  trackLengthIndex[entryNum].trackIndex = trackIndex;
+  trackLengthIndex[entryNum].lengthTenths = (unsigned short)lengthTenths;
+  WriteTrackLengthEntry(entryNum);
+}
+
+
 int AudioHandler::ConvertVolumeSettingToGain(byte volumeSetting) {
   if (volumeSetting==0) return -70;
   if (volumeSetting>10) return 0;
@@ -558,24 +727,88 @@ int AudioHandler::ConvertVolumeSettingToGain(byte volumeSetting) {
 }
 
 
+int AudioHandler::GetBusTargetGain(byte bus) {
+  byte netDuck = 0;
+  for (byte reason=0; reason<AUDIO_NUM_DUCK_REASONS; reason++) {
+    // Overlapping ducks don't stack - the deepest one wins
+    if ((busDuckReasons[bus] & (1<<reason)) && busDuckAmount[bus][reason]>netDuck) netDuck = busDuckAmount[bus][reason];
+  }
+  int targetGain = busGain[bus] - (int)netDuck;
+  if (targetGain<-70) targetGain = -70;
+  return targetGain;
+}
+
+
+void AudioHandler::UpdateBusEnvelope(byte bus, int fadeTime) {
+  int targetGain = GetBusTargetGain(bus);
+  if (targetGain==busAppliedGain[bus]) return;
+  busAppliedGain[bus] = targetGain;
+
+#if defined (RPU_OS_USE_WAV_TRIGGER) || defined (RPU_OS_USE_WAV_TRIGGER_1p3)
+  if (bus==AUDIO_BUS_MUSIC) {
+    if (currentBackgroundTrack==BACKGROUND_TRACK_NONE) return;
+    if (fadeTime) wTrig.trackFade(currentBackgroundTrack, targetGain, fadeTime, 0);
+    else wTrig.trackGain(currentBackgroundTrack, targetGain);
+  } else if (bus==AUDIO_BUS_NOTIFICATIONS) {
+    if (currentNotificationPlaying==INVALID_SOUND_INDEX) return;
+    if (fadeTime) wTrig.trackFade(currentNotificationPlaying, targetGain, fadeTime, 0);
+    else wTrig.trackGain(currentNotificationPlaying, targetGain);
+  } else {
+    // We can't find the playing effects if we don't have bi-directional
+    // communication, so <=3 revs only apply this to new sounds
+    if (RPU_OS_HARDWARE_REV<=3) return;
+    for (int count=0; count<MAX_NUM_VOICES; count++) {
+      int trackNum = wTrig.getPlayingTrack(count);
+      if (trackNum!=((int)0xFFFF) && trackNum!=((int)currentBackgroundTrack) && trackNum!=((int)currentNotificationPlaying)) {
+        if (fadeTime) wTrig.trackFade(trackNum, targetGain, fadeTime, 0);
+        else wTrig.trackGain(trackNum, targetGain);
+      }
+    }
+  }
+#else
+  (void)fadeTime;
+#endif
+}
+
+
+void AudioHandler::DuckBus(byte bus, byte reason, byte duckAmount) {
+  if (bus>=AUDIO_NUM_BUSES || reason>=AUDIO_NUM_DUCK_REASONS) return;
+  busDuckAmount[bus][reason] = duckAmount;
+  busDuckReasons[bus] |= (1<<reason);
+  UpdateBusEnvelope(bus, AUDIO_DUCK_FADE_TIME);
+}
+
+
+void AudioHandler::ReleaseBusDuck(byte bus, byte reason) {
+  if (bus>=AUDIO_NUM_BUSES || reason>=AUDIO_NUM_DUCK_REASONS) return;
+  busDuckReasons[bus] &= ~(1<<reason);
+  UpdateBusEnvelope(bus, AUDIO_RELEASE_FADE_TIME);
+}
+
+
 void AudioHandler::SetSoundFXVolume(byte s_volume) {
-  soundFXGain = ConvertVolumeSettingToGain(s_volume);
+  busGain[AUDIO_BUS_SOUND_FX] = ConvertVolumeSettingToGain(s_volume);
+  UpdateBusEnvelope(AUDIO_BUS_SOUND_FX, 0);
 }
 
 void AudioHandler::SetNotificationsVolume(byte s_volume) {
-  notificationsGain = ConvertVolumeSettingToGain(s_volume);
+  busGain[AUDIO_BUS_NOTIFICATIONS] = ConvertVolumeSettingToGain(s_volume);
+  UpdateBusEnvelope(AUDIO_BUS_NOTIFICATIONS, 0);
 }
 
 void AudioHandler::SetMusicVolume(byte s_volume) {
-  musicGain = ConvertVolumeSettingToGain(s_volume);
+  busGain[AUDIO_BUS_MUSIC] = ConvertVolumeSettingToGain(s_volume);
+  UpdateBusEnvelope(AUDIO_BUS_MUSIC, 0);
 }
 
 void AudioHandler::SetMusicDuckingGain(byte s_ducking) {
-  musicDucking = s_ducking;
+  busDuckAmount[AUDIO_BUS_MUSIC][AUDIO_DUCK_REASON_NOTIFICATION] = s_ducking;
+  UpdateBusEnvelope(AUDIO_BUS_MUSIC, AUDIO_DUCK_FADE_TIME);
 }
 
 void AudioHandler::SetSoundFXDuckingGain(byte s_ducking) {
-  soundFXDucking = s_ducking;
+  busDuckAmount[AUDIO_BUS_SOUND_FX][AUDIO_DUCK_REASON_NOTIFICATION] = s_ducking;
+  UpdateBusEnvelope(AUDIO_BUS_SOUND_FX, AUDIO_DUCK_FADE_TIME);
 }
 
 
@@ -589,6 +822,13 @@ boolean AudioHandler::StopSound(unsigned short soundIndex) {
 }
 
 boolean AudioHandler::StopAllMusic() {
+#if defined(RPU_OS_USE_WAV_TRIGGER) || defined(RPU_OS_USE_WAV_TRIGGER_1p3)
+  // Free the voice holding a pre-loaded song
+  if (curSoundtrack!=NULL && prearmedSoundtrackEntry!=SOUNDTRACK_ENTRY_NONE) {
+    wTrig.trackStop(curSoundtrack[prearmedSoundtrackEntry].TrackIndex);
+  }
+#endif
+  prearmedSoundtrackEntry = SOUNDTRACK_ENTRY_NONE;
   curSoundtrack = NULL;
 #if defined(RPU_OS_USE_WAV_TRIGGER) || defined(RPU_OS_USE_WAV_TRIGGER_1p3)
   if (currentBackgroundTrack!=BACKGROUND_TRACK_NONE) {
@@ -608,25 +848,20 @@ boolean AudioHandler::StopAllMusic() {
 
 void AudioHandler::ClearNotificationStack(byte priority) {
   if (priority==10) {
-    voiceNotificationStackFirst = 0;
-    voiceNotificationStackLast = 0;
-    for (byte count=0; count<VOICE_NOTIFICATION_STACK_SIZE; count++) {
-      voiceNotificationNumStack[count] = VOICE_NOTIFICATION_STACK_EMPTY;
-      voiceNotificationDuration[count] = 0;
-      voiceNotificationPriorityStack[count] = 0;
+    numVoiceNotifications = 0;
+    return;
+  }
 
+  // Keep only the entries above the given priority and re-heapify
+  byte numKept = 0;
+  for (byte count=0; count<numVoiceNotifications; count++) {
+    if (voiceNotificationHeap[count].priority>priority) {
+      voiceNotificationHeap[numKept] = voiceNotificationHeap[count];
+      numKept += 1;
     }
-  } else {
-    byte tempFirst = voiceNotificationStackFirst;
-    byte tempLast = voiceNotificationStackLast;
-    while (tempFirst != tempLast) {
-      if (voiceNotificationPriorityStack[tempFirst]<=priority) {
-        voiceNotificationNumStack[tempFirst] = INVALID_SOUND_INDEX;
-      }
-      tempFirst += 1;
-      if (tempFirst >= VOICE_NOTIFICATION_STACK_SIZE) tempFirst = 0;
-    }    
   }
+  numVoiceNotifications = numKept;
+  for (int count=((int)numVoiceNotifications/2)-1; count>=0; count--) SiftNotificationDown(count);
 }
 
 
@@ -647,90 +882,142 @@ boolean AudioHandler::StopCurrentNotification(byte priority) {
 
 
 int AudioHandler::SpaceLeftOnNotificationStack() {
-  if (voiceNotificationStackFirst>=VOICE_NOTIFICATION_STACK_SIZE || voiceNotificationStackLast>=VOICE_NOTIFICATION_STACK_SIZE) return 0;
-  if (voiceNotificationStackLast>=voiceNotificationStackFirst) return ((VOICE_NOTIFICATION_STACK_SIZE-1) - (voiceNotificationStackLast-voiceNotificationStackFirst));
-  return (voiceNotificationStackFirst - voiceNotificationStackLast) - 1;
+  return VOICE_NOTIFICATION_STACK_SIZE - numVoiceNotifications;
 }
 
 
-void AudioHandler::PushToNotificationStack(unsigned int notification, unsigned int duration, byte priority) {
-  // If the switch stack last index is out of range, then it's an error - return
-  if (SpaceLeftOnNotificationStack() == 0) return;
+boolean AudioHandler::NotificationOutranks(byte entry1, byte entry2) {
+  VoiceNotificationEntry *e1 = &voiceNotificationHeap[entry1];
+  VoiceNotificationEntry *e2 = &voiceNotificationHeap[entry2];
+  if (e1->priority!=e2->priority) return (e1->priority>e2->priority);
+  // Same priority - the older callout goes first (sequence wraps)
+  return ((signed char)(e1->sequence - e2->sequence))<0;
+}
 
-  voiceNotificationNumStack[voiceNotificationStackLast] = notification;
-  voiceNotificationDuration[voiceNotificationStackLast] = duration;
-  voiceNotificationPriorityStack[voiceNotificationStackLast] = priority;
 
-  voiceNotificationStackLast += 1;
-  if (voiceNotificationStackLast >= VOICE_NOTIFICATION_STACK_SIZE) {
-    // If the end index is off the end, then wrap
-    voiceNotificationStackLast = 0;
+void AudioHandler::SiftNotificationUp(byte entryNum) {
+  while (entryNum>0) {
+    byte parent = (entryNum-1)/2;
+    if (!NotificationOutranks(entryNum, parent)) break;
+    VoiceNotificationEntry temp = voiceNotificationHeap[parent];
+    voiceNotificationHeap[parent] = voiceNotificationHeap[entryNum];
+    voiceNotificationHeap[entryNum] = temp;
+    entryNum = parent;
   }
 }
 
 
+void AudioHandler::SiftNotificationDown(byte entryNum) {
+  while (1) {
+    byte best = entryNum;
+    byte child = entryNum*2 + 1;
+    if (child<numVoiceNotifications && NotificationOutranks(child, best)) best = child;
+    child += 1;
+    if (child<numVoiceNotifications && NotificationOutranks(child, best)) best = child;
+    if (best==entryNum) break;
+    VoiceNotificationEntry temp = voiceNotificationHeap[best];
+    voiceNotificationHeap[best] = voiceNotificationHeap[entryNum];
+    voiceNotificationHeap[entryNum] = temp;
+    entryNum = best;
+  }
+}
 
-byte AudioHandler::GetTopNotificationPriority() {
-  byte startStack = voiceNotificationStackFirst;
-  byte endStack = voiceNotificationStackLast;
-  if (startStack==endStack) return 0;
 
-  byte topPriorityFound = 0;
+void AudioHandler::PushToNotificationStack(unsigned int notification, unsigned int duration, byte priority, unsigned long expirationTime) {
+  // An identical callout that's already waiting absorbs this one
+  for (byte count=0; count<numVoiceNotifications; count++) {
+    VoiceNotificationEntry *entry = &voiceNotificationHeap[count];
+    if (entry->notificationIndex!=notification) continue;
+    if (priority>entry->priority) entry->priority = priority;
+    if (duration) entry->duration = duration;
+    if (expirationTime==VOICE_NOTIFICATION_NO_EXPIRATION || entry->expirationTime==VOICE_NOTIFICATION_NO_EXPIRATION) {
+      entry->expirationTime = VOICE_NOTIFICATION_NO_EXPIRATION;
+    } else if (expirationTime>entry->expirationTime) {
+      entry->expirationTime = expirationTime;
+    }
+    SiftNotificationUp(count);
+    return;
+  }
 
-  while (startStack!=endStack) {
-    if (voiceNotificationPriorityStack[startStack]>topPriorityFound) topPriorityFound = voiceNotificationPriorityStack[startStack];
-    startStack += 1;
-    if (startStack >= VOICE_NOTIFICATION_STACK_SIZE) startStack = 0;
+  byte entryNum = numVoiceNotifications;
+  if (SpaceLeftOnNotificationStack() == 0) {
+    // When full, the new callout can only displace the lowest-ranked
+    // entry, which is always one of the leaves
+    entryNum = numVoiceNotifications/2;
+    for (byte count=entryNum+1; count<numVoiceNotifications; count++) {
+      if (NotificationOutranks(entryNum, count)) entryNum = count;
+    }
+    if (priority<=voiceNotificationHeap[entryNum].priority) return;
+  } else {
+    numVoiceNotifications += 1;
   }
 
-  return topPriorityFound;
+  voiceNotificationHeap[entryNum].notificationIndex = notification;
+  voiceNotificationHeap[entryNum].duration = duration;
+  voiceNotificationHeap[entryNum].priority = priority;
+  voiceNotificationHeap[entryNum].sequence = nextVoiceNotificationSequence++;
+  voiceNotificationHeap[entryNum].expirationTime = expirationTime;
+  SiftNotificationUp(entryNum);
 }
 
-void AudioHandler::DuckCurrentSoundEffects() {
 
-  // We can't duck if we don't have bi-directional communication
-  // So <=3 revs have to return
-  if (RPU_OS_HARDWARE_REV<=3) return;
-  
-#if defined (RPU_OS_USE_WAV_TRIGGER) || defined (RPU_OS_USE_WAV_TRIGGER_1p3)
-  for (int count=0; count<MAX_NUM_VOICES; count++) {
-    int trackNum = wTrig.getPlayingTrack(count);
-    if (trackNum!=((int)0xFFFF) && trackNum!=((int)currentBackgroundTrack) && trackNum!=((int)currentNotificationPlaying)) {
-      // This is a sound effect that needs to be ducked
-      wTrig.trackFade(trackNum, soundFXGain - soundFXDucking, 500, 0);
-    }
+boolean AudioHandler::PullFirstFromNotificationStack(VoiceNotificationEntry *entry) {
+  if (numVoiceNotifications==0) return false;
+
+  *entry = voiceNotificationHeap[0];
+  numVoiceNotifications -= 1;
+  if (numVoiceNotifications) {
+    voiceNotificationHeap[0] = voiceNotificationHeap[numVoiceNotifications];
+    SiftNotificationDown(0);
   }
-#endif  
-  
+  return true;
 }
 
 
+byte AudioHandler::GetTopNotificationPriority() {
+  if (numVoiceNotifications==0) return 0;
+  return voiceNotificationHeap[0].priority;
+}
 
-boolean AudioHandler::QueuePrioritizedNotification(unsigned short notificationIndex, unsigned short notificationLength, byte priority, unsigned long currentTime) {
+void AudioHandler::PlayNotification(unsigned short notificationIndex, unsigned short duration, byte priority, unsigned long currentTime) {
 #if defined (RPU_OS_USE_WAV_TRIGGER) || defined (RPU_OS_USE_WAV_TRIGGER_1p3)
-  // if everything on the queue has a lower priority, kill all those
-  byte topQueuePriority = GetTopNotificationPriority();
-  if (priority>topQueuePriority) {
-    ClearNotificationStack();  
-  }
+  // Fall back on the learned length so the queue can be timed
+  // instead of polled
+  if (duration==0) duration = (unsigned short)GetTrackLength(notificationIndex);
+  DuckBus(AUDIO_BUS_MUSIC, AUDIO_DUCK_REASON_NOTIFICATION, busDuckAmount[AUDIO_BUS_MUSIC][AUDIO_DUCK_REASON_NOTIFICATION]);
+  DuckBus(AUDIO_BUS_SOUND_FX, AUDIO_DUCK_REASON_NOTIFICATION, busDuckAmount[AUDIO_BUS_SOUND_FX][AUDIO_DUCK_REASON_NOTIFICATION]);
+  if (duration) nextVoiceNotificationPlayTime = currentTime + (unsigned long)(duration);
+  else nextVoiceNotificationPlayTime = 0;
+
+  wTrig.trackPlayPoly(notificationIndex);
+  wTrig.trackGain(notificationIndex, busAppliedGain[AUDIO_BUS_NOTIFICATIONS]);
+  currentNotificationStartTime = currentTime;
+
+  currentNotificationPlaying = notificationIndex;
+  currentNotificationPriority = priority;
+#else
+  (void)notificationIndex;
+  (void)duration;
+  (void)priority;
+  (void)currentTime;
+#endif
+}
 
-  // If there's nothing playing, we can play it now
-  if (currentNotificationPlaying == INVALID_SOUND_INDEX) {
-    if (currentBackgroundTrack != BACKGROUND_TRACK_NONE) {
-      wTrig.trackFade(currentBackgroundTrack, musicGain - musicDucking, 500, 0);
-    }
-    DuckCurrentSoundEffects();
-    if (notificationLength) nextVoiceNotificationPlayTime = currentTime + (unsigned long)(notificationLength);
-    else nextVoiceNotificationPlayTime = 0;
 
-    wTrig.trackPlayPoly(notificationIndex);
-    wTrig.trackGain(notificationIndex, notificationsGain);
-    currentNotificationStartTime = currentTime;
-    
-    currentNotificationPlaying = notificationIndex;
-    currentNotificationPriority = priority;
+boolean AudioHandler::QueuePrioritizedNotification(unsigned short notificationIndex, unsigned short notificationLength, byte priority, unsigned long currentTime, unsigned long expirationTime) {
+#if defined (RPU_OS_USE_WAV_TRIGGER) || defined (RPU_OS_USE_WAV_TRIGGER_1p3)
+  // Don't bother with a callout that's already stale
+  if (expirationTime!=VOICE_NOTIFICATION_NO_EXPIRATION && currentTime>expirationTime) return false;
+
+  if (currentNotificationPlaying == INVALID_SOUND_INDEX) {
+    // If there's nothing playing, we can play it now
+    PlayNotification(notificationIndex, notificationLength, priority, currentTime);
+  } else if (priority>currentNotificationPriority) {
+    // A more important callout cuts off the one that's playing
+    wTrig.trackStop(currentNotificationPlaying);
+    PlayNotification(notificationIndex, notificationLength, priority, currentTime);
   } else {
-    PushToNotificationStack(notificationIndex, notificationLength, priority);
+    PushToNotificationStack(notificationIndex, notificationLength, priority, expirationTime);
   }
 #else
   // Phony stuff to get rid of warnings
@@ -738,26 +1025,57 @@ boolean AudioHandler::QueuePrioritizedNotification(unsigned short notificationIn
   (void)notificationLength;
   (void)priority;
   (void)currentTime;
+  (void)expirationTime;
 #endif
 
   return true;
 }
 
+void AudioHandler::OutputTrafficStats(unsigned long currentTime) {
+#if defined (RPU_OS_USE_WAV_TRIGGER) || defined (RPU_OS_USE_WAV_TRIGGER_1p3)
+  // Reports what's been sent to the WAV Trigger since the last call,
+  // so bytes per game event and commands per second can be measured
+  // on the machine
+  char buf[128];
+  uint32_t bytesSent, framesSent, reportsReceived;
+  wTrig.getTrafficStats(&bytesSent, &framesSent, &reportsReceived);
+  unsigned long elapsed = currentTime - trafficStatsStartTime;
+  if (elapsed==0) elapsed = 1;
+  sprintf(buf, "WAV: %lu frames, %lu bytes, %lu reports in %lu ms (%lu B/s)\n", 
+    (unsigned long)framesSent, (unsigned long)bytesSent, (unsigned long)reportsReceived, elapsed, (((unsigned long)bytesSent)*1000)/elapsed);
+  Channel_DebugText(buf);
+  wTrig.resetTrafficStats();
+  trafficStatsStartTime = currentTime;
+#else
+  (void)currentTime;
+#endif
+}
+
+unsigned long AudioHandler::GetFramesSent() {
+#if defined (RPU_OS_USE_WAV_TRIGGER) || defined (RPU_OS_USE_WAV_TRIGGER_1p3)
+  uint32_t bytesSent, framesSent, reportsReceived;
+  wTrig.getTrafficStats(&bytesSent, &framesSent, &reportsReceived);
+  return framesSent;
+#else
+  return 0;
+#endif
+}
+
 void AudioHandler::OutputTracksPlaying() {
 #if defined (RPU_OS_USE_WAV_TRIGGER) || defined (RPU_OS_USE_WAV_TRIGGER_1p3)
   int i;
   char buf[256];
   sprintf(buf, "nothing");
-  Serial.write("Looking for playing tracks\n");
+  Channel_DebugText("Looking for playing tracks\n");
   wTrig.getVersion(buf, 256);
-  Serial.write("Version: ");
-  Serial.write(buf);
-  Serial.write("\n");
+  Channel_DebugText("Version: ");
+  Channel_DebugText(buf);
+  Channel_DebugText("\n");
   for (i=0; i<1000; i++) {
   
     if (wTrig.isTrackPlaying(i)) {
       sprintf(buf, "Track %d playing\n", i);
-      Serial.write(buf);
+      Channel_DebugText(buf);
     }
   }
 #endif
@@ -780,41 +1098,26 @@ boolean AudioHandler::ServiceNotificationQueue(unsigned long currentTime) {
   }
   
   if (playNextNotification) {
-    byte nextPriority = 0;
-    unsigned int nextNotification = VOICE_NOTIFICATION_STACK_EMPTY;
-    unsigned int nextDuration = 0;
-
-    // Current notification done, see if there's another
-    if (voiceNotificationStackLast>=VOICE_NOTIFICATION_STACK_SIZE) voiceNotificationStackLast = (VOICE_NOTIFICATION_STACK_SIZE-1);
-    while (voiceNotificationStackFirst != voiceNotificationStackLast) {
-      nextPriority = voiceNotificationPriorityStack[voiceNotificationStackFirst];
-      nextNotification = voiceNotificationNumStack[voiceNotificationStackFirst];
-      nextDuration = voiceNotificationDuration[voiceNotificationStackFirst];
-
-      voiceNotificationStackFirst += 1;
-      if (voiceNotificationStackFirst >= VOICE_NOTIFICATION_STACK_SIZE) voiceNotificationStackFirst = 0;
-      if (nextNotification!=INVALID_SOUND_INDEX) break;
+    VoiceNotificationEntry nextEntry;
+    boolean foundNext = false;
+
+    // Current notification done, see if there's another that
+    // hasn't gone stale while it waited
+    while (PullFirstFromNotificationStack(&nextEntry)) {
+      if (nextEntry.expirationTime==VOICE_NOTIFICATION_NO_EXPIRATION || currentTime<=nextEntry.expirationTime) {
+        foundNext = true;
+        break;
+      }
     }
 
-    if (nextNotification != VOICE_NOTIFICATION_STACK_EMPTY) {
-      if (currentBackgroundTrack != BACKGROUND_TRACK_NONE) {
-        wTrig.trackFade(currentBackgroundTrack, musicGain - musicDucking, 500, 0);
-      }
-      DuckCurrentSoundEffects();
-      if (nextDuration!=0) nextVoiceNotificationPlayTime = currentTime + (unsigned long)(nextDuration);
-      else nextVoiceNotificationPlayTime = 0;
-      wTrig.trackPlayPoly(nextNotification);
-      wTrig.trackGain(nextNotification, notificationsGain);
-      currentNotificationStartTime = currentTime;
-      currentNotificationPlaying = nextNotification;
-      currentNotificationPriority = nextPriority;
+    if (foundNext) {
+      PlayNotification(nextEntry.notificationIndex, nextEntry.duration, nextEntry.priority, currentTime);
     } else {
       // No more notifications -- set the volume back up and clear the variable
-      if (currentBackgroundTrack != BACKGROUND_TRACK_NONE) {
-        wTrig.trackFade(currentBackgroundTrack, musicGain, 1500, 0);
-      }
       nextVoiceNotificationPlayTime = 0;
       currentNotificationPlaying = INVALID_SOUND_INDEX;
+      ReleaseBusDuck(AUDIO_BUS_MUSIC, AUDIO_DUCK_REASON_NOTIFICATION);
+      ReleaseBusDuck(AUDIO_BUS_SOUND_FX, AUDIO_DUCK_REASON_NOTIFICATION);
       currentNotificationPriority = 0;
       queueStillHasEntries = false;
     }
@@ -896,11 +1199,8 @@ void AudioHandler::ClearSoundQueue() {
 boolean AudioHandler::PlaySound(unsigned short soundIndex, byte audioType, byte overrideVolume) {
 
   boolean soundPlayed = false;
-  int gain = soundFXGain;
-  if (currentNotificationPlaying!=INVALID_SOUND_INDEX) {
-    // reduce gain (by ducking amount) if there's a notification playing
-    gain -= soundFXDucking;
-  }
+  // New effects start at the bus's current (possibly ducked) level
+  int gain = busAppliedGain[AUDIO_BUS_SOUND_FX];
   if (overrideVolume!=0xFF) gain = ConvertVolumeSettingToGain(overrideVolume);
 
   if (audioType==AUDIO_PLAY_TYPE_CHIMES) {
@@ -1125,7 +1425,9 @@ boolean AudioHandler::PlayBackgroundSoundtrack(AudioSoundtrack *soundtrackArray,
 
   curSoundtrack = soundtrackArray;
   curSoundtrackEntries = numSoundtrackEntries; 
+  if (curSoundtrackEntries>SOUNDTRACK_MAX_ENTRIES) curSoundtrackEntries = SOUNDTRACK_MAX_ENTRIES;
   soundtrackRandomOrder = randomOrder;
+  SelectPlaylist(soundtrackArray);
   if (currentTime!=0) backgroundSongEndTime = currentTime-1;
   else backgroundSongEndTime = 0;
   
@@ -1149,7 +1451,7 @@ boolean AudioHandler::PlayBackgroundSong(unsigned short trackIndex, boolean loop
     trackPlayed = true;
 #endif
     if (loopTrack) wTrig.trackLoop(trackIndex, true);
-    wTrig.trackGain(trackIndex, musicGain);
+    wTrig.trackGain(trackIndex, busAppliedGain[AUDIO_BUS_MUSIC]);
 #endif
   }
   (void)loopTrack;
@@ -1158,32 +1460,136 @@ boolean AudioHandler::PlayBackgroundSong(unsigned short trackIndex, boolean loop
 }
 
 
-void AudioHandler::StartNextSoundtrackSong(unsigned long currentTime) {
+void AudioHandler::SelectPlaylist(AudioSoundtrack *soundtrackArray) {
+  // Park the played mask of the outgoing playlist
+  if (playlistArray[currentPlaylistSlot]!=NULL) playlistPlayedMask[currentPlaylistSlot] = soundtrackPlayedMask;
 
-  if (curSoundtrack==NULL) return;
-  
-  unsigned int retSong = (currentTime%curSoundtrackEntries);
-  boolean songRecentlyPlayed = false;
-
-  unsigned int songCount = 0;
-  for (songCount=0; songCount<curSoundtrackEntries; songCount++) {
-    for (byte count=0; count<NUMBER_OF_SONGS_REMEMBERED; count++) {
-      if (lastSongsPlayed[count]==curSoundtrack[retSong].TrackIndex) {
-        songRecentlyPlayed = true;        
+  byte slot;
+  for (slot=0; slot<SOUNDTRACK_NUM_PLAYLISTS; slot++) {
+    if (playlistArray[slot]==soundtrackArray) break;
+  }
+  if (slot==SOUNDTRACK_NUM_PLAYLISTS) {
+    // Not seen before - take an empty slot, or the one after the current
+    for (slot=0; slot<SOUNDTRACK_NUM_PLAYLISTS; slot++) {
+      if (playlistArray[slot]==NULL) break;
+    }
+    if (slot==SOUNDTRACK_NUM_PLAYLISTS) slot = (currentPlaylistSlot+1)%SOUNDTRACK_NUM_PLAYLISTS;
+    playlistArray[slot] = soundtrackArray;
+    playlistPlayedMask[slot] = 0;
+  }
+
+  currentPlaylistSlot = slot;
+  soundtrackPlayedMask = playlistPlayedMask[slot];
+  lastSoundtrackEntry = SOUNDTRACK_ENTRY_NONE;
+  RefillSoundtrackBag();
+}
+
+
+void AudioHandler::RefillSoundtrackBag() {
+  unsigned long allEntriesMask = (curSoundtrackEntries>=32) ? 0xFFFFFFFF : ((1UL<<curSoundtrackEntries)-1);
+  if ((soundtrackPlayedMask & allEntriesMask)==allEntriesMask) soundtrackPlayedMask = 0;
+
+  // Deal each unplayed entry into the bag once per unit of weight
+  soundtrackBagSize = 0;
+  soundtrackBagPosition = 0;
+  for (byte entry=0; entry<curSoundtrackEntries; entry++) {
+    if (soundtrackPlayedMask & (1UL<<entry)) continue;
+    byte weight = curSoundtrack[entry].Weight;
+    if (weight==0) weight = 1;
+    for (byte count=0; count<weight && soundtrackBagSize<SOUNDTRACK_BAG_SIZE; count++) {
+      soundtrackBag[soundtrackBagSize++] = entry;
+    }
+  }
+
+  if (soundtrackRandomOrder && soundtrackBagSize>1) {
+    // Fisher-Yates
+    for (byte count=soundtrackBagSize-1; count>0; count--) {
+      byte swapWith = random(count+1);
+      byte temp = soundtrackBag[count];
+      soundtrackBag[count] = soundtrackBag[swapWith];
+      soundtrackBag[swapWith] = temp;
+    }
+    // Don't repeat a song across the seam between two bags
+    if (soundtrackBag[0]==lastSoundtrackEntry) {
+      byte swapWith = random(1, soundtrackBagSize);
+      soundtrackBag[0] = soundtrackBag[swapWith];
+      soundtrackBag[swapWith] = lastSoundtrackEntry;
+    }
+  }
+}
+
+
+byte AudioHandler::PullNextSoundtrackEntry() {
+  if (soundtrackBagPosition>=soundtrackBagSize) RefillSoundtrackBag();
+  if (soundtrackBagSize==0) return SOUNDTRACK_ENTRY_NONE;
+
+  // Weighted entries can land next to each other - push a
+  // back-to-back repeat further down the bag if we can
+  if (soundtrackBag[soundtrackBagPosition]==lastSoundtrackEntry) {
+    for (byte count=soundtrackBagPosition+1; count<soundtrackBagSize; count++) {
+      if (soundtrackBag[count]!=lastSoundtrackEntry) {
+        soundtrackBag[soundtrackBagPosition] = soundtrackBag[count];
+        soundtrackBag[count] = lastSoundtrackEntry;
         break;
       }
     }
-    if (!songRecentlyPlayed) break;
-    retSong = (retSong+1);
-    songRecentlyPlayed = false;
-    if (retSong>=curSoundtrackEntries) retSong = 0;
   }
 
-  // Record this song in the array
-  for (byte count=(NUMBER_OF_SONGS_REMEMBERED-1); count>0; count--) lastSongsPlayed[count] = lastSongsPlayed[count-1];
-  lastSongsPlayed[0] = curSoundtrack[retSong].TrackIndex;
+  byte entry = soundtrackBag[soundtrackBagPosition++];
+  soundtrackPlayedMask |= (1UL<<entry);
+  lastSoundtrackEntry = entry;
+  return entry;
+}
+
+
+void AudioHandler::PrearmNextSoundtrackSong() {
+  if (curSoundtrack==NULL || prearmedSoundtrackEntry!=SOUNDTRACK_ENTRY_NONE) return;
+
+  // Pulling marks the entry as played, so remember what
+  // to put back if it can't be used
+  unsigned long oldPlayedMask = soundtrackPlayedMask;
+  byte oldLastEntry = lastSoundtrackEntry;
+
+  prearmedSoundtrackEntry = PullNextSoundtrackEntry();
+  if (prearmedSoundtrackEntry==SOUNDTRACK_ENTRY_NONE) return;
+  if (curSoundtrack[prearmedSoundtrackEntry].TrackIndex==currentBackgroundTrack) {
+    // Can't load a second copy of the playing track (the fade-out
+    // would stop both), so leave it in the bag
+    soundtrackBagPosition -= 1;
+    soundtrackPlayedMask = oldPlayedMask;
+    lastSoundtrackEntry = oldLastEntry;
+    prearmedSoundtrackEntry = SOUNDTRACK_ENTRY_NONE;
+    return;
+  }
+
+#if defined(RPU_OS_USE_WAV_TRIGGER) || defined(RPU_OS_USE_WAV_TRIGGER_1p3)
+  // Load the next song paused so it can start without a gap
+  unsigned short trackIndex = curSoundtrack[prearmedSoundtrackEntry].TrackIndex;
+#ifdef RPU_OS_USE_WAV_TRIGGER_1p3
+  wTrig.trackLoad(trackIndex, true);
+#else
+  wTrig.trackLoad(trackIndex);
+#endif
+  wTrig.trackGain(trackIndex, busAppliedGain[AUDIO_BUS_MUSIC]);
+#endif
+}
+
 
-  backgroundSongEndTime = (((unsigned long)curSoundtrack[retSong].TrackLength) * 1000) + currentTime;
+void AudioHandler::StartNextSoundtrackSong(unsigned long currentTime) {
+
+  if (curSoundtrack==NULL) return;
+
+  boolean songPrearmed = (prearmedSoundtrackEntry!=SOUNDTRACK_ENTRY_NONE);
+  byte retSong = songPrearmed ? prearmedSoundtrackEntry : PullNextSoundtrackEntry();
+  prearmedSoundtrackEntry = SOUNDTRACK_ENTRY_NONE;
+  if (retSong==SOUNDTRACK_ENTRY_NONE) return;
+
+  unsigned long songLength = ((unsigned long)curSoundtrack[retSong].TrackLength) * 1000;
+  if (songLength==0) songLength = GetTrackLength(curSoundtrack[retSong].TrackIndex);
+  backgroundSongStartTime = currentTime;
+  // Without a known length we have to watch for the track to stop
+  if (songLength) backgroundSongEndTime = songLength + currentTime;
+  else backgroundSongEndTime = 0;
   
   if (currentBackgroundTrack!=BACKGROUND_TRACK_NONE) {
 #if defined(RPU_OS_USE_WAV_TRIGGER) || defined(RPU_OS_USE_WAV_TRIGGER_1p3)
@@ -1194,12 +1600,17 @@ void AudioHandler::StartNextSoundtrackSong(unsigned long currentTime) {
   musicStopped = false;
 
 #if defined(RPU_OS_USE_WAV_TRIGGER) || defined(RPU_OS_USE_WAV_TRIGGER_1p3)
+  if (songPrearmed) {
+    wTrig.trackGain(currentBackgroundTrack, busAppliedGain[AUDIO_BUS_MUSIC]);
+    wTrig.trackResume(currentBackgroundTrack);
+  } else {
 #ifdef RPU_OS_USE_WAV_TRIGGER_1p3
-  wTrig.trackPlayPoly(currentBackgroundTrack, true);
+    wTrig.trackPlayPoly(currentBackgroundTrack, true);
 #else
-  wTrig.trackPlayPoly(currentBackgroundTrack);
+    wTrig.trackPlayPoly(currentBackgroundTrack);
 #endif
-  wTrig.trackGain(currentBackgroundTrack, musicGain);
+    wTrig.trackGain(currentBackgroundTrack, busAppliedGain[AUDIO_BUS_MUSIC]);
+  }
 #endif
 
 }
@@ -1222,10 +1633,13 @@ void AudioHandler::ManageBackgroundSong(unsigned long currentTime) {
     if (backgroundSongEndTime!=0) {
       if (currentTime>=backgroundSongEndTime) {
         StartNextSoundtrackSong(currentTime);
+      } else if ((currentTime+SOUNDTRACK_PREARM_TIME)>=backgroundSongEndTime && currentBackgroundTrack!=BACKGROUND_TRACK_NONE) {
+        PrearmNextSoundtrackSong();
       }
     } else {
 #if defined(RPU_OS_USE_WAV_TRIGGER) || defined(RPU_OS_USE_WAV_TRIGGER_1p3)
-      if (!wTrig.isTrackPlaying(currentBackgroundTrack)) {
+      // Give the track report a moment to arrive before polling
+      if (currentTime>(backgroundSongStartTime+500) && !wTrig.isTrackPlaying(currentBackgroundTrack)) {
         StartNextSoundtrackSong(currentTime);
       }
 #endif
@@ -1237,6 +1651,16 @@ void AudioHandler::ManageBackgroundSong(unsigned long currentTime) {
 boolean AudioHandler::Update(unsigned long currentTime) {
 #if defined(RPU_OS_USE_WAV_TRIGGER) || defined(RPU_OS_USE_WAV_TRIGGER_1p3)
   wTrig.update();
+
+  uint16_t finishedTrack;
+  uint32_t msPlayed;
+  while (wTrig.getFinishedTrack(&finishedTrack, &msPlayed)) {
+    // Sound effects would churn the index, so only callouts
+    // and music are worth remembering
+    if (finishedTrack==currentNotificationPlaying || finishedTrack==currentBackgroundTrack) {
+      LearnTrackLength(finishedTrack, msPlayed);
+    }
+  }
 #endif
   boolean queueHasEntries = false;
   ManageBackgroundSong(currentTime);
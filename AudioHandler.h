@@ -9,17 +9,54 @@
 #define AUDIO_PLAY_TYPE_ORIGINAL_SOUNDS   2
 #define AUDIO_PLAY_TYPE_WAV_TRIGGER       4
 
-#define NUMBER_OF_SONGS_REMEMBERED    10
-
-#define VOICE_NOTIFICATION_STACK_SIZE   5
+// Soundtracks are dealt from a shuffle bag. Each playlist remembers
+// which of its entries have played this cycle so a mode's music
+// picks up where it left off (only the first 32 entries are used)
+#define SOUNDTRACK_BAG_SIZE           32
+#define SOUNDTRACK_MAX_ENTRIES        32
+#define SOUNDTRACK_NUM_PLAYLISTS      4
+#define SOUNDTRACK_ENTRY_NONE         0xFF
+#define SOUNDTRACK_PREARM_TIME        3000
+
+#define VOICE_NOTIFICATION_STACK_SIZE   8
 #define VOICE_NOTIFICATION_STACK_EMPTY  0xFFFF
+#define VOICE_NOTIFICATION_NO_EXPIRATION  0
 
 #define BACKGROUND_TRACK_NONE           0xFFFF
 
+// Track lengths measured from WAV Trigger track reports are kept
+// in a small index that's mirrored to EEPROM (4 bytes per entry)
+#define TRACK_LENGTH_INDEX_SIZE         24
+#define TRACK_LENGTH_INDEX_SIGNATURE    0xA5
+#ifndef TRACK_LENGTH_INDEX_EEPROM_START_BYTE
+#define TRACK_LENGTH_INDEX_EEPROM_START_BYTE  200
+#endif
+
+struct TrackLengthEntry {
+  unsigned short trackIndex;
+  unsigned short lengthTenths; // tenths of a second
+};
+
+
+// Each bus has a base gain from the operator's volume setting
+// and can be ducked for several independent reasons. The envelope
+// is the base gain minus the deepest active duck.
+#define AUDIO_BUS_MUSIC               0
+#define AUDIO_BUS_SOUND_FX            1
+#define AUDIO_BUS_NOTIFICATIONS       2
+#define AUDIO_NUM_BUSES               3
+
+#define AUDIO_DUCK_REASON_NOTIFICATION  0
+#define AUDIO_DUCK_REASON_GAME          1
+#define AUDIO_NUM_DUCK_REASONS          2
+
+#define AUDIO_DUCK_FADE_TIME          500
+#define AUDIO_RELEASE_FADE_TIME       1500
 
 struct AudioSoundtrack {
   unsigned short TrackIndex;
   unsigned short TrackLength;
+  byte Weight; // number of times per cycle (0 is treated as 1)
 };
 
 
@@ -28,6 +65,16 @@ struct AudioSoundtrack {
 #define SB300_SOUND_FUNCTION_ANALOG       1
 #define SOUND_EFFECT_QUEUE_SIZE 50
 
+// Pending callouts are held in a binary heap ordered by
+// priority (highest first) and then by arrival (oldest first)
+struct VoiceNotificationEntry {
+  unsigned short notificationIndex;
+  unsigned short duration;
+  byte priority;
+  byte sequence;
+  unsigned long expirationTime; // VOICE_NOTIFICATION_NO_EXPIRATION = never expires
+};
+
 struct SoundCardCommandEntry {
   byte soundFunction;
   byte soundRegister;
@@ -87,6 +134,7 @@ struct SoundEffectEntry {
 
 #define MAX_MESSAGE_LEN         32
 #define MAX_NUM_VOICES          14
+#define FINISHED_TRACK_QUEUE_SIZE 4
 #define VERSION_STRING_LEN        21
 
 #define SOM1  0xf0
@@ -133,10 +181,26 @@ public:
   void trackFade(int trk, int gain, int time, bool stopFlag);
   void samplerateOffset(int offset);
   void setTriggerBank(int bank);
+  bool getFinishedTrack(uint16_t *trk, uint32_t *msPlayed);
+  void getTrafficStats(uint32_t *bytesSent, uint32_t *framesSent, uint32_t *reportsReceived);
+  void resetTrafficStats(void);
 
 private:
   void trackControl(int trk, int code);
   void trackControl(int trk, int code, bool lock);
+  void abandonTrack(int trk);
+  void sendFrame(uint8_t *txbuf, uint8_t len);
+
+  uint32_t txBytes;
+  uint32_t txFrames;
+  uint32_t rxReports;
+
+  uint32_t voiceStartTime[MAX_NUM_VOICES];
+  uint16_t voiceAbandoned;
+  uint16_t finishedTracks[FINISHED_TRACK_QUEUE_SIZE];
+  uint32_t finishedTrackLengths[FINISHED_TRACK_QUEUE_SIZE];
+  uint8_t finishedFirst;
+  uint8_t finishedLast;
 
   uint16_t voiceTable[MAX_NUM_VOICES];
   uint8_t rxMessage[MAX_MESSAGE_LEN];
@@ -161,14 +225,20 @@ class AudioHandler
     ~AudioHandler();
 
     boolean InitDevices(byte audioType);
+    void LoadTrackLengthIndex();
+    unsigned long GetTrackLength(unsigned short trackIndex);
 
     void OutputTracksPlaying();
+    void OutputTrafficStats(unsigned long currentTime);
+    unsigned long GetFramesSent();
 
     void SetSoundFXVolume(byte s_volume);
     void SetNotificationsVolume(byte s_volume);
     void SetMusicVolume(byte s_volume);
     void SetMusicDuckingGain(byte s_ducking);
     void SetSoundFXDuckingGain(byte s_ducking);
+    void DuckBus(byte bus, byte reason, byte duckAmount);
+    void ReleaseBusDuck(byte bus, byte reason);
 
     boolean PlayBackgroundSoundtrack(AudioSoundtrack *soundtrackArray, unsigned short numSoundtrackEntries, unsigned long currentTime, boolean randomOrder=true);
     boolean PlayBackgroundSong(unsigned short trackIndex, boolean loopTrack=true);
@@ -183,7 +253,7 @@ class AudioHandler
     boolean QueueSoundCardCommand(byte scFunction, byte scRegister, byte scData, unsigned long startTime);
     boolean PlaySoundCardWhenPossible(unsigned short soundEffectNum, unsigned long currentTime, unsigned long requestedPlayTime = 0, unsigned long playUntil = 50, byte priority = 10);
     
-    boolean QueuePrioritizedNotification(unsigned short notificationIndex, unsigned short notificationLength, byte priority, unsigned long currentTime);
+    boolean QueuePrioritizedNotification(unsigned short notificationIndex, unsigned short notificationLength, byte priority, unsigned long currentTime, unsigned long expirationTime=VOICE_NOTIFICATION_NO_EXPIRATION);
     
     boolean Update(unsigned long currentTime);
 
@@ -197,21 +267,26 @@ class AudioHandler
   private:
     AudioSoundtrack *curSoundtrack;
     int volumeToGainConversion[11] = {-70, -18, -16, -14, -12, -10, -8, -6, -4, -2, 0};
-    int soundFXGain;
-    int notificationsGain;
-    int musicGain;    
-    int musicDucking;
-    int soundFXDucking;
-    byte voiceNotificationStackFirst;
-    byte voiceNotificationStackLast;
-    byte voiceNotificationPriorityStack[VOICE_NOTIFICATION_STACK_SIZE];
+    int busGain[AUDIO_NUM_BUSES];
+    int busAppliedGain[AUDIO_NUM_BUSES];
+    byte busDuckAmount[AUDIO_NUM_BUSES][AUDIO_NUM_DUCK_REASONS];
+    byte busDuckReasons[AUDIO_NUM_BUSES];
+    byte numVoiceNotifications;
+    byte nextVoiceNotificationSequence;
     byte currentNotificationPriority;
     boolean soundtrackRandomOrder;
     boolean musicStopped;
     unsigned int currentNotificationPlaying;
-    unsigned int voiceNotificationNumStack[VOICE_NOTIFICATION_STACK_SIZE];
-    unsigned int voiceNotificationDuration[VOICE_NOTIFICATION_STACK_SIZE];
-    unsigned int lastSongsPlayed[NUMBER_OF_SONGS_REMEMBERED];
+    VoiceNotificationEntry voiceNotificationHeap[VOICE_NOTIFICATION_STACK_SIZE];
+    byte soundtrackBag[SOUNDTRACK_BAG_SIZE];
+    byte soundtrackBagSize;
+    byte soundtrackBagPosition;
+    byte lastSoundtrackEntry;
+    byte prearmedSoundtrackEntry;
+    byte currentPlaylistSlot;
+    unsigned long soundtrackPlayedMask;
+    AudioSoundtrack *playlistArray[SOUNDTRACK_NUM_PLAYLISTS];
+    unsigned long playlistPlayedMask[SOUNDTRACK_NUM_PLAYLISTS];
     unsigned long currentNotificationStartTime;
     unsigned long nextSoundtrackPlayTime;    
     unsigned short curSoundtrackEntries;
@@ -236,7 +311,8 @@ class AudioHandler
 
     void InitSB300Registers();
     void PlaySB300StartupBeep();
-    void DuckCurrentSoundEffects();
+    int GetBusTargetGain(byte bus);
+    void UpdateBusEnvelope(byte bus, int fadeTime);
 
     int SpaceLeftOnNotificationStack();
     void ClearSoundQueue();
@@ -244,15 +320,31 @@ class AudioHandler
     void ClearNotificationStack(byte priority = 10);
     void InitSoundEffectQueue();
     void StartNextSoundtrackSong(unsigned long currentTime);
+    void SelectPlaylist(AudioSoundtrack *soundtrackArray);
+    void RefillSoundtrackBag();
+    byte PullNextSoundtrackEntry();
+    void PrearmNextSoundtrackSong();
     void ManageBackgroundSong(unsigned long currentTime);
     boolean ServiceNotificationQueue(unsigned long currentTime);
-    void PushToNotificationStack(unsigned int notification, unsigned int duration, byte priority);
+    void PushToNotificationStack(unsigned int notification, unsigned int duration, byte priority, unsigned long expirationTime);
+    boolean PullFirstFromNotificationStack(VoiceNotificationEntry *entry);
+    boolean NotificationOutranks(byte entry1, byte entry2);
+    void SiftNotificationUp(byte entryNum);
+    void SiftNotificationDown(byte entryNum);
+    void PlayNotification(unsigned short notificationIndex, unsigned short duration, byte priority, unsigned long currentTime);
     byte GetTopNotificationPriority();
     boolean ServiceSoundCardQueue(unsigned long currentTime);
     boolean ServiceSoundQueue(unsigned long currentTime);
 
     unsigned long nextVoiceNotificationPlayTime;
+    unsigned long backgroundSongStartTime;
     unsigned long backgroundSongEndTime;
+    unsigned long trafficStatsStartTime;
+
+    TrackLengthEntry trackLengthIndex[TRACK_LENGTH_INDEX_SIZE];
+    byte trackLengthNextEviction;
+    void LearnTrackLength(unsigned short trackIndex, unsigned long msPlayed);
+    void WriteTrackLengthEntry(byte entryNum);
     
 };
 
@@ -42,14 +42,40 @@ byte ScoreAdditionLastPhase;
 unsigned long LastTimeScoreChanged = 0;
 unsigned long LastFlashOrDash = 0;
 unsigned long ScoreOverrideValue[4] = {0, 0, 0, 0};
-byte LastAnimationSeed[4] = {0, 0, 0, 0};
-byte AnimationStartSeed[4] = {0, 0, 0, 0};
+unsigned long ScoreOverrideBCD[4] = {0, 0, 0, 0};
 byte ScoreOverrideStatus = 0;
 byte ScoreAnimation[4] = {0, 0, 0, 0};
 byte AnimationDisplayOrder[4] = {0, 1, 2, 3};
 byte OverrideMask[4] = {0xFF, 0xFF, 0xFF, 0xFF};
+#define DISPLAY_ANIMATION_NONE            0xFF
+byte AnimationRunning[4] = {DISPLAY_ANIMATION_NONE, DISPLAY_ANIMATION_NONE, DISPLAY_ANIMATION_NONE, DISPLAY_ANIMATION_NONE};
 byte LastScrollPhase[RPU_NUMBER_OF_PLAYER_DISPLAYS] = {0};
 
+unsigned long pow10[10] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
+
+#if (DISPLAY_NUM_DIGITS==7)
+#define DISPLAY_BCD_DIGITS_MASK   0x0FFFFFFF
+#else
+#define DISPLAY_BCD_DIGITS_MASK   0x00FFFFFF
+#endif
+
+// Display compositor
+// The Show functions stack their layers (base score, achievement
+// digit, override value, animation mask) into a single packed-BCD
+// value and enable mask per display. Digits are only written to
+// the RPU when that composed frame changes.
+unsigned long ComposedDisplayValue[RPU_NUMBER_OF_PLAYER_DISPLAYS];
+byte ComposedDisplayMask[RPU_NUMBER_OF_PLAYER_DISPLAYS];
+byte ComposedDisplayCommas = 0;
+byte DisplayDigitsDirty = 0xFF;
+byte DisplayMaskDirty = 0xFF;
+byte DisplaysComposed = 0;
+
+// Last score converted to BCD for each display, so a
+// score that isn't changing isn't converted every pass
+unsigned long LastScoreConverted[RPU_NUMBER_OF_PLAYER_DISPLAYS];
+unsigned long LastScoreBCD[RPU_NUMBER_OF_PLAYER_DISPLAYS];
+
 
 
 
@@ -67,7 +93,15 @@ byte Display_MagnitudeOfScore(unsigned long score) {
 }
 
 
+void Display_InvalidateDisplays(byte displayNum) {
+  byte displayBits = (displayNum==0xFF) ? 0xFF : (0x01<<displayNum);
+  DisplayDigitsDirty |= displayBits;
+  DisplayMaskDirty |= displayBits;
+}
+
+
 void Display_ResetDisplayTrackingVariables() {
+  Display_InvalidateDisplays(0xFF);
   ScoreAdditionAnimation = 0;
   ScoreAdditionAnimationStartTime = 0;
   LastRemainingAnimatedScoreShown = 0;
@@ -91,12 +125,14 @@ void Display_OverrideScoreDisplay(byte displayNum, unsigned long value, byte ani
   ScoreOverrideStatus |= (0x01 << displayNum);
   ScoreAnimation[displayNum] = animationType;
   ScoreOverrideValue[displayNum] = value;
-  LastAnimationSeed[displayNum] = 255;
+  ScoreOverrideBCD[displayNum] = RPU_ConvertToBCD(value);
+  AnimationRunning[displayNum] = DISPLAY_ANIMATION_NONE;
   OverrideMask[displayNum] = overrideMask;
 }
 
 
 void Display_ClearOverride(byte displayNum) {
+  Display_InvalidateDisplays(displayNum);
   if (displayNum==0xFF) {
     ScoreOverrideStatus = 0;
   } else {
@@ -117,6 +153,76 @@ byte GetDisplayMask(byte numDigits) {
 }
 
 
+// Same enable mask RPU_SetDisplayBCD returns for blankByMagnitude
+byte GetMagnitudeMask(unsigned long bcdValue, byte minDigits) {
+  byte numDigits = RPU_MagnitudeOfBCD(bcdValue);
+  if (numDigits<minDigits) numDigits = minDigits;
+  return GetDisplayMask(numDigits);
+}
+
+
+unsigned long ScoreToBCD(byte displayNum, unsigned long score) {
+  if (score!=LastScoreConverted[displayNum]) {
+    LastScoreConverted[displayNum] = score;
+    LastScoreBCD[displayNum] = RPU_ConvertToBCD(score);
+  }
+  return LastScoreBCD[displayNum];
+}
+
+
+void ComposeDisplay(byte displayNum, unsigned long bcdValue, byte enableMask, boolean showCommasByMagnitude = false) {
+  byte displayBit = 0x01<<displayNum;
+  DisplaysComposed |= displayBit;
+  if (bcdValue!=ComposedDisplayValue[displayNum] || ((ComposedDisplayCommas & displayBit) ? true : false)!=showCommasByMagnitude) {
+    ComposedDisplayValue[displayNum] = bcdValue;
+    if (showCommasByMagnitude) ComposedDisplayCommas |= displayBit;
+    else ComposedDisplayCommas &= ~displayBit;
+    DisplayDigitsDirty |= displayBit;
+  }
+  if (enableMask!=ComposedDisplayMask[displayNum]) {
+    ComposedDisplayMask[displayNum] = enableMask;
+    DisplayMaskDirty |= displayBit;
+  }
+}
+
+
+void ComposeDisplayMask(byte displayNum, byte enableMask) {
+  DisplaysComposed |= (0x01<<displayNum);
+  if (enableMask!=ComposedDisplayMask[displayNum]) {
+    ComposedDisplayMask[displayNum] = enableMask;
+    DisplayMaskDirty |= (0x01<<displayNum);
+  }
+}
+
+
+// Only displays composed since the last commit are
+// written, so direct writes to the others are left alone
+void CommitComposedDisplays() {
+  // Anything outside the compositor (attract mode, menus) that
+  // wrote a display since we last did means it has to be redrawn
+  byte displaysWritten = RPU_GetDisplaysWritten();
+  DisplayDigitsDirty |= displaysWritten;
+  DisplayMaskDirty |= displaysWritten;
+
+  for (byte displayCount=0; displayCount<DISPLAY_NUMBER_OF_PLAYER_DISPLAYS; displayCount++) {
+    byte displayBit = 0x01<<displayCount;
+    if ((DisplaysComposed & displayBit)==0) continue;
+    if (DisplayDigitsDirty & displayBit) {
+      RPU_SetDisplayBCD(displayCount, ComposedDisplayValue[displayCount], false, 1, (ComposedDisplayCommas & displayBit) ? true : false);
+    }
+    if (DisplayMaskDirty & displayBit) {
+      RPU_SetDisplayBlank(displayCount, ComposedDisplayMask[displayCount]);
+    }
+    DisplayDigitsDirty &= ~displayBit;
+    DisplayMaskDirty &= ~displayBit;
+  }
+
+  // Our own writes don't count
+  RPU_GetDisplaysWritten();
+  DisplaysComposed = 0;
+}
+
+
 void Display_SetAnimationDisplayOrder(byte disp0, byte disp1, byte disp2, byte disp3) {
   AnimationDisplayOrder[0] = disp0;
   AnimationDisplayOrder[1] = disp1;
@@ -128,142 +234,199 @@ void Display_SetAnimationDisplayOrder(byte disp0, byte disp1, byte disp2, byte d
 
 
 
-void ShowAnimatedValue(byte displayNum, unsigned long displayScore, byte animationType) {
-  byte overrideAnimationSeed;
-  byte displayMask = RPU_OS_ALL_DIGITS_MASK;
+// Display animations
+// Each animation is a short keyframe program in flash. A keyframe
+// names a digit shift to move toward (one digit per frame) and how
+// to mask the digits on the way. When the shift reaches the target,
+// the next keyframe starts, so a keyframe that's already at its
+// target lasts one frame (blinks are two of those in a row).
+// Frames are counted on one shared clock of DISPLAY_FRAME_CLOCK_MS
+// ticks, so adding an animation only means adding a table entry.
+#define DISPLAY_FRAME_CLOCK_MS            25
+
+#define DISPLAY_SHIFT_FREE                100   // shift all the way left (digits not used by the value)
+#define DISPLAY_SHIFT_CENTER              101   // shift to center the value
+
+#define DISPLAY_MASK_VALUE                0
+#define DISPLAY_MASK_EVEN_DIGITS          1
+#define DISPLAY_MASK_ODD_DIGITS           2
+#define DISPLAY_MASK_BLANK                3
+
+#define DISPLAY_ANIMATION_FLAG_LOOP         0x01
+#define DISPLAY_ANIMATION_FLAG_MIRROR       0x02  // add a mirror image of the value
+#define DISPLAY_ANIMATION_FLAG_SINGLE_DIGIT 0x04  // only animate one-digit values
+#define DISPLAY_ANIMATION_FLAG_CLEAR_AT_END 0x08  // blank & drop the override when done
+
+#define DISPLAY_ANIMATION_FLAG_COMMAS       0x10
+
+#define DISPLAY_ANIMATION_MAX_KEYFRAMES   4
+#define DISPLAY_ANIMATION_DASH_INTERMITTENT 8
+
+struct DisplayKeyframe {
+  char shift;
+  byte maskOp;
+};
+
+struct DisplayAnimation {
+  byte frameTicks[4];         // clock ticks per frame on each display
+  char startShift;
+  char shiftPerOrder;         // added to every shift per AnimationDisplayOrder step
+  byte minFreeDigits;         // display shows the value as-is without this much room
+  byte minDigits;
+  byte flags;
+  byte numKeyframes;
+  DisplayKeyframe keyframes[DISPLAY_ANIMATION_MAX_KEYFRAMES];
+};
+
+// Indexed by DISPLAY_OVERRIDE_ANIMATION_* (and the dash styles after them)
+const DisplayAnimation DisplayAnimations[] PROGMEM = {
+  // DISPLAY_OVERRIDE_ANIMATION_NONE
+  {{1, 1, 1, 1}, 0, 0, 0, 1, DISPLAY_ANIMATION_FLAG_LOOP, 1, {{0, DISPLAY_MASK_VALUE}}},
+  // DISPLAY_OVERRIDE_ANIMATION_BOUNCE
+  {{10, 10, 10, 10}, 0, 0, 2, 1, DISPLAY_ANIMATION_FLAG_LOOP, 2, {{DISPLAY_SHIFT_FREE, DISPLAY_MASK_VALUE}, {0, DISPLAY_MASK_VALUE}}},
+  // DISPLAY_OVERRIDE_ANIMATION_FLUTTER
+  {{2, 2, 2, 2}, 0, 0, 0, 1, DISPLAY_ANIMATION_FLAG_LOOP, 2, {{0, DISPLAY_MASK_ODD_DIGITS}, {0, DISPLAY_MASK_EVEN_DIGITS}}},
+  // DISPLAY_OVERRIDE_ANIMATION_FLYBY
+  {{3, 3, 3, 3}, -6, -6, 0, 1, DISPLAY_ANIMATION_FLAG_CLEAR_AT_END, 1, {{28, DISPLAY_MASK_VALUE}}},
+  // DISPLAY_OVERRIDE_ANIMATION_CENTER
+  {{7, 7, 7, 7}, DISPLAY_SHIFT_CENTER, 0, 0, 1, DISPLAY_ANIMATION_FLAG_LOOP, 1, {{DISPLAY_SHIFT_CENTER, DISPLAY_MASK_VALUE}}},
+  // DISPLAY_OVERRIDE_SYMMETRIC_BOUNCE
+  {{4, 6, 5, 6}, 0, 0, 0, 1, DISPLAY_ANIMATION_FLAG_LOOP | DISPLAY_ANIMATION_FLAG_MIRROR | DISPLAY_ANIMATION_FLAG_SINGLE_DIGIT, 2, {{DISPLAY_SHIFT_CENTER, DISPLAY_MASK_VALUE}, {0, DISPLAY_MASK_VALUE}}},
+  // DISPLAY_OVERRIDE_CENTER_FLASH_SLOW
+  {{7, 7, 7, 7}, DISPLAY_SHIFT_CENTER, 0, 0, 1, DISPLAY_ANIMATION_FLAG_LOOP, 2, {{DISPLAY_SHIFT_CENTER, DISPLAY_MASK_BLANK}, {DISPLAY_SHIFT_CENTER, DISPLAY_MASK_VALUE}}},
+  // DISPLAY_OVERRIDE_CENTER_FLASH_FAST
+  {{3, 3, 3, 3}, DISPLAY_SHIFT_CENTER, 0, 0, 1, DISPLAY_ANIMATION_FLAG_LOOP, 2, {{DISPLAY_SHIFT_CENTER, DISPLAY_MASK_BLANK}, {DISPLAY_SHIFT_CENTER, DISPLAY_MASK_VALUE}}},
+  // DISPLAY_ANIMATION_DASH_INTERMITTENT
+  {{10, 10, 10, 10}, 0, 0, 0, 2, DISPLAY_ANIMATION_FLAG_LOOP | DISPLAY_ANIMATION_FLAG_COMMAS, 4, {{0, DISPLAY_MASK_BLANK}, {0, DISPLAY_MASK_VALUE}, {0, DISPLAY_MASK_VALUE}, {0, DISPLAY_MASK_VALUE}}}
+};
+#define DISPLAY_NUM_ANIMATIONS  (sizeof(DisplayAnimations)/sizeof(DisplayAnimation))
+
+unsigned long DisplayFrameClock = 0;
+unsigned long DisplayFrameClockTime = 0;
+byte AnimationKeyframe[4];
+char AnimationShift[4];
+unsigned long AnimationNextFrame[4];
+
+
+void Display_UpdateFrameClock() {
+  if (DisplayFrameClockTime==0) DisplayFrameClockTime = CurrentTime;
+  unsigned long elapsed = CurrentTime - DisplayFrameClockTime;
+  if (elapsed < DISPLAY_FRAME_CLOCK_MS) return;
+  // Catch up in one step, however long it's been (operator menus)
+  unsigned long elapsedTicks = elapsed / DISPLAY_FRAME_CLOCK_MS;
+  DisplayFrameClock += elapsedTicks;
+  DisplayFrameClockTime += elapsedTicks * DISPLAY_FRAME_CLOCK_MS;
+}
 
-  byte numDigits = Display_MagnitudeOfScore(displayScore);
-  if (numDigits == 0) numDigits = 1;
-  if (numDigits < (DISPLAY_NUM_DIGITS - 1) && animationType == DISPLAY_OVERRIDE_ANIMATION_BOUNCE) {
-    // This score is going to be animated (back and forth)
-    overrideAnimationSeed = (CurrentTime / 250) % (2 * DISPLAY_NUM_DIGITS - 2 * numDigits);
-    if (overrideAnimationSeed != LastAnimationSeed[displayNum]) {
-
-      LastAnimationSeed[displayNum] = overrideAnimationSeed;
-      byte shiftDigits = (overrideAnimationSeed);
-      if (shiftDigits >= ((DISPLAY_NUM_DIGITS + 1) - numDigits)) shiftDigits = (DISPLAY_NUM_DIGITS - numDigits) * 2 - shiftDigits;
-      byte digitCount;
-      displayMask = GetDisplayMask(numDigits);
-      for (digitCount = 0; digitCount < shiftDigits; digitCount++) {
-        displayScore *= 10;
-        displayMask = displayMask >> 1;
-      }
-      //RPU_SetDisplayBlank(displayNum, 0x00);
-      RPU_SetDisplay(displayNum, displayScore, false);
-      RPU_SetDisplayBlank(displayNum, displayMask);
-    }
-  } else if (animationType == DISPLAY_OVERRIDE_ANIMATION_FLUTTER) {
-    overrideAnimationSeed = CurrentTime / 50;
-    if (overrideAnimationSeed != LastAnimationSeed[displayNum]) {
-      LastAnimationSeed[displayNum] = overrideAnimationSeed;
-      displayMask = GetDisplayMask(numDigits);
-      if (overrideAnimationSeed % 2) {
-        displayMask &= 0x55;
-      } else {
-        displayMask &= 0xAA;
-      }
-      RPU_SetDisplay(displayNum, displayScore, false);
-      RPU_SetDisplayBlank(displayNum, displayMask);
-    }
-  } else if (animationType == DISPLAY_OVERRIDE_ANIMATION_FLYBY) {
-    overrideAnimationSeed = (CurrentTime / 75) % 256;
-    if (overrideAnimationSeed != LastAnimationSeed[displayNum]) {
-      if (LastAnimationSeed[displayNum] == 255) {
-        AnimationStartSeed[displayNum] = overrideAnimationSeed;
-      }
-      LastAnimationSeed[displayNum] = overrideAnimationSeed;
 
-      byte realAnimationSeed = overrideAnimationSeed - AnimationStartSeed[displayNum];
-      if (overrideAnimationSeed < AnimationStartSeed[displayNum]) realAnimationSeed = (255 - AnimationStartSeed[displayNum]) + overrideAnimationSeed;
+char ResolveAnimationShift(char shift, byte numDigits, char orderOffset) {
+  if (shift==DISPLAY_SHIFT_FREE) return DISPLAY_NUM_DIGITS - numDigits;
+  if (shift==DISPLAY_SHIFT_CENTER) return (DISPLAY_NUM_DIGITS - numDigits) / 2;
+  return shift + orderOffset;
+}
 
-      if (realAnimationSeed > 34) {
-        RPU_SetDisplayBlank(displayNum, 0x00);
-        ScoreOverrideStatus &= ~(0x01 << displayNum);
-      } else {
-        int shiftDigits = (-6 * ((int)AnimationDisplayOrder[displayNum] + 1)) + realAnimationSeed;
-        displayMask = GetDisplayMask(numDigits);
-        if (shiftDigits < 0) {
-          shiftDigits = 0 - shiftDigits;
-          byte digitCount;
-          for (digitCount = 0; digitCount < shiftDigits; digitCount++) {
-            displayScore /= 10;
-            displayMask = displayMask << 1;
-          }
-        } else if (shiftDigits > 0) {
-          byte digitCount;
-          for (digitCount = 0; digitCount < shiftDigits; digitCount++) {
-            displayScore *= 10;
-            displayMask = displayMask >> 1;
-          }
-        }
-        RPU_SetDisplay(displayNum, displayScore, false);
-        RPU_SetDisplayBlank(displayNum, displayMask);
-      }
-    }
-  } else if ( animationType == DISPLAY_OVERRIDE_ANIMATION_CENTER ||
-              animationType == DISPLAY_OVERRIDE_CENTER_FLASH_SLOW || 
-              animationType == DISPLAY_OVERRIDE_CENTER_FLASH_FAST ) {
-    overrideAnimationSeed = CurrentTime / 175;
-    if (animationType==DISPLAY_OVERRIDE_CENTER_FLASH_FAST) overrideAnimationSeed = CurrentTime / 75;
-    if (overrideAnimationSeed != LastAnimationSeed[displayNum]) {
-      LastAnimationSeed[displayNum] = overrideAnimationSeed;
-      byte shiftDigits = (DISPLAY_NUM_DIGITS - numDigits) / 2;
-
-      byte digitCount;
-      displayMask = GetDisplayMask(numDigits);
-      for (digitCount = 0; digitCount < shiftDigits; digitCount++) {
-        displayScore *= 10;
-        displayMask = displayMask >> 1;
-      }
-      //RPU_SetDisplayBlank(displayNum, 0x00);
-      RPU_SetDisplay(displayNum, displayScore, false);
 
-      if (animationType == DISPLAY_OVERRIDE_ANIMATION_CENTER) {
-        RPU_SetDisplayBlank(displayNum, displayMask);
-      } else {
-        boolean flashOn = (overrideAnimationSeed%2) ? true : false;
-        if (flashOn) RPU_SetDisplayBlank(displayNum, displayMask);
-        else RPU_SetDisplayBlank(displayNum, 0x00);
-      }
+void ShiftDisplayValue(unsigned long *bcdValue, byte *displayMask, char shift) {
+  if (shift>=8 || shift<=-8) {
+    *bcdValue = 0;
+    *displayMask = 0;
+  } else if (shift>0) {
+    *bcdValue <<= (4*shift);
+    *displayMask >>= shift;
+  } else if (shift<0) {
+    *bcdValue >>= (4*(-shift));
+    *displayMask <<= (-shift);
+  }
+}
+
+
+// Steps the animation on displayNum if its next frame is due and
+// composes the frame. Returns false once a non-looping animation ends.
+boolean RunDisplayAnimation(byte displayNum, byte animationNum, unsigned long bcdValue) {
+  DisplayAnimation animation;
+  memcpy_P(&animation, &DisplayAnimations[animationNum], sizeof(DisplayAnimation));
+
+  byte numDigits = RPU_MagnitudeOfBCD(bcdValue);
+  if (numDigits<animation.minDigits) numDigits = animation.minDigits;
+  char orderOffset = animation.shiftPerOrder * (char)AnimationDisplayOrder[displayNum];
+
+  if (AnimationRunning[displayNum]!=animationNum) {
+    AnimationRunning[displayNum] = animationNum;
+    AnimationKeyframe[displayNum] = 0;
+    AnimationShift[displayNum] = ResolveAnimationShift(animation.startShift, numDigits, orderOffset);
+    AnimationNextFrame[displayNum] = DisplayFrameClock;
+  }
+
+  if ((long)(DisplayFrameClock - AnimationNextFrame[displayNum]) < 0) return true;
+  AnimationNextFrame[displayNum] = DisplayFrameClock + animation.frameTicks[displayNum];
+
+  if (AnimationKeyframe[displayNum]>=animation.numKeyframes) {
+    // Ran off the end of a one-shot animation
+    if (animation.flags & DISPLAY_ANIMATION_FLAG_CLEAR_AT_END) ComposeDisplay(displayNum, 0, 0x00);
+    return false;
+  }
+
+  DisplayKeyframe *keyframe = &animation.keyframes[AnimationKeyframe[displayNum]];
+  char shift = AnimationShift[displayNum];
+
+  // Compose this frame
+  unsigned long frameValue = bcdValue;
+  byte frameMask = GetDisplayMask(numDigits);
+  ShiftDisplayValue(&frameValue, &frameMask, shift);
+  if ((animation.flags & DISPLAY_ANIMATION_FLAG_MIRROR) && shift<(DISPLAY_NUM_DIGITS/2)) {
+    unsigned long mirrorValue = frameValue;
+    byte mirrorMask = frameMask;
+    ShiftDisplayValue(&mirrorValue, &mirrorMask, DISPLAY_NUM_DIGITS-1-(shift*2));
+    frameValue = RPU_AddBCD(frameValue, mirrorValue);
+    frameMask |= mirrorMask;
+  }
+  if (keyframe->maskOp==DISPLAY_MASK_EVEN_DIGITS) frameMask &= 0x55;
+  else if (keyframe->maskOp==DISPLAY_MASK_ODD_DIGITS) frameMask &= 0xAA;
+  else if (keyframe->maskOp==DISPLAY_MASK_BLANK) frameMask = 0x00;
+  ComposeDisplay(displayNum, frameValue, frameMask, (animation.flags & DISPLAY_ANIMATION_FLAG_COMMAS) ? true : false);
+
+  // Step toward the keyframe's shift, moving on
+  // to the next keyframe when we get there
+  char target = ResolveAnimationShift(keyframe->shift, numDigits, orderOffset);
+  if (shift==target) {
+    AnimationKeyframe[displayNum] += 1;
+    if (AnimationKeyframe[displayNum]>=animation.numKeyframes) {
+      if ((animation.flags & DISPLAY_ANIMATION_FLAG_LOOP)==0) return true;
+      AnimationKeyframe[displayNum] = 0;
     }
-  } else if (numDigits==1 && animationType == DISPLAY_OVERRIDE_SYMMETRIC_BOUNCE) {
-    // Timing varies based on display
-    overrideAnimationSeed = CurrentTime / (100 + (displayNum%2)*38 + (displayNum/2)*20);
+    target = ResolveAnimationShift(animation.keyframes[AnimationKeyframe[displayNum]].shift, numDigits, orderOffset);
+  }
+  if (shift<target) AnimationShift[displayNum] = shift + 1;
+  else if (shift>target) AnimationShift[displayNum] = shift - 1;
 
-    // If the animation frame has changed since last time
-    if (overrideAnimationSeed != LastAnimationSeed[displayNum]) {
-      LastAnimationSeed[displayNum] = overrideAnimationSeed;
+  return true;
+}
 
-      byte numSteps = DISPLAY_NUM_DIGITS - 2 + (DISPLAY_NUM_DIGITS%2);
-      
-      byte shiftDigits = (overrideAnimationSeed)%numSteps;
-      if (shiftDigits > (numSteps/2)) shiftDigits = numSteps - shiftDigits;
-        byte digitCount;
-      displayMask = GetDisplayMask(numDigits);
-      for (digitCount = 0; digitCount < shiftDigits; digitCount++) {
-        displayScore *= 10;
-        displayMask = displayMask >> 1;
-      }
-      unsigned long newScore = displayScore;
-      byte newMask = displayMask;
-      // Now we mirror it
-      if (shiftDigits<(DISPLAY_NUM_DIGITS/2)) {
-        for (digitCount = 0; digitCount < (DISPLAY_NUM_DIGITS-1-(shiftDigits*2)); digitCount++) {
-          displayScore *= 10;
-          displayMask = displayMask >> 1;
-        }
-        newScore += displayScore;
-        newMask |= displayMask;
-      }
-      RPU_SetDisplay(displayNum, newScore, false);
-      RPU_SetDisplayBlank(displayNum, newMask);
+
+// displayScore is packed BCD
+void ShowAnimatedValue(byte displayNum, unsigned long displayScore, byte animationType) {
+  boolean runAnimation = false;
+
+  if (animationType!=DISPLAY_OVERRIDE_ANIMATION_NONE && animationType<DISPLAY_NUM_ANIMATIONS) {
+    byte numDigits = RPU_MagnitudeOfBCD(displayScore);
+    if (numDigits == 0) numDigits = 1;
+    byte minFreeDigits = pgm_read_byte(&DisplayAnimations[animationType].minFreeDigits);
+    byte flags = pgm_read_byte(&DisplayAnimations[animationType].flags);
+    runAnimation = true;
+    if ((DISPLAY_NUM_DIGITS - numDigits) < minFreeDigits) runAnimation = false;
+    if ((flags & DISPLAY_ANIMATION_FLAG_SINGLE_DIGIT) && numDigits!=1) runAnimation = false;
+  }
+
+  if (runAnimation) {
+    if (!RunDisplayAnimation(displayNum, animationType, displayScore)) {
+      ScoreOverrideStatus &= ~(0x01 << displayNum);
     }
   } else {
+    AnimationRunning[displayNum] = DISPLAY_ANIMATION_NONE;
     if (OverrideMask[displayNum]==0xFF) {
-      RPU_SetDisplay(displayNum, displayScore, true, 1);
+      ComposeDisplay(displayNum, displayScore, GetMagnitudeMask(displayScore, 1));
     } else {
-      RPU_SetDisplayBlank(displayNum, OverrideMask[displayNum]);
-      RPU_SetDisplay(displayNum, displayScore, false, 1);
+      ComposeDisplay(displayNum, displayScore, OverrideMask[displayNum]);
     }
   }
 
@@ -276,6 +439,9 @@ void ShowPlayerScore(unsigned long scoreToShow, byte displayToUpdate, boolean fl
   unsigned long displayScore = 0;
   byte scrollPhaseChanged = false;
 
+  // Only the intermittent dash runs on the animation engine here
+  if (dashCurrent!=DISPLAY_DASH_INTERMITTENT_FLASH) AnimationRunning[displayToUpdate] = DISPLAY_ANIMATION_NONE;
+
   byte scrollPhase = ((CurrentTime - LastTimeScoreChanged) / 125) % 16;
   if (scrollPhase != LastScrollPhase[displayToUpdate]) {
     LastScrollPhase[displayToUpdate] = scrollPhase;
@@ -292,12 +458,11 @@ void ShowPlayerScore(unsigned long scoreToShow, byte displayToUpdate, boolean fl
     // Score needs to be scrolled
     if ((CurrentTime - LastTimeScoreChanged) < 2000) {
       // show score for four seconds after change
-      RPU_SetDisplay(displayToUpdate, displayScore % (RPU_OS_MAX_DISPLAY_SCORE + 1), false);
       byte blank = RPU_OS_ALL_DIGITS_MASK;
       if (showingCurrentAchievement && (CurrentTime / 200) % 2) {
         blank &= ~(0x01 << (DISPLAY_NUM_DIGITS - 1));
       }
-      RPU_SetDisplayBlank(displayToUpdate, blank);
+      ComposeDisplay(displayToUpdate, ScoreToBCD(displayToUpdate, displayScore) & DISPLAY_BCD_DIGITS_MASK, blank);
     } else {
       // Scores are scrolled 10 digits and then we wait for 6
       if (scrollPhase < 11 && scrollPhaseChanged) {
@@ -325,17 +490,17 @@ void ShowPlayerScore(unsigned long scoreToShow, byte displayToUpdate, boolean fl
           displayMask |= GetDisplayMask(Display_MagnitudeOfScore(tempScore));
           displayScore += tempScore;
         }
-        RPU_SetDisplayBlank(displayToUpdate, displayMask);
-        RPU_SetDisplay(displayToUpdate, displayScore);
+        ComposeDisplay(displayToUpdate, RPU_ConvertToBCD(displayScore), displayMask);
       }
     }
   } else {
+    unsigned long displayBCD = ScoreToBCD(displayToUpdate, displayScore);
     if (flashCurrent) {
       unsigned long flashSeed = CurrentTime / 250;
       if (flashSeed != LastFlashOrDash) {
         LastFlashOrDash = flashSeed;
-        if (((CurrentTime / 250) % 2) == 0) RPU_SetDisplayBlank(displayToUpdate, 0x00);
-        else RPU_SetDisplay(displayToUpdate, displayScore, true, 2, true);
+        if (((CurrentTime / 250) % 2) == 0) ComposeDisplayMask(displayToUpdate, 0x00);
+        else ComposeDisplay(displayToUpdate, displayBCD, GetMagnitudeMask(displayBCD, 2), true);
       }
     } else if (dashCurrent) {
       if (dashCurrent==DISPLAY_DASH_ROLLING_BLANK) {
@@ -343,7 +508,7 @@ void ShowPlayerScore(unsigned long scoreToShow, byte displayToUpdate, boolean fl
         if (dashSeed != LastFlashOrDash) {
           LastFlashOrDash = dashSeed;
           byte dashPhase = (CurrentTime / 60) % (2 * DISPLAY_NUM_DIGITS * 3);
-          byte numDigits = Display_MagnitudeOfScore(displayScore);
+          byte numDigits = RPU_MagnitudeOfBCD(displayBCD);
           if (dashPhase < (2 * DISPLAY_NUM_DIGITS)) {
             displayMask = GetDisplayMask((numDigits == 0) ? 2 : numDigits);
             if (dashPhase < (DISPLAY_NUM_DIGITS + 1)) {
@@ -357,30 +522,20 @@ void ShowPlayerScore(unsigned long scoreToShow, byte displayToUpdate, boolean fl
                 displayMask &= ~(firstDigit >> (maskCount - dashPhase - 1));
               }
             }
-            RPU_SetDisplay(displayToUpdate, displayScore);
-            RPU_SetDisplayBlank(displayToUpdate, displayMask);
+            ComposeDisplay(displayToUpdate, displayBCD, displayMask);
           } else {
-            RPU_SetDisplay(displayToUpdate, displayScore, true, 2, true);
+            ComposeDisplay(displayToUpdate, displayBCD, GetMagnitudeMask(displayBCD, 2), true);
           }
         }
       } else if (dashCurrent==DISPLAY_DASH_INTERMITTENT_FLASH) {
-        unsigned long dashSeed = (CurrentTime / 250)%4;
-        if (dashSeed != LastFlashOrDash) {
-          LastFlashOrDash = dashSeed;
-          if (dashSeed) {
-            RPU_SetDisplay(displayToUpdate, displayScore, true, 2, true);
-          } else {
-            RPU_SetDisplayBlank(displayToUpdate, 0x00);
-          }
-        }
+        RunDisplayAnimation(displayToUpdate, DISPLAY_ANIMATION_DASH_INTERMITTENT, displayBCD);
       }
     } else {
-      byte blank;
-      blank = RPU_SetDisplay(displayToUpdate, displayScore, false, 2, true);
+      byte blank = GetMagnitudeMask(displayBCD, 2);
       if (showingCurrentAchievement && (CurrentTime / 200) % 2) {
         blank &= ~(0x01 << (DISPLAY_NUM_DIGITS - 1));
       }
-      RPU_SetDisplayBlank(displayToUpdate, blank);
+      ComposeDisplay(displayToUpdate, displayBCD, blank, true);
     }
   }
 
@@ -430,86 +585,111 @@ void Display_StartScoreAnimation(unsigned long scoreToAnimate, boolean playTick,
   
 }
 
-unsigned long pow10[10] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
-
 #define MILLISECONDS_PER_FRAME  80
+
+// ShowOtherScores cycles through the other players: their player
+// number wipes across and back, the top of the score scrolls in,
+// and the full score holds for 12 frames. The score is converted to
+// BCD once per player, and each frame is worked out from that and
+// the frame number when the frame changes, so only the frame being
+// shown is kept.
+#define OTHER_SCORES_HOLD_FRAMES    12
+#define OTHER_SCORES_WIPE_FRAMES    ((DISPLAY_NUM_DIGITS*2)-2)
+
+byte OtherScoresPlayer = 0;
+byte OtherScoresFrame = 0;
+byte OtherScoresNumDigits = 0;
+unsigned long OtherScoresBCD = 0;
+unsigned long OtherScoresFrameValue = 0;
+byte OtherScoresFrameMask = 0x00;
 byte LastOtherScoresPhaseShown = 0xFF;
+byte OtherScoresBuiltForPlayer = 0xFF;
+byte OtherScoresBuiltForNumPlayers = 0;
+unsigned long OtherScoresBuiltForScores[RPU_NUMBER_OF_PLAYERS_ALLOWED];
+
+
+void StartOtherScoresPlayer(byte displayPlayer) {
+  OtherScoresPlayer = displayPlayer;
+  OtherScoresFrame = 0;
+  OtherScoresNumDigits = Display_MagnitudeOfScore(CurrentScores[displayPlayer]);
+  if (OtherScoresNumDigits==0) OtherScoresNumDigits = 2;
+  // Converted once - every frame after this is a shift of it
+  OtherScoresBCD = RPU_ConvertToBCD(CurrentScores[displayPlayer]);
+}
+
+
+byte GetOtherScoresNumFrames() {
+  // Wipe, player number with the first digit, then the scroll
+  // and hold (a one-digit score goes straight to the hold)
+  return OTHER_SCORES_WIPE_FRAMES + OtherScoresNumDigits + OTHER_SCORES_HOLD_FRAMES;
+}
+
+
+void SetOtherScoresFrame() {
+  byte displayPlayer = OtherScoresPlayer;
+  byte frame = OtherScoresFrame;
+
+  if (frame<OTHER_SCORES_WIPE_FRAMES) {
+    // Player number wipes in from the right and back out
+    byte numDigitsToShow = (frame<DISPLAY_NUM_DIGITS) ? (frame+1) : (2*DISPLAY_NUM_DIGITS - (1+frame));
+    OtherScoresFrameValue = RPU_MultiplyBCD(0x11111111 & DISPLAY_BCD_DIGITS_MASK, displayPlayer+1);
+    OtherScoresFrameMask = (0x01 << numDigitsToShow) - 1;
+  } else if (frame==OTHER_SCORES_WIPE_FRAMES) {
+    // Player number on the left, first digit of the score on the right
+    OtherScoresFrameValue = ((unsigned long)(displayPlayer+1)) << (4*(DISPLAY_NUM_DIGITS-1));
+    OtherScoresFrameValue |= (OtherScoresBCD >> (4*(OtherScoresNumDigits-1))) & 0x0F;
+    OtherScoresFrameMask = 0x01 | (0x80 >> (8-DISPLAY_NUM_DIGITS));
+  } else {
+    // Score scrolls in a digit at a time, and the full score holds
+    byte shownDigits = 2 + (frame - (OTHER_SCORES_WIPE_FRAMES+1));
+    if (shownDigits>OtherScoresNumDigits) shownDigits = OtherScoresNumDigits;
+    OtherScoresFrameValue = (OtherScoresBCD >> (4*(OtherScoresNumDigits-shownDigits))) & DISPLAY_BCD_DIGITS_MASK;
+    OtherScoresFrameMask = GetMagnitudeMask(OtherScoresFrameValue, 2);
+  }
+}
+
+
+byte GetNextOtherPlayer(byte displayPlayer) {
+  do {
+    displayPlayer += 1;
+    if (displayPlayer>=CurrentNumPlayers) displayPlayer = 0;
+  } while (displayPlayer==CurrentPlayer);
+  return displayPlayer;
+}
+
 
 void ShowOtherScores(byte displayNum) {
   if (CurrentNumPlayers<3) return;
 
-  byte frameCheck = (CurrentTime / MILLISECONDS_PER_FRAME);
+  boolean rebuild = (CurrentPlayer!=OtherScoresBuiltForPlayer || CurrentNumPlayers!=OtherScoresBuiltForNumPlayers);
+  for (byte count=0; count<CurrentNumPlayers && !rebuild; count++) {
+    if (count!=CurrentPlayer && CurrentScores[count]!=OtherScoresBuiltForScores[count]) rebuild = true;
+  }
+  if (rebuild) {
+    // Start over with the first player that isn't up
+    OtherScoresBuiltForPlayer = CurrentPlayer;
+    OtherScoresBuiltForNumPlayers = CurrentNumPlayers;
+    for (byte count=0; count<CurrentNumPlayers; count++) OtherScoresBuiltForScores[count] = CurrentScores[count];
+    StartOtherScoresPlayer(GetNextOtherPlayer(0xFF));
+    SetOtherScoresFrame();
+  }
 
+  byte frameCheck = (CurrentTime / MILLISECONDS_PER_FRAME);
   if (frameCheck != LastOtherScoresPhaseShown) {
+    // Step forward however many frames have gone by
+    byte framesToAdvance = (LastOtherScoresPhaseShown==0xFF || rebuild) ? 0 : (byte)(frameCheck - LastOtherScoresPhaseShown);
     LastOtherScoresPhaseShown = frameCheck;
-  
-    // Each score will have this many phases:
-    // (DISPLAY_NUM_DIGITS +  (DISPLAY_NUM_DIGITS-2)) to show the player num wipe left to right and then right to left.
-    // With two digits remaining, the score will begin to scroll in
-    // up to 9 digits to show the score up to 999,999,999 
-    // calculated by Display_MagnitudeOfScore
-    byte numPhases = 0;
-    byte playerNumPhases[4];
-    byte numDigitsForScore[4];
-    for (byte count=0; count<CurrentNumPlayers; count++) {
-      if (count==CurrentPlayer) {
-        playerNumPhases[count] = 0;
-        numDigitsForScore[count] = 2;
-        continue;      
-      }
-      byte scoreNumDigits = Display_MagnitudeOfScore(CurrentScores[count]);
-      if (scoreNumDigits==0) scoreNumDigits = 2;
-      numDigitsForScore[count] = scoreNumDigits;
-      playerNumPhases[count] = ((DISPLAY_NUM_DIGITS*2)-2 + scoreNumDigits) + 12;
-      
-      numPhases += playerNumPhases[count];
-    }
-  
-    // This function will cycle through player numbers & scores in the given display
-    //unsigned long fullCycleMS = ((unsigned long)numPhases) * 80;
-    byte currentPhase = (CurrentTime/MILLISECONDS_PER_FRAME)%numPhases;
-  
-    byte displayPlayer = 0;
-    for (displayPlayer = 0; displayPlayer < CurrentNumPlayers; displayPlayer++) {
-      if (currentPhase >= playerNumPhases[displayPlayer]) {
-        currentPhase -= playerNumPhases[displayPlayer];
-      } else {
-        break;
-      }
-    }
-
-    byte displayMask = 0x00;
-    if (currentPhase<((DISPLAY_NUM_DIGITS*2)-2)) {
-      unsigned long playerNumRepeated = (RPU_OS_MAX_DISPLAY_SCORE/9) * (displayPlayer+1);
-      byte numDigitsToShow = 0;
-      if (currentPhase<DISPLAY_NUM_DIGITS) {
-        numDigitsToShow = currentPhase+1;
-      } else {
-        numDigitsToShow = 2*DISPLAY_NUM_DIGITS - (1+currentPhase);
-      }
-      for (byte count=0; count<numDigitsToShow; count++) {
-        displayMask *= 2;
-        displayMask |= 1;
+    if (framesToAdvance) {
+      while (framesToAdvance) {
+        OtherScoresFrame += 1;
+        if (OtherScoresFrame>=GetOtherScoresNumFrames()) StartOtherScoresPlayer(GetNextOtherPlayer(OtherScoresPlayer));
+        framesToAdvance -= 1;
       }
-      RPU_SetDisplayBlank(displayNum, displayMask);
-      RPU_SetDisplay(displayNum, playerNumRepeated, false, 1);
-    } else if (currentPhase==((DISPLAY_NUM_DIGITS*2)-2)) {
-      byte displayMask = 0x01;
-      displayMask |= (0x80 >> (8-DISPLAY_NUM_DIGITS));
-      unsigned long scoreToShow = (displayPlayer+1) * (unsigned long)pow10[DISPLAY_NUM_DIGITS-1];
-      scoreToShow += (CurrentScores[displayPlayer] / ((unsigned long)pow10[numDigitsForScore[displayPlayer]-1]));
-      RPU_SetDisplay(displayNum, scoreToShow, false, 1);
-      RPU_SetDisplayBlank(displayNum, displayMask);
-    } else if (currentPhase < (playerNumPhases[displayPlayer]-12)) {
-      unsigned long scoreToShow = CurrentScores[displayPlayer];
-      unsigned long scoreDivisor = (unsigned long)pow10[numDigitsForScore[displayPlayer] - 2 - (currentPhase-11)];
-      scoreToShow /= scoreDivisor;
-      RPU_SetDisplay(displayNum, scoreToShow, true, 2);
-    } else {
-      RPU_SetDisplay(displayNum, CurrentScores[displayPlayer], true, 2);      
+      SetOtherScoresFrame();
     }
   }
-    
+
+  ComposeDisplay(displayNum, OtherScoresFrameValue, OtherScoresFrameMask);
 }
 
 unsigned long LastScoreReport = 0;
@@ -520,77 +700,228 @@ unsigned long LastScoreReport = 0;
 
 byte DMD_DisplayNumToID[] = {0x0A, 0x0B, 0x0C, 0x0D, 0x0E};
 
-void DMD_FlushEventBuffer(byte displayID) {
-  Wire.beginTransmission(displayID);
+// DMD transaction queue
+// Display writes are queued and sent one transaction per
+// Display_UpdateDisplays pass instead of waiting on the bus
+// for each call. A text write or flush that hasn't gone out
+// yet is replaced by a newer one to the same display.
+#define DMD_QUEUE_SIZE                  16
+#define DMD_MAX_TRANSACTION_LENGTH      24
+#define DMD_NUM_DISPLAY_IDS             5
+#define DMD_FIRST_DISPLAY_ID            0x0A
+
+#define DMD_COMMAND_SET_INTENSITY       0x03
+#define DMD_COMMAND_WRITE_TEXT          0x02
+#define DMD_COMMAND_BALLY_INTERFACE     0x06
+#define DMD_COMMAND_SEND_EVENT          0x07
+#define DMD_COMMAND_FLUSH_EVENTS        0x08
+// Partial text write (displays that support it, see
+// RPU_DMD_PARTIAL_TEXT_WRITES):
+//   0x09, offset, count, count characters
+// Overwrites count characters of the current text starting
+// at offset. The length of the text doesn't change.
+#define DMD_COMMAND_WRITE_TEXT_AT       0x09
+#define DMD_SHADOW_INVALID              0xFF
+
+struct DMDTransaction {
+  byte displayID;
+  byte length;
+  byte data[DMD_MAX_TRANSACTION_LENGTH];
+};
+
+DMDTransaction DMDQueue[DMD_QUEUE_SIZE];
+byte DMDQueueFirst = 0;
+byte DMDQueueLast = 0;
+unsigned short DMDNackCount[DMD_NUM_DISPLAY_IDS];
+unsigned short DMDErrorCount[DMD_NUM_DISPLAY_IDS];
+unsigned short DMDDroppedCount = 0;
+unsigned short DMDBytesSaved = 0;
+boolean DMDBusStarted = false;
+
+// The last text sent to each display, so an unchanged text
+// isn't resent and a changed one can be sent as a partial write
+char DMDShadowText[DMD_NUM_DISPLAY_IDS][DMD_MAX_TRANSACTION_LENGTH];
+byte DMDShadowLength[DMD_NUM_DISPLAY_IDS] = {DMD_SHADOW_INVALID, DMD_SHADOW_INVALID, DMD_SHADOW_INVALID, DMD_SHADOW_INVALID, DMD_SHADOW_INVALID};
+
+
+boolean DMDCommandIsMergeable(byte command) {
+  return (command==DMD_COMMAND_WRITE_TEXT || command==DMD_COMMAND_FLUSH_EVENTS);
+}
 
-  // Flush Event Buffer
-  Wire.write(0x08);
-  Wire.write(0x00);
-  
-  Wire.endTransmission();
+
+DMDTransaction *DMD_FindPendingTransaction(byte displayID) {
+  byte queuePos = DMDQueueLast;
+  while (queuePos!=DMDQueueFirst) {
+    queuePos = (queuePos==0) ? (DMD_QUEUE_SIZE-1) : (queuePos-1);
+    if (DMDQueue[queuePos].displayID==displayID) return &DMDQueue[queuePos];
+  }
+  return NULL;
 }
 
-void DMD_InitDisplay(byte displayID) {
 
-  Wire.beginTransmission(displayID);
+boolean DMD_QueueTransaction(byte displayID, const byte *data, byte length) {
+  if (length==0 || length>DMD_MAX_TRANSACTION_LENGTH) return false;
+
+  // The newest transaction still waiting for this display
+  // is overwritten if it's the same kind of write
+  DMDTransaction *transaction = DMD_FindPendingTransaction(displayID);
+  if (transaction==NULL || transaction->data[0]!=data[0] || !DMDCommandIsMergeable(data[0])) {
+    byte nextLast = DMDQueueLast + 1;
+    if (nextLast >= DMD_QUEUE_SIZE) nextLast = 0;
+    if (nextLast==DMDQueueFirst) {
+      DMDDroppedCount += 1;
+      return false;
+    }
+    transaction = &DMDQueue[DMDQueueLast];
+    DMDQueueLast = nextLast;
+  }
+
+  transaction->displayID = displayID;
+  transaction->length = length;
+  memcpy(transaction->data, data, length);
+  return true;
+}
+
+
+// Turns a queued full-text write into whatever actually needs
+// to go out: nothing, a partial write, or the full text.
+// Returns the number of bytes to send from sendBuf.
+byte DMD_EncodeTextUpdate(DMDTransaction *transaction, byte *sendBuf) {
+  byte idIndex = transaction->displayID - DMD_FIRST_DISPLAY_ID;
+  // Text is data[1] up to the terminator
+  byte textLength = transaction->length - 2;
+  const char *text = (const char *)(transaction->data + 1);
+
+  if (idIndex>=DMD_NUM_DISPLAY_IDS) {
+    memcpy(sendBuf, transaction->data, transaction->length);
+    return transaction->length;
+  }
+
+  if (DMDShadowLength[idIndex]==textLength) {
+    byte firstChange = 0;
+    while (firstChange<textLength && text[firstChange]==DMDShadowText[idIndex][firstChange]) firstChange += 1;
+    if (firstChange==textLength) {
+      DMDBytesSaved += transaction->length;
+      return 0;
+    }
+#ifdef RPU_DMD_PARTIAL_TEXT_WRITES
+    byte lastChange = textLength - 1;
+    while (text[lastChange]==DMDShadowText[idIndex][lastChange]) lastChange -= 1;
+    byte changeLength = (lastChange - firstChange) + 1;
+    if ((changeLength+3) < transaction->length) {
+      sendBuf[0] = DMD_COMMAND_WRITE_TEXT_AT;
+      sendBuf[1] = firstChange;
+      sendBuf[2] = changeLength;
+      memcpy(sendBuf + 3, text + firstChange, changeLength);
+      memcpy(DMDShadowText[idIndex] + firstChange, text + firstChange, changeLength);
+      DMDBytesSaved += transaction->length - (changeLength+3);
+      return changeLength + 3;
+    }
+#endif
+  }
+
+  memcpy(DMDShadowText[idIndex], text, textLength);
+  DMDShadowLength[idIndex] = textLength;
+  memcpy(sendBuf, transaction->data, transaction->length);
+  return transaction->length;
+}
+
+
+void DMD_ServiceQueue() {
+  if (DMDQueueFirst==DMDQueueLast) return;
+
+  if (!DMDBusStarted) {
+    DMDBusStarted = true;
+    Wire.begin();
+#ifdef WIRE_HAS_TIMEOUT
+    // Don't let a display holding the clock hang the game
+    Wire.setWireTimeout(3000, true);
+#endif
+  }
+
+  DMDTransaction *transaction = &DMDQueue[DMDQueueFirst];
+  byte idIndex = transaction->displayID - DMD_FIRST_DISPLAY_ID;
+  byte sendBuf[DMD_MAX_TRANSACTION_LENGTH];
+  byte sendLength = transaction->length;
+
+  if (transaction->data[0]==DMD_COMMAND_WRITE_TEXT) {
+    sendLength = DMD_EncodeTextUpdate(transaction, sendBuf);
+  } else {
+    memcpy(sendBuf, transaction->data, sendLength);
+    // Re-initializing the display clears its text
+    if (transaction->data[0]==DMD_COMMAND_BALLY_INTERFACE && idIndex<DMD_NUM_DISPLAY_IDS) DMDShadowLength[idIndex] = DMD_SHADOW_INVALID;
+  }
+
+  if (sendLength) {
+    Wire.beginTransmission(transaction->displayID);
+    Wire.write(sendBuf, sendLength);
+    byte result = Wire.endTransmission();
+
+    if (result && idIndex<DMD_NUM_DISPLAY_IDS) {
+      // 2 & 3 are NACKs on the address and data
+      if (result==2 || result==3) DMDNackCount[idIndex] += 1;
+      else DMDErrorCount[idIndex] += 1;
+      // We don't know what the display has now
+      DMDShadowLength[idIndex] = DMD_SHADOW_INVALID;
+    }
+  }
+
+  DMDQueueFirst += 1;
+  if (DMDQueueFirst >= DMD_QUEUE_SIZE) DMDQueueFirst = 0;
+}
+
+
+void Display_GetDMDErrorCounts(byte displayNum, unsigned short *nackCount, unsigned short *errorCount, unsigned short *droppedCount) {
+  byte idIndex = (displayNum<5) ? (DMD_DisplayNumToID[displayNum] - DMD_FIRST_DISPLAY_ID) : 0;
+  if (nackCount) *nackCount = DMDNackCount[idIndex];
+  if (errorCount) *errorCount = DMDErrorCount[idIndex];
+  if (droppedCount) *droppedCount = DMDDroppedCount;
+}
+
+
+unsigned short Display_GetDMDBytesSaved() {
+  return DMDBytesSaved;
+}
+
+
+void DMD_FlushEventBuffer(byte displayID) {
+  byte data[2] = {DMD_COMMAND_FLUSH_EVENTS, 0x00};
+  DMD_QueueTransaction(displayID, data, 2);
+}
+
+void DMD_InitDisplay(byte displayID) {
   // Turn Bally Interface Off
-  Wire.write(0x06);
-  Wire.write(0x00);
-  Wire.write(0x00);
-  Wire.endTransmission();
+  byte interfaceOff[3] = {DMD_COMMAND_BALLY_INTERFACE, 0x00, 0x00};
+  DMD_QueueTransaction(displayID, interfaceOff, 3);
 
   // Flush Event Buffer
-  Wire.beginTransmission(displayID);
-  Wire.write(0x08);
-  Wire.write(0x00);
-  Wire.endTransmission();
+  DMD_FlushEventBuffer(displayID);
 
   // Turn off intensity control
-  Wire.beginTransmission(displayID);
-  Wire.write(0x03);
-  Wire.write(0x00);
-  Wire.write(0x00);
-  Wire.write(0x00);  
-  Wire.endTransmission();
+  byte intensityOff[4] = {DMD_COMMAND_SET_INTENSITY, 0x00, 0x00, 0x00};
+  DMD_QueueTransaction(displayID, intensityOff, 4);
 }
 
 void DMD_BlankDisplayTemporarily(byte displayID, byte milliseconds) {
-
-  Wire.beginTransmission(displayID);
-  Wire.write(0x07); // send Event
-  Wire.write(0x0B); // blank event
-  Wire.write(milliseconds); // number of ms to blank
-  Wire.write(0x20);
-  Wire.write(0x01);
-  Wire.write(0xFF);
-  
-  Wire.endTransmission();
-
+  byte data[6] = {DMD_COMMAND_SEND_EVENT, 0x0B, milliseconds, 0x20, 0x01, 0xFF}; // blank event for milliseconds
+  DMD_QueueTransaction(displayID, data, 6);
 }
 
 void DMD_RollBlank(byte displayID) {
-
-  Wire.beginTransmission(displayID);
-  Wire.write(0x07); // send Event
-  Wire.write(0x0A); // blank event
-  Wire.write(0x03); 
-  Wire.write(0x00);
-  Wire.write(0x01);
-  Wire.write(0xFF);
-  
-  Wire.endTransmission();
-
+  byte data[6] = {DMD_COMMAND_SEND_EVENT, 0x0A, 0x03, 0x00, 0x01, 0xFF}; // roll blank event
+  DMD_QueueTransaction(displayID, data, 6);
 }
 
 
 // Version that uses Wire library to talk to i2c-connected displays
 void DMD_WriteDisplay(byte displayID, unsigned long numberValue, byte blankDigit = 0xFF) {
-  Wire.beginTransmission(displayID);
-  Wire.write(0x02);
+  byte data[DMD_MAX_TRANSACTION_LENGTH];
+  byte length = 0;
+  data[length++] = DMD_COMMAND_WRITE_TEXT;
 
   if (numberValue==0) {
-    Wire.write(0x30);
-    Wire.write(0x30);
+    data[length++] = 0x30;
+    data[length++] = 0x30;
   }
   char backwardsBuf[32];
   byte backwardsBufSize = 0;
@@ -601,27 +932,29 @@ void DMD_WriteDisplay(byte displayID, unsigned long numberValue, byte blankDigit
   }
 
   for (byte count=0; count<backwardsBufSize; count++) {
-    if (blankDigit!=0xFF && count==blankDigit) Wire.write(0x20);
-    else Wire.write(backwardsBuf[(backwardsBufSize-1)-count]);
+    if (blankDigit!=0xFF && count==blankDigit) data[length++] = 0x20;
+    else data[length++] = backwardsBuf[(backwardsBufSize-1)-count];
   }
 
-  Wire.write(0x00);
-  Wire.endTransmission();
+  data[length++] = 0x00;
+  DMD_QueueTransaction(displayID, data, length);
 }
 
 // Version that uses Wire library to talk to i2c-connected displays
 void DMD_WriteDisplay(byte displayID, const char *message) {
   if (message==NULL) return;
-  
-  Wire.beginTransmission(displayID);
+
+  byte data[DMD_MAX_TRANSACTION_LENGTH];
+  byte length = 0;
   byte messageIndex = 0;
-  Wire.write(0x02);
-  while (message[messageIndex]!=0x00 && message[messageIndex]!='\n' && message[messageIndex]!='\r') {
-    Wire.write(message[messageIndex]);
+  data[length++] = DMD_COMMAND_WRITE_TEXT;
+  // Leave room for the terminator
+  while (message[messageIndex]!=0x00 && message[messageIndex]!='\n' && message[messageIndex]!='\r' && length<(DMD_MAX_TRANSACTION_LENGTH-1)) {
+    data[length++] = message[messageIndex];
     messageIndex += 1;
   }
-  Wire.write(0x00);
-  Wire.endTransmission();
+  data[length++] = 0x00;
+  DMD_QueueTransaction(displayID, data, length);
 }
 
 // Version that uses Wire library to talk to i2c-connected displays
@@ -633,7 +966,7 @@ void Display_OverrideScoreDisplay(byte displayNum, const char *message, byte ani
   ScoreAnimation[displayNum] = animateEffect;
 //  ScoreOverrideValue[displayNum] = value;
   DMD_WriteDisplay(DMD_DisplayNumToID[displayNum], message);
-  LastAnimationSeed[displayNum] = 255;
+  AnimationRunning[displayNum] = DISPLAY_ANIMATION_NONE;
   OverrideMask[displayNum] = overrideMask;
   
 }
@@ -669,11 +1002,12 @@ byte Display_UpdateDisplays(byte displayNum, boolean finishAnimation, boolean fl
 
   if (LastTimeScoreSent==0) {
     LastTimeScoreSent = 1;
-    Wire.begin();
     DMD_InitDisplay(DMD_DisplayNumToID[0]);
     DMD_InitDisplay(DMD_DisplayNumToID[1]);
     DMD_InitDisplay(DMD_DisplayNumToID[2]);
     DMD_InitDisplay(DMD_DisplayNumToID[3]);
+    // Send the init sequence before anything else is queued
+    while (DMDQueueFirst!=DMDQueueLast) DMD_ServiceQueue();
     DMD_WriteDisplay(DMD_DisplayNumToID[0], "Trident");
     DMD_WriteDisplay(DMD_DisplayNumToID[1], "Version: 2025");
     DMD_WriteDisplay(DMD_DisplayNumToID[2], "RPU");
@@ -732,6 +1066,7 @@ byte Display_UpdateDisplays(byte displayNum, boolean finishAnimation, boolean fl
   
     }
   }
+  DMD_ServiceQueue();
   return playTick;  
 }
 
@@ -745,17 +1080,21 @@ void Display_SetDisplayVisible(byte displayNum, boolean visible, unsigned long s
   if (displayNum>=RPU_NUMBER_OF_PLAYER_DISPLAYS) return;
 
   if (visible) {
-    if (setScore==0xFFFFFFFF) RPU_SetDisplay(displayNum, CurrentScores[displayNum]);
-    else RPU_SetDisplay(displayNum, CurrentScores[displayNum], true, 2, true);
+    unsigned long scoreBCD = ScoreToBCD(displayNum, CurrentScores[displayNum]);
+    if (setScore==0xFFFFFFFF) ComposeDisplay(displayNum, scoreBCD, RPU_GetDisplayBlank(displayNum));
+    else ComposeDisplay(displayNum, scoreBCD, GetMagnitudeMask(scoreBCD, 2), true);
   } else {
-    RPU_SetDisplayBlank(displayNum, 0x00);
+    ComposeDisplayMask(displayNum, 0x00);
   }
+  CommitComposedDisplays();
 }
 
 // Version that uses RPU libraries to talk to MPU-connected dislays:
 byte Display_UpdateDisplays(byte displayNum, boolean finishAnimation, boolean flashCurrent, byte dashCurrent, unsigned long allScoresShowValue) {
   boolean playTick = 0;
 
+  Display_UpdateFrameClock();
+
   if (finishAnimation) {
     CurrentScores[CurrentPlayer] += ScoreAdditionAnimation;
     ScoreAdditionAnimationStartTime = 0;
@@ -789,17 +1128,17 @@ byte Display_UpdateDisplays(byte displayNum, boolean finishAnimation, boolean fl
           byte scoreAnimationPhase = (CurrentTime - ScoreAdditionAnimationStartTime) / 100;
           if (scoreAnimationPhase!=ScoreAdditionLastPhase) {
             if ((scoreAnimationPhase%2)==0) {
-              RPU_SetDisplayBlank(displayCount, 0x00);
+              ComposeDisplayMask(displayCount, 0x00);
             } else {
               playTick = 1;
-              unsigned long scoreToShow = ScoreAdditionAnimation;
+              unsigned long scoreToShow = RPU_ConvertToBCD(ScoreAdditionAnimation);
               if (scoreToShow) {
-                byte numberOfDigits = Display_MagnitudeOfScore(scoreToShow);
+                byte numberOfDigits = RPU_MagnitudeOfBCD(scoreToShow);
                 if (scoreAnimationPhase<((numberOfDigits-1)*2)) {
-                  scoreToShow /= (unsigned long)(pow10[numberOfDigits - 1 - (scoreAnimationPhase/2)]);
+                  scoreToShow >>= 4*(numberOfDigits - 1 - (scoreAnimationPhase/2));
                 }
               }
-              RPU_SetDisplay(displayCount, scoreToShow, true, 1);
+              ComposeDisplay(displayCount, scoreToShow, GetMagnitudeMask(scoreToShow, 1));
               
             }
             ScoreAdditionLastPhase = scoreAnimationPhase;
@@ -839,11 +1178,10 @@ byte Display_UpdateDisplays(byte displayNum, boolean finishAnimation, boolean fl
       
     } else if (ScoreOverrideStatus & (0x01<<displayCount))  {
       // Show override value
-      unsigned long displayScore = ScoreOverrideValue[displayCount];
-      if (displayScore != DISPLAY_OVERRIDE_BLANK_SCORE) {
-        ShowAnimatedValue(displayCount, displayScore, ScoreAnimation[displayCount]);
+      if (ScoreOverrideValue[displayCount] != DISPLAY_OVERRIDE_BLANK_SCORE) {
+        ShowAnimatedValue(displayCount, ScoreOverrideBCD[displayCount], ScoreAnimation[displayCount]);
       } else {
-        RPU_SetDisplayBlank(displayCount, 0);
+        ComposeDisplayMask(displayCount, 0x00);
       }
     } else {
 
@@ -852,7 +1190,7 @@ byte Display_UpdateDisplays(byte displayNum, boolean finishAnimation, boolean fl
         ShowPlayerScore(allScoresShowValue, displayCount);
       } else if (CurrentNumPlayers && displayCount>(CurrentNumPlayers-1)) {
         // We're not showing a high score and there is no player this high, so blank the display
-        RPU_SetDisplayBlank(displayCount, 0x00);
+        ComposeDisplayMask(displayCount, 0x00);
       } else if (CurrentNumPlayers <= DISPLAY_NUMBER_OF_PLAYER_DISPLAYS) {
         // No need to juggle anything because all the player scores will
         // fit on the number of displays we have
@@ -877,6 +1215,7 @@ byte Display_UpdateDisplays(byte displayNum, boolean finishAnimation, boolean fl
     
   }
 
+  CommitComposedDisplays();
   return playTick;
 }
 #endif
@@ -25,12 +25,16 @@ void Display_SetAnimationDisplayOrder(byte disp0, byte disp1, byte disp2, byte d
 void Display_OverrideScoreDisplay(byte displayNum, unsigned long value, byte animationType, byte overrideMask = 0xFF);
 #ifdef RPU_DMD_DISPLAYS
 void Display_OverrideScoreDisplay(byte displayNum, const char *message, byte animateEffect, byte overrideMask = 0xFF);
+void Display_GetDMDErrorCounts(byte displayNum, unsigned short *nackCount, unsigned short *errorCount, unsigned short *droppedCount = NULL);
+unsigned short Display_GetDMDBytesSaved();
 #endif
 void Display_ClearOverride(byte displayNum = 0xFF);
+void Display_InvalidateDisplays(byte displayNum = 0xFF);
 void Display_StartScoreAnimation(unsigned long scoreAdditionValue, boolean playTick, byte animationType=DISPLAY_JACKPOT_ANIMATION_ROLLING);
 //void Display_ShowflybyValue(byte numToShow, unsigned long timeBase);
 
 void Display_SetLastTimeScoreChanged(unsigned long scoreChangedTime);
 unsigned long Display_GetLastTimeScoreChanged();
+void Display_UpdateFrameClock();
 byte Display_UpdateDisplays(byte displayNum = 0xFF, boolean finishAnimation = false, boolean flashCurrent = false, byte dashCurrent = false, unsigned long allScoresShowValue = 0xFFFFFFFF);
 void Display_SetDisplayVisible(byte displayNum, boolean visible, unsigned long setScore = 0xFFFFFFFF, byte blankDigit = 0xFF);
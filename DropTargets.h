@@ -10,6 +10,29 @@
 #define DROP_TARGET_TYPE_WLLMS_2        4   // no solenoids to drop/reset individual, one switch per target
 #define DROP_TARGET_TYPE_HOMEPIN_1      5   // no solenoids to drop individual targets, one switch per target
 
+// Every bank registers its switches in one switch-indexed table,
+// so a switch can be routed to its bank (and target) without
+// asking each bank in turn. Entries are (bank+1)<<4 | target, and
+// 0 means the switch isn't a drop target.
+#define DROP_TARGET_MAX_BANKS           8
+#define DROP_TARGET_ALL_TARGETS_SWITCH  0x08
+// Room for every switch number on any MPU (switch bytes are at most 8)
+#define DROP_TARGET_NUM_SWITCHES        64
+
+class DropTargetBank;
+DropTargetBank *DropTargetBanks[DROP_TARGET_MAX_BANKS];
+byte NumDropTargetBanks = 0;
+byte DropTargetSwitchLookup[DROP_TARGET_NUM_SWITCHES];
+
+// Consecutive targets on consecutive switches (in the same switch
+// byte) are read together with one shift and mask
+struct DropTargetSwitchRun {
+  byte switchByte;
+  byte switchShift;
+  byte targetShift;
+  byte mask;
+};
+
 class DropTargetBank
 {
   public:
@@ -25,6 +48,12 @@ class DropTargetBank
     byte GetStatus(boolean readSwitches = true);
 
   private:
+    void RegisterSwitch(byte switchNum, byte target);
+    void BuildSwitchRuns();
+
+    byte bankIndex;
+    DropTargetSwitchRun *switchRuns;
+    byte numSwitchRuns;
     byte numSwitches;
     byte bankType;
     byte numSolenoids;
@@ -46,8 +75,22 @@ DropTargetBank::DropTargetBank(byte s_numSwitches, byte s_numSolenoids, byte s_b
   numSolenoids = s_numSolenoids;
   solenoidOnTime = s_solenoidOnTime;
   bankType = s_bankType;
+  switchArray = NULL;
+  switchRuns = NULL;
+  solArray = NULL;
   if (numSwitches) switchArray = new byte[numSwitches];
+  if (numSwitches) switchRuns = new DropTargetSwitchRun[numSwitches];
   if (numSolenoids) solArray = new byte[numSolenoids];
+  numSwitchRuns = 0;
+
+  // Banks past DROP_TARGET_MAX_BANKS still work,
+  // but have to be given their switches directly
+  bankIndex = 0xFF;
+  if (NumDropTargetBanks<DROP_TARGET_MAX_BANKS) {
+    bankIndex = NumDropTargetBanks;
+    DropTargetBanks[bankIndex] = this;
+    NumDropTargetBanks += 1;
+  }
   allTargetsSwitch = 0xFF;
   bankStatus = 0;
   bankBitmask = 0;
@@ -67,18 +110,58 @@ DropTargetBank::DropTargetBank(byte s_numSwitches, byte s_numSolenoids, byte s_b
 }
 
 DropTargetBank::~DropTargetBank() {
-  delete switchArray;
-  delete solArray;
+  for (byte count=0; count<numSwitches; count++) RegisterSwitch(switchArray[count], 0xFF);
+  RegisterSwitch(allTargetsSwitch, 0xFF);
+  if (bankIndex<DROP_TARGET_MAX_BANKS) DropTargetBanks[bankIndex] = NULL;
+  delete[] switchArray;
+  delete[] switchRuns;
+  delete[] solArray;
+}
+
+void DropTargetBank::RegisterSwitch(byte switchNum, byte target) {
+  if (switchNum>=DROP_TARGET_NUM_SWITCHES || bankIndex>=DROP_TARGET_MAX_BANKS) return;
+  if (target==0xFF) {
+    // Only let go of the switch if it's still ours
+    if ((DropTargetSwitchLookup[switchNum]>>4)==(bankIndex+1)) DropTargetSwitchLookup[switchNum] = 0;
+  } else {
+    DropTargetSwitchLookup[switchNum] = ((bankIndex+1)<<4) | target;
+  }
+}
+
+void DropTargetBank::BuildSwitchRuns() {
+  numSwitchRuns = 0;
+  DropTargetSwitchRun *run = NULL;
+  for (byte count=0; count<numSwitches; count++) {
+    byte switchNum = switchArray[count];
+    if (switchNum>=DROP_TARGET_NUM_SWITCHES) {
+      run = NULL;
+      continue;
+    }
+    if (run!=NULL && count>0 && switchNum==(switchArray[count-1]+1) && (switchNum/8)==run->switchByte) {
+      run->mask = (run->mask<<1) | 0x01;
+    } else {
+      run = &switchRuns[numSwitchRuns++];
+      run->switchByte = switchNum/8;
+      run->switchShift = switchNum%8;
+      run->targetShift = count;
+      run->mask = 0x01;
+    }
+  }
 }
 
 void DropTargetBank::DefineSwitch(byte switchOrder, byte switchNum) {
   if (switchOrder>=numSwitches) return;
+  RegisterSwitch(switchArray[switchOrder], 0xFF);
   switchArray[switchOrder] = switchNum;
+  RegisterSwitch(switchNum, switchOrder);
+  BuildSwitchRuns();
 }
 
 void DropTargetBank::AddAllTargetsSwitch(byte s_allTargetsSwitch) {
   if (bankType!=DROP_TARGET_TYPE_WLLMS_1) return;  
+  RegisterSwitch(allTargetsSwitch, 0xFF);
   allTargetsSwitch = s_allTargetsSwitch;
+  RegisterSwitch(allTargetsSwitch, DROP_TARGET_ALL_TARGETS_SWITCH);
 }
 
 void DropTargetBank::DefineResetSolenoid(byte solIndex, byte solChannelNumber) {
@@ -96,22 +179,35 @@ byte DropTargetBank::HandleDropTargetHit(byte switchNum) {
   if (ignoreDropsUntilTime) {
     return 0;
   }
-  
-  for (byte count=0; count<numSwitches; count++) {
-    if (switchNum==switchArray[count]) {
-      // If this is a new hit, see if it's in order
-      if ((bankStatus & singleBit)==0x00) {
-        if (targetsHitInOrder && count==numTargetsInOrder) {
-          numTargetsInOrder += 1;        
-        } else {
-          targetsHitInOrder = false;
-          numTargetsInOrder = 0;
-        }
+
+  // Banks that made it into the lookup find the target
+  // directly - any others fall back to searching
+  byte target = 0xFF;
+  if (bankIndex<DROP_TARGET_MAX_BANKS) {
+    if (switchNum<DROP_TARGET_NUM_SWITCHES && (DropTargetSwitchLookup[switchNum]>>4)==(bankIndex+1)) {
+      target = DropTargetSwitchLookup[switchNum] & 0x0F;
+    }
+  } else {
+    for (byte count=0; count<numSwitches; count++) {
+      if (switchNum==switchArray[count]) {
+        target = count;
+        break;
+      }
+    }
+  }
+
+  if (target<numSwitches) {
+    singleBit = 0x01 << target;
+    // If this is a new hit, see if it's in order
+    if ((bankStatus & singleBit)==0x00) {
+      if (targetsHitInOrder && target==numTargetsInOrder) {
+        numTargetsInOrder += 1;        
+      } else {
+        targetsHitInOrder = false;
+        numTargetsInOrder = 0;
       }
-      targetBits |= singleBit;
-      break;
     }
-    singleBit *= 2;
+    targetBits |= singleBit;
   }
 
   if (allTargetsSwitch!=0xFF) {
@@ -134,11 +230,10 @@ byte DropTargetBank::CheckIfBankCleared() {
 
 byte DropTargetBank::GetStatus(boolean readSwitches) {
   if (readSwitches) {
-    byte bitMask = 0x01;
     byte returnStatus = 0x00;
-    for (byte count=0; count<numSwitches; count++) {
-      if (RPU_ReadSingleSwitchState(switchArray[count])) returnStatus |= bitMask;
-      bitMask *= 2;
+    for (byte count=0; count<numSwitchRuns; count++) {
+      DropTargetSwitchRun *run = &switchRuns[count];
+      returnStatus |= ((RPU_ReadSwitchByte(run->switchByte) >> run->switchShift) & run->mask) << run->targetShift;
     }
     return returnStatus;
   } else {
@@ -181,3 +276,18 @@ void DropTargetBank::Update(unsigned long currentTime) {
     ignoreDropsUntilTime = 0;
   }
 }
+
+
+DropTargetBank *GetDropTargetBank(byte switchNum) {
+  if (switchNum>=DROP_TARGET_NUM_SWITCHES || DropTargetSwitchLookup[switchNum]==0) return NULL;
+  return DropTargetBanks[(DropTargetSwitchLookup[switchNum]>>4) - 1];
+}
+
+// Returns the newly dropped targets (0 if the switch
+// isn't a drop target) and, optionally, which bank they're in
+byte HandleDropTargetSwitch(byte switchNum, DropTargetBank **hitBank = NULL) {
+  DropTargetBank *bank = GetDropTargetBank(switchNum);
+  if (hitBank) *hitBank = bank;
+  if (bank==NULL) return 0;
+  return bank->HandleDropTargetHit(switchNum);
+}
@@ -8,10 +8,20 @@
 
 
 // This file can define a series of animations, stored 
-// with each lamp as a bit in the following array.
-// Lamp 0 = the first bit of the first byte, so "{0x01," below.
-// The animations can be played with either of the helper functions
-// at the bottom of this file.
+// with each lamp as a bit (lamp 0 = the first bit of the first
+// byte of a frame). The animations can be played with either of
+// the helper functions at the bottom of this file.
+//
+// Animations live in flash as XOR deltas so they cost no RAM.
+// Each step starts with a byte that has one bit for every frame
+// byte that changed since the previous step, followed by the
+// changed bits of those bytes (in byte order). The first step
+// is a delta from an all-off frame. The comment on each line
+// is the full frame for that step.
+//
+// The animations are generated from tools/lamp_shows.txt by
+// tools/lampshow.py - edit the show file and rerun the tool
+// rather than changing the generated section by hand.
 // 
 // These demonstration animations should be replaced
 // or removed for each specific implementation.
@@ -19,224 +29,276 @@
 
 
 // Lamp animation arrays
-#define NUM_LAMP_ANIMATIONS       5
-#define LAMP_ANIMATION_STEPS      24
 #define NUM_LAMP_ANIMATION_BYTES  6
-byte LampAnimations[NUM_LAMP_ANIMATIONS][LAMP_ANIMATION_STEPS][NUM_LAMP_ANIMATION_BYTES] = {
-  // Radar Animation (index = 0)
-  {
-    {0x00, 0x04, 0x00, 0x00, 0x00, 0x00}, // lamps on = 1
-    {0x00, 0x0C, 0x00, 0x00, 0x80, 0x00}, // lamps on = 3
-    {0x80, 0x04, 0x00, 0x00, 0x00, 0x00}, // lamps on = 2
-    {0x00, 0x44, 0x00, 0x00, 0x00, 0x08}, // lamps on = 3
-    {0x00, 0x44, 0x00, 0x00, 0x00, 0x00}, // lamps on = 2
-    {0x08, 0x44, 0x00, 0x00, 0x00, 0x80}, // lamps on = 5
-    {0x00, 0x04, 0x04, 0x04, 0x00, 0x04}, // lamps on = 5
-    {0x00, 0x04, 0x00, 0x00, 0x00, 0x04}, // lamps on = 2
-    {0x40, 0x04, 0x00, 0x00, 0x00, 0x00}, // lamps on = 2
-    {0x00, 0x04, 0x00, 0x00, 0x04, 0x40}, // lamps on = 3
-    {0x04, 0x04, 0x00, 0x00, 0x44, 0x00}, // lamps on = 4
-    {0x00, 0x04, 0x00, 0x00, 0x00, 0x00}, // lamps on = 1
-    {0x00, 0x04, 0x00, 0x00, 0x00, 0x30}, // lamps on = 3
-    {0x10, 0x04, 0x00, 0x00, 0x10, 0x00}, // lamps on = 3
-    {0x00, 0x05, 0x00, 0x00, 0x00, 0x00}, // lamps on = 2
-    {0x01, 0x04, 0x00, 0x00, 0x00, 0x00}, // lamps on = 2
-    {0x00, 0x04, 0x00, 0x00, 0x00, 0x00}, // lamps on = 1
-    {0x00, 0x04, 0x00, 0x00, 0x20, 0x00}, // lamps on = 2
-    {0x00, 0x04, 0x02, 0x00, 0x20, 0x00}, // lamps on = 3
-    {0x20, 0x16, 0x10, 0x10, 0x00, 0x00}, // lamps on = 6
-    {0x02, 0x24, 0x00, 0x00, 0x02, 0x02}, // lamps on = 5
-    {0x00, 0x04, 0x00, 0x00, 0x00, 0x00}, // lamps on = 1
-    {0x00, 0x04, 0x00, 0x00, 0x00, 0x00}, // lamps on = 1
-    {0x00, 0x04, 0x00, 0x00, 0x00, 0x00}  // lamps on = 1
-  // Bits Missing
-  // 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
-  },
-  // Center Out Animation (index = 1)
-  {
-    {0x00, 0x04, 0x00, 0x00, 0x00, 0x00}, // lamps on = 1
-    {0x00, 0x04, 0x00, 0x00, 0x00, 0x00}, // lamps on = 1
-    {0x00, 0x04, 0x00, 0x00, 0x00, 0x00}, // lamps on = 1
-    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // lamps on = 0
-    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // lamps on = 0
-    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // lamps on = 0
-    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // lamps on = 0
-    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // lamps on = 0
-    {0x00, 0x40, 0x00, 0x00, 0x00, 0x00}, // lamps on = 1
-    {0x00, 0x40, 0x00, 0x00, 0x00, 0x00}, // lamps on = 1
-    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // lamps on = 0
-    {0x00, 0x00, 0x00, 0x00, 0x00, 0x24}, // lamps on = 2
-    {0x11, 0x00, 0x00, 0x00, 0x00, 0x00}, // lamps on = 2
-    {0x10, 0x00, 0x00, 0x00, 0x30, 0x80}, // lamps on = 4
-    {0x00, 0x02, 0x00, 0x00, 0x80, 0x10}, // lamps on = 3
-    {0x00, 0x20, 0x00, 0x04, 0x04, 0x00}, // lamps on = 3
-    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // lamps on = 0
-    {0x08, 0x00, 0x00, 0x00, 0x40, 0x00}, // lamps on = 2
-    {0x80, 0x00, 0x04, 0x00, 0x00, 0x40}, // lamps on = 3
-    {0x04, 0x08, 0x00, 0x00, 0x00, 0x00}, // lamps on = 2
-    {0x40, 0x00, 0x00, 0x00, 0x00, 0x08}, // lamps on = 2
-    {0x00, 0x11, 0x10, 0x10, 0x00, 0x00}, // lamps on = 4
-    {0x00, 0x00, 0x00, 0x00, 0x00, 0x02}, // lamps on = 2
-    {0x22, 0x00, 0x02, 0x00, 0x02, 0x02}  // lamps on = 6
-  // Bits Missing
-  // 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
-  },
-  // Bottom to Top Animation (index = 2)
-  {
-    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // lamps on = 1
-    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // lamps on = 0
-    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // lamps on = 0
-    {0x40, 0x00, 0x00, 0x00, 0x00, 0x08}, // lamps on = 2
-    {0x00, 0x00, 0x04, 0x00, 0x00, 0x00}, // lamps on = 1
-    {0x8C, 0x08, 0x00, 0x00, 0x00, 0x40}, // lamps on = 5
-    {0x00, 0x00, 0x00, 0x04, 0x40, 0x00}, // lamps on = 2
-    {0x00, 0x00, 0x00, 0x00, 0x04, 0x80}, // lamps on = 2
-    {0x00, 0x00, 0x00, 0x00, 0x80, 0x04}, // lamps on = 2
-    {0x00, 0x40, 0x00, 0x00, 0x00, 0x00}, // lamps on = 1
-    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // lamps on = 0
-    {0x00, 0x04, 0x00, 0x00, 0x00, 0x00}, // lamps on = 1
-    {0x00, 0x00, 0x00, 0x00, 0x00, 0x20}, // lamps on = 1
-    {0x00, 0x00, 0x00, 0x00, 0x10, 0x10}, // lamps on = 2
-    {0x11, 0x00, 0x00, 0x00, 0x00, 0x00}, // lamps on = 2
-    {0x00, 0x00, 0x00, 0x00, 0x20, 0x00}, // lamps on = 1
-    {0x00, 0x22, 0x00, 0x00, 0x00, 0x00}, // lamps on = 2
-    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // lamps on = 0
-    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // lamps on = 0
-    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // lamps on = 0
-    {0x00, 0x01, 0x00, 0x00, 0x00, 0x00}, // lamps on = 1
-    {0x00, 0x10, 0x10, 0x10, 0x00, 0x00}, // lamps on = 3
-    {0x00, 0x00, 0x00, 0x00, 0x00, 0x02}, // lamps on = 1
-    {0x22, 0x00, 0x02, 0x00, 0x02, 0x00}  // lamps on = 4
-  // Bits Missing
-  // 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
-  },
-  // VUK Center Animation (index = 3)
-  {
-    {0x00, 0x00, 0x00, 0x00, 0x04, 0x00}, // lamps on = 1
-    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // lamps on = 1
-    {0x00, 0x00, 0x00, 0x00, 0x04, 0x00}, // lamps on = 1
-    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // lamps on = 0
-    {0x00, 0x00, 0x00, 0x00, 0x04, 0x00}, // lamps on = 0
-    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // lamps on = 0
-    {0x00, 0x00, 0x00, 0x00, 0x44, 0x00}, // lamps on = 1
-    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // lamps on = 0
-    {0x00, 0x00, 0x00, 0x00, 0x04, 0x40}, // lamps on = 1
-    {0x04, 0x00, 0x00, 0x00, 0x00, 0x00}, // lamps on = 1
-    {0x04, 0x00, 0x00, 0x04, 0x04, 0x04}, // lamps on = 3
-    {0x40, 0x00, 0x00, 0x00, 0x00, 0x80}, // lamps on = 2
-    {0x48, 0x40, 0x04, 0x00, 0x04, 0x20}, // lamps on = 5
-    {0x00, 0x04, 0x00, 0x00, 0x00, 0x30}, // lamps on = 3
-    {0x10, 0x00, 0x00, 0x00, 0x94, 0x00}, // lamps on = 3
-    {0x01, 0x00, 0x00, 0x00, 0x80, 0x00}, // lamps on = 2
-    {0x80, 0x00, 0x00, 0x00, 0x24, 0x08}, // lamps on = 4
-    {0x00, 0x0A, 0x00, 0x00, 0x20, 0x00}, // lamps on = 3
-    {0x00, 0x20, 0x00, 0x00, 0x04, 0x00}, // lamps on = 1
-    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // lamps on = 0
-    {0x00, 0x01, 0x00, 0x00, 0x04, 0x00}, // lamps on = 1
-    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // lamps on = 0
-    {0x00, 0x10, 0x10, 0x10, 0x04, 0x00}, // lamps on = 3
-    {0x22, 0x00, 0x02, 0x00, 0x02, 0x02}  // lamps on = 5
-  // Bits Missing
-  // 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
-  },
-  // Pop Bumper Center Animation (index = 4)
-  {
-    {0x00, 0x10, 0x10, 0x10, 0x00, 0x00}, // lamps on = 3
-    {0x00, 0x10, 0x10, 0x10, 0x00, 0x00}, // lamps on = 3
-    {0x00, 0x00, 0x00, 0x10, 0x00, 0x00}, // lamps on = 1
-    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // lamps on = 0
-    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // lamps on = 0
-    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // lamps on = 0
-    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // lamps on = 0
-    {0x22, 0x00, 0x00, 0x00, 0x02, 0x02}, // lamps on = 4
-    {0x02, 0x00, 0x02, 0x00, 0x00, 0x00}, // lamps on = 2
-    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // lamps on = 0
-    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // lamps on = 0
-    {0x00, 0x20, 0x00, 0x00, 0x00, 0x00}, // lamps on = 1
-    {0x00, 0x02, 0x00, 0x00, 0x20, 0x00}, // lamps on = 2
-    {0x00, 0x00, 0x00, 0x00, 0x20, 0x00}, // lamps on = 1
-    {0x01, 0x01, 0x00, 0x00, 0x00, 0x00}, // lamps on = 2
-    {0x10, 0x00, 0x00, 0x00, 0x10, 0x00}, // lamps on = 2
-    {0x00, 0x04, 0x00, 0x00, 0x10, 0x30}, // lamps on = 4
-    {0x00, 0x40, 0x00, 0x00, 0x00, 0x00}, // lamps on = 1
-    {0x00, 0x00, 0x00, 0x00, 0x80, 0x04}, // lamps on = 2
-    {0x00, 0x00, 0x00, 0x00, 0x04, 0x80}, // lamps on = 2
-    {0x88, 0x08, 0x00, 0x04, 0x40, 0x00}, // lamps on = 5
-    {0x04, 0x00, 0x04, 0x00, 0x00, 0x40}, // lamps on = 3
-    {0x40, 0x00, 0x00, 0x00, 0x00, 0x08}, // lamps on = 2
-    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}  // lamps on = 1 *turned off lamp 35 so we don't promise shoot again
-  // Bits Missing
-  // 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
-  }  
+
+struct LampAnimation {
+  const byte *frames;
+  byte numSteps;
 };
 
+// BEGIN GENERATED LAMP SHOWS
+#define NUM_LAMP_ANIMATIONS       5
 
+// Radar Animation (index = 0)
+const byte LampAnimationRadar[] PROGMEM = {
+  0x02, 0x04,                                // {0x00, 0x04, 0x00, 0x00, 0x00, 0x00}
+  0x12, 0x08, 0x80,                          // {0x00, 0x0C, 0x00, 0x00, 0x80, 0x00}
+  0x13, 0x80, 0x08, 0x80,                    // {0x80, 0x04, 0x00, 0x00, 0x00, 0x00}
+  0x23, 0x80, 0x40, 0x08,                    // {0x00, 0x44, 0x00, 0x00, 0x00, 0x08}
+  0x20, 0x08,                                // {0x00, 0x44, 0x00, 0x00, 0x00, 0x00}
+  0x21, 0x08, 0x80,                          // {0x08, 0x44, 0x00, 0x00, 0x00, 0x80}
+  0x2F, 0x08, 0x40, 0x04, 0x04, 0x84,        // {0x00, 0x04, 0x04, 0x04, 0x00, 0x04}
+  0x0C, 0x04, 0x04,                          // {0x00, 0x04, 0x00, 0x00, 0x00, 0x04}
+  0x21, 0x40, 0x04,                          // {0x40, 0x04, 0x00, 0x00, 0x00, 0x00}
+  0x31, 0x40, 0x04, 0x40,                    // {0x00, 0x04, 0x00, 0x00, 0x04, 0x40}
+  0x31, 0x04, 0x40, 0x40,                    // {0x04, 0x04, 0x00, 0x00, 0x44, 0x00}
+  0x11, 0x04, 0x44,                          // {0x00, 0x04, 0x00, 0x00, 0x00, 0x00}
+  0x20, 0x30,                                // {0x00, 0x04, 0x00, 0x00, 0x00, 0x30}
+  0x31, 0x10, 0x10, 0x30,                    // {0x10, 0x04, 0x00, 0x00, 0x10, 0x00}
+  0x13, 0x10, 0x01, 0x10,                    // {0x00, 0x05, 0x00, 0x00, 0x00, 0x00}
+  0x03, 0x01, 0x01,                          // {0x01, 0x04, 0x00, 0x00, 0x00, 0x00}
+  0x01, 0x01,                                // {0x00, 0x04, 0x00, 0x00, 0x00, 0x00}
+  0x10, 0x20,                                // {0x00, 0x04, 0x00, 0x00, 0x20, 0x00}
+  0x04, 0x02,                                // {0x00, 0x04, 0x02, 0x00, 0x20, 0x00}
+  0x1F, 0x20, 0x12, 0x12, 0x10, 0x20,        // {0x20, 0x16, 0x10, 0x10, 0x00, 0x00}
+  0x3F, 0x22, 0x32, 0x10, 0x10, 0x02, 0x02,  // {0x02, 0x24, 0x00, 0x00, 0x02, 0x02}
+  0x33, 0x02, 0x20, 0x02, 0x02,              // {0x00, 0x04, 0x00, 0x00, 0x00, 0x00}
+  0x00,                                      // {0x00, 0x04, 0x00, 0x00, 0x00, 0x00}
+  0x00                                       // {0x00, 0x04, 0x00, 0x00, 0x00, 0x00}
+};
 
-void ShowLampAnimation(byte animationNum, unsigned long divisor, unsigned long baseTime, byte subOffset, boolean dim, boolean reverse = false, byte keepLampOn = 99) {
-  if (animationNum>=NUM_LAMP_ANIMATIONS) return;
-  
-  byte currentStep = (baseTime / divisor) % LAMP_ANIMATION_STEPS;
-  if (reverse) currentStep = (LAMP_ANIMATION_STEPS - 1) - currentStep;
-
-  byte curBitmask;
-  byte *currentLampOffsetByte = LampAnimations[animationNum][(currentStep + subOffset) % LAMP_ANIMATION_STEPS];
-  byte *currentLampByte = LampAnimations[animationNum][currentStep];
-
-  byte lampNum = 0;
-  for (int byteNum = 0; byteNum < NUM_LAMP_ANIMATION_BYTES; byteNum++) {
-    curBitmask = 0x01;
-    
-    for (byte bitNum = 0; bitNum < 8; bitNum++) {
-
-      byte lampOn = false;
-      lampOn = (*currentLampByte) & curBitmask;
-
-      // if there's a subOffset, turn off lights at that offset
-      if (subOffset) {
-        byte lampOff = true;
-        lampOff = (*currentLampOffsetByte) & curBitmask;
-        if (lampOff && lampNum != keepLampOn && !lampOn) RPU_SetLampState(lampNum, 0);
-      }
+// Center Out Animation (index = 1)
+const byte LampAnimationCenterOut[] PROGMEM = {
+  0x02, 0x04,                          // {0x00, 0x04, 0x00, 0x00, 0x00, 0x00}
+  0x00,                                // {0x00, 0x04, 0x00, 0x00, 0x00, 0x00}
+  0x00,                                // {0x00, 0x04, 0x00, 0x00, 0x00, 0x00}
+  0x02, 0x04,                          // {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}
+  0x00,                                // {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}
+  0x00,                                // {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}
+  0x00,                                // {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}
+  0x00,                                // {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}
+  0x02, 0x40,                          // {0x00, 0x40, 0x00, 0x00, 0x00, 0x00}
+  0x00,                                // {0x00, 0x40, 0x00, 0x00, 0x00, 0x00}
+  0x02, 0x40,                          // {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}
+  0x20, 0x24,                          // {0x00, 0x00, 0x00, 0x00, 0x00, 0x24}
+  0x21, 0x11, 0x24,                    // {0x11, 0x00, 0x00, 0x00, 0x00, 0x00}
+  0x31, 0x01, 0x30, 0x80,              // {0x10, 0x00, 0x00, 0x00, 0x30, 0x80}
+  0x33, 0x10, 0x02, 0xB0, 0x90,        // {0x00, 0x02, 0x00, 0x00, 0x80, 0x10}
+  0x3A, 0x22, 0x04, 0x84, 0x10,        // {0x00, 0x20, 0x00, 0x04, 0x04, 0x00}
+  0x1A, 0x20, 0x04, 0x04,              // {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}
+  0x11, 0x08, 0x40,                    // {0x08, 0x00, 0x00, 0x00, 0x40, 0x00}
+  0x35, 0x88, 0x04, 0x40, 0x40,        // {0x80, 0x00, 0x04, 0x00, 0x00, 0x40}
+  0x27, 0x84, 0x08, 0x04, 0x40,        // {0x04, 0x08, 0x00, 0x00, 0x00, 0x00}
+  0x23, 0x44, 0x08, 0x08,              // {0x40, 0x00, 0x00, 0x00, 0x00, 0x08}
+  0x2F, 0x40, 0x11, 0x10, 0x10, 0x08,  // {0x00, 0x11, 0x10, 0x10, 0x00, 0x00}
+  0x2E, 0x11, 0x10, 0x10, 0x02,        // {0x00, 0x00, 0x00, 0x00, 0x00, 0x02}
+  0x15, 0x22, 0x02, 0x02               // {0x22, 0x00, 0x02, 0x00, 0x02, 0x02}
+};
 
-      if (lampOn) RPU_SetLampState(lampNum, 1, dim);
+// Bottom to Top Animation (index = 2)
+const byte LampAnimationBottomToTop[] PROGMEM = {
+  0x00,                                // {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}
+  0x00,                                // {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}
+  0x00,                                // {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}
+  0x21, 0x40, 0x08,                    // {0x40, 0x00, 0x00, 0x00, 0x00, 0x08}
+  0x25, 0x40, 0x04, 0x08,              // {0x00, 0x00, 0x04, 0x00, 0x00, 0x00}
+  0x27, 0x8C, 0x08, 0x04, 0x40,        // {0x8C, 0x08, 0x00, 0x00, 0x00, 0x40}
+  0x3B, 0x8C, 0x08, 0x04, 0x40, 0x40,  // {0x00, 0x00, 0x00, 0x04, 0x40, 0x00}
+  0x38, 0x04, 0x44, 0x80,              // {0x00, 0x00, 0x00, 0x00, 0x04, 0x80}
+  0x30, 0x84, 0x84,                    // {0x00, 0x00, 0x00, 0x00, 0x80, 0x04}
+  0x32, 0x40, 0x80, 0x04,              // {0x00, 0x40, 0x00, 0x00, 0x00, 0x00}
+  0x02, 0x40,                          // {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}
+  0x02, 0x04,                          // {0x00, 0x04, 0x00, 0x00, 0x00, 0x00}
+  0x22, 0x04, 0x20,                    // {0x00, 0x00, 0x00, 0x00, 0x00, 0x20}
+  0x30, 0x10, 0x30,                    // {0x00, 0x00, 0x00, 0x00, 0x10, 0x10}
+  0x31, 0x11, 0x10, 0x10,              // {0x11, 0x00, 0x00, 0x00, 0x00, 0x00}
+  0x11, 0x11, 0x20,                    // {0x00, 0x00, 0x00, 0x00, 0x20, 0x00}
+  0x12, 0x22, 0x20,                    // {0x00, 0x22, 0x00, 0x00, 0x00, 0x00}
+  0x02, 0x22,                          // {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}
+  0x00,                                // {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}
+  0x00,                                // {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}
+  0x02, 0x01,                          // {0x00, 0x01, 0x00, 0x00, 0x00, 0x00}
+  0x0E, 0x11, 0x10, 0x10,              // {0x00, 0x10, 0x10, 0x10, 0x00, 0x00}
+  0x2E, 0x10, 0x10, 0x10, 0x02,        // {0x00, 0x00, 0x00, 0x00, 0x00, 0x02}
+  0x35, 0x22, 0x02, 0x02, 0x02         // {0x22, 0x00, 0x02, 0x00, 0x02, 0x00}
+};
 
-      curBitmask *= 2;
-      lampNum += 1;
-    }
-    currentLampByte += 1;
-    currentLampOffsetByte += 1;
+// VUK Center Animation (index = 3)
+const byte LampAnimationVUKCenter[] PROGMEM = {
+  0x10, 0x04,                                // {0x00, 0x00, 0x00, 0x00, 0x04, 0x00}
+  0x10, 0x04,                                // {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}
+  0x10, 0x04,                                // {0x00, 0x00, 0x00, 0x00, 0x04, 0x00}
+  0x10, 0x04,                                // {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}
+  0x10, 0x04,                                // {0x00, 0x00, 0x00, 0x00, 0x04, 0x00}
+  0x10, 0x04,                                // {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}
+  0x10, 0x44,                                // {0x00, 0x00, 0x00, 0x00, 0x44, 0x00}
+  0x10, 0x44,                                // {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}
+  0x30, 0x04, 0x40,                          // {0x00, 0x00, 0x00, 0x00, 0x04, 0x40}
+  0x31, 0x04, 0x04, 0x40,                    // {0x04, 0x00, 0x00, 0x00, 0x00, 0x00}
+  0x38, 0x04, 0x04, 0x04,                    // {0x04, 0x00, 0x00, 0x04, 0x04, 0x04}
+  0x39, 0x44, 0x04, 0x04, 0x84,              // {0x40, 0x00, 0x00, 0x00, 0x00, 0x80}
+  0x37, 0x08, 0x40, 0x04, 0x04, 0xA0,        // {0x48, 0x40, 0x04, 0x00, 0x04, 0x20}
+  0x37, 0x48, 0x44, 0x04, 0x04, 0x10,        // {0x00, 0x04, 0x00, 0x00, 0x00, 0x30}
+  0x33, 0x10, 0x04, 0x94, 0x30,              // {0x10, 0x00, 0x00, 0x00, 0x94, 0x00}
+  0x11, 0x11, 0x14,                          // {0x01, 0x00, 0x00, 0x00, 0x80, 0x00}
+  0x31, 0x81, 0xA4, 0x08,                    // {0x80, 0x00, 0x00, 0x00, 0x24, 0x08}
+  0x33, 0x80, 0x0A, 0x04, 0x08,              // {0x00, 0x0A, 0x00, 0x00, 0x20, 0x00}
+  0x12, 0x2A, 0x24,                          // {0x00, 0x20, 0x00, 0x00, 0x04, 0x00}
+  0x12, 0x20, 0x04,                          // {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}
+  0x12, 0x01, 0x04,                          // {0x00, 0x01, 0x00, 0x00, 0x04, 0x00}
+  0x12, 0x01, 0x04,                          // {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}
+  0x1E, 0x10, 0x10, 0x10, 0x04,              // {0x00, 0x10, 0x10, 0x10, 0x04, 0x00}
+  0x3F, 0x22, 0x10, 0x12, 0x10, 0x06, 0x02   // {0x22, 0x00, 0x02, 0x00, 0x02, 0x02}
+};
+
+// Pop Bumper Center Animation (index = 4)
+const byte LampAnimationPopBumperCenter[] PROGMEM = {
+  0x0E, 0x10, 0x10, 0x10,                    // {0x00, 0x10, 0x10, 0x10, 0x00, 0x00}
+  0x00,                                      // {0x00, 0x10, 0x10, 0x10, 0x00, 0x00}
+  0x06, 0x10, 0x10,                          // {0x00, 0x00, 0x00, 0x10, 0x00, 0x00}
+  0x08, 0x10,                                // {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}
+  0x00,                                      // {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}
+  0x00,                                      // {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}
+  0x00,                                      // {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}
+  0x31, 0x22, 0x02, 0x02,                    // {0x22, 0x00, 0x00, 0x00, 0x02, 0x02}
+  0x35, 0x20, 0x02, 0x02, 0x02,              // {0x02, 0x00, 0x02, 0x00, 0x00, 0x00}
+  0x05, 0x02, 0x02,                          // {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}
+  0x00,                                      // {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}
+  0x02, 0x20,                                // {0x00, 0x20, 0x00, 0x00, 0x00, 0x00}
+  0x12, 0x22, 0x20,                          // {0x00, 0x02, 0x00, 0x00, 0x20, 0x00}
+  0x02, 0x02,                                // {0x00, 0x00, 0x00, 0x00, 0x20, 0x00}
+  0x13, 0x01, 0x01, 0x20,                    // {0x01, 0x01, 0x00, 0x00, 0x00, 0x00}
+  0x13, 0x11, 0x01, 0x10,                    // {0x10, 0x00, 0x00, 0x00, 0x10, 0x00}
+  0x23, 0x10, 0x04, 0x30,                    // {0x00, 0x04, 0x00, 0x00, 0x10, 0x30}
+  0x32, 0x44, 0x10, 0x30,                    // {0x00, 0x40, 0x00, 0x00, 0x00, 0x00}
+  0x32, 0x40, 0x80, 0x04,                    // {0x00, 0x00, 0x00, 0x00, 0x80, 0x04}
+  0x30, 0x84, 0x84,                          // {0x00, 0x00, 0x00, 0x00, 0x04, 0x80}
+  0x3B, 0x88, 0x08, 0x04, 0x44, 0x80,        // {0x88, 0x08, 0x00, 0x04, 0x40, 0x00}
+  0x3F, 0x8C, 0x08, 0x04, 0x04, 0x40, 0x40,  // {0x04, 0x00, 0x04, 0x00, 0x00, 0x40}
+  0x25, 0x44, 0x04, 0x48,                    // {0x40, 0x00, 0x00, 0x00, 0x00, 0x08}
+  0x21, 0x40, 0x08                           // {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}
+};
+
+const LampAnimation LampAnimations[NUM_LAMP_ANIMATIONS] PROGMEM = {
+  {LampAnimationRadar, 24},
+  {LampAnimationCenterOut, 24},
+  {LampAnimationBottomToTop, 24},
+  {LampAnimationVUKCenter, 24},
+  {LampAnimationPopBumperCenter, 24}
+};
+// END GENERATED LAMP SHOWS
+
+
+
+// A cursor remembers where it is in an animation so
+// stepping forward only has to apply one delta
+struct LampAnimationCursor {
+  byte animationNum;
+  byte step;
+  unsigned short dataOffset;
+  byte frame[NUM_LAMP_ANIMATION_BYTES];
+};
+
+LampAnimationCursor LampAnimationCurrent = {0xFF, 0, 0, {0}};
+LampAnimationCursor LampAnimationTrail = {0xFF, 0, 0, {0}};
+
+byte GetLampAnimationLength(byte animationNum) {
+  if (animationNum>=NUM_LAMP_ANIMATIONS) return 0;
+  return pgm_read_byte(&LampAnimations[animationNum].numSteps);
+}
+
+byte *GetLampAnimationFrame(LampAnimationCursor *cursor, byte animationNum, byte step) {
+  LampAnimation animation;
+  memcpy_P(&animation, &LampAnimations[animationNum], sizeof(LampAnimation));
+
+  // Going backwards (or to another animation) means
+  // replaying the deltas from the start
+  if (cursor->animationNum!=animationNum || step<cursor->step) {
+    cursor->animationNum = animationNum;
+    cursor->step = 0;
+    cursor->dataOffset = 0;
+    for (byte byteNum=0; byteNum<NUM_LAMP_ANIMATION_BYTES; byteNum++) cursor->frame[byteNum] = 0;
+  } else if (step==cursor->step && cursor->dataOffset) {
+    return cursor->frame;
   }
+
+  // Once a step has been applied, dataOffset
+  // points at the delta for the step after it
+  do {
+    if (cursor->dataOffset) cursor->step += 1;
+    byte changedBytes = pgm_read_byte(animation.frames + cursor->dataOffset);
+    cursor->dataOffset += 1;
+    for (byte byteNum=0; changedBytes; byteNum++, changedBytes>>=1) {
+      if (changedBytes & 0x01) {
+        cursor->frame[byteNum] ^= pgm_read_byte(animation.frames + cursor->dataOffset);
+        cursor->dataOffset += 1;
+      }
+    }
+  } while (cursor->step<step);
+
+  return cursor->frame;
 }
 
 
-void ShowLampAnimationSingleStep(byte animationNum, byte currentStep, byte *lampsToAvoid = NULL) {
+// Everything that decides what the last ShowLampAnimation() drew
+unsigned long LastLampAnimationTick = 0xFFFFFFFF;
+unsigned long LastLampAnimationDivisor = 0;
+byte LastLampAnimationNum = 0xFF;
+byte LastLampAnimationSubOffset = 0;
+byte LastLampAnimationKeepLampOn = 0;
+byte LastLampAnimationFlags = 0;   // 0x01 = dim, 0x02 = reverse
+
+void ShowLampAnimation(byte animationNum, unsigned long divisor, unsigned long baseTime, byte subOffset, boolean dim, boolean reverse = false, byte keepLampOn = 99) {
   if (animationNum>=NUM_LAMP_ANIMATIONS) return;
-  
-  byte lampNum = 0;
-  byte *currentLampByte = LampAnimations[animationNum][currentStep];
-  byte *currentAvoidByte = lampsToAvoid;
-  byte curBitmask;
-  
-  for (int byteNum = 0; byteNum < NUM_LAMP_ANIMATION_BYTES; byteNum++) {
-    curBitmask = 0x01;
-    for (byte bitNum = 0; bitNum < 8; bitNum++) {
 
-      boolean avoidLamp = false;
-      if (currentAvoidByte!=NULL) {
-        if ((*currentAvoidByte) & curBitmask) avoidLamp = true;
-      }
+  // Nothing to do until the animation moves to its next step
+  // or is asked for with different settings
+  unsigned long animationTick = baseTime / divisor;
+  byte flags = (dim ? 0x01 : 0x00) | (reverse ? 0x02 : 0x00);
+  if (  animationTick==LastLampAnimationTick && divisor==LastLampAnimationDivisor && animationNum==LastLampAnimationNum &&
+        subOffset==LastLampAnimationSubOffset && keepLampOn==LastLampAnimationKeepLampOn && flags==LastLampAnimationFlags) return;
+  LastLampAnimationTick = animationTick;
+  LastLampAnimationDivisor = divisor;
+  LastLampAnimationNum = animationNum;
+  LastLampAnimationSubOffset = subOffset;
+  LastLampAnimationKeepLampOn = keepLampOn;
+  LastLampAnimationFlags = flags;
+
+  byte numSteps = GetLampAnimationLength(animationNum);
+  byte currentStep = animationTick % numSteps;
+  if (reverse) currentStep = (numSteps - 1) - currentStep;
 
-      if (!avoidLamp /*&& (*currentLampByte)&curBitmask*/) RPU_SetLampState(lampNum, (*currentLampByte)&curBitmask);
+  byte *currentLampBytes = GetLampAnimationFrame(&LampAnimationCurrent, animationNum, currentStep);
+  byte *trailLampBytes = NULL;
+  if (subOffset) trailLampBytes = GetLampAnimationFrame(&LampAnimationTrail, animationNum, (currentStep + subOffset) % numSteps);
 
-      lampNum += 1;
-      curBitmask *= 2;
+  for (byte byteNum = 0; byteNum < NUM_LAMP_ANIMATION_BYTES; byteNum++) {
+    byte lampsOn = currentLampBytes[byteNum];
+
+    // Lamps at the subOffset step are turned off (leaving a trail
+    // of lamps between the two steps), unless this step lights them
+    byte lampsOff = 0;
+    if (trailLampBytes) {
+      lampsOff = trailLampBytes[byteNum] & ~lampsOn;
+      if ((keepLampOn / 8) == byteNum) lampsOff &= ~(0x01 << (keepLampOn % 8));
     }
-    currentLampByte += 1;
-    if (currentAvoidByte!=NULL) currentAvoidByte += 1;
+
+    if (lampsOn || lampsOff) RPU_SetLampBank(byteNum, lampsOn | lampsOff, lampsOn, dim ? 1 : 0);
   }
 }
 
 
+void ShowLampAnimationSingleStep(byte animationNum, byte currentStep, byte *lampsToAvoid = NULL) {
+  if (animationNum>=NUM_LAMP_ANIMATIONS) return;
+  if (currentStep>=GetLampAnimationLength(animationNum)) return;
+  
+  byte *currentLampBytes = GetLampAnimationFrame(&LampAnimationCurrent, animationNum, currentStep);
+  for (byte byteNum = 0; byteNum < NUM_LAMP_ANIMATION_BYTES; byteNum++) {
+    byte lampMask = (lampsToAvoid!=NULL) ? ~lampsToAvoid[byteNum] : 0xFF;
+    RPU_SetLampBank(byteNum, lampMask, currentLampBytes[byteNum]);
+  }
+}
+
 
 
 
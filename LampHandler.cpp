@@ -0,0 +1,142 @@
+////////////////////////////////////////////////////////////////////////////
+//
+//  Lamp Layer functions
+//
+////////////////////////////////////////////////////////////////////////////
+#include <Arduino.h>
+#include "RPU_Config.h"
+#include "RPU.h"
+#include "LampHandler.h"
+
+LampLayer LampLayers[LAMP_NUM_LAYERS];
+byte LampLayerFlashPeriod[RPU_MAX_LAMPS];
+
+// What was last committed, so unchanged frames
+// don't have to be written again
+byte LampsOwned[RPU_NUM_LAMP_BANKS];
+byte CommittedLampsOn[RPU_NUM_LAMP_BANKS];
+byte CommittedLampsDim1[RPU_NUM_LAMP_BANKS];
+byte CommittedLampsDim2[RPU_NUM_LAMP_BANKS];
+boolean LampFrameInvalid = true;
+
+
+void Lamp_SetLayerBank(byte layer, byte bankNum, byte mask, byte lampsOn, byte dim, int flashPeriod) {
+  if (layer >= LAMP_NUM_LAYERS || bankNum >= RPU_NUM_LAMP_BANKS) return;
+  LampLayer *lampLayer = &LampLayers[layer];
+
+  lampsOn &= mask;
+  byte lampsFlashing = (flashPeriod > 0) ? lampsOn : 0;
+
+  lampLayer->mask[bankNum] |= mask;
+  lampLayer->lampsOn[bankNum] = (lampLayer->lampsOn[bankNum] & ~mask) | lampsOn;
+  lampLayer->lampsDim1[bankNum] = (lampLayer->lampsDim1[bankNum] & ~mask) | ((dim & 0x01) ? lampsOn : 0);
+  lampLayer->lampsDim2[bankNum] = (lampLayer->lampsDim2[bankNum] & ~mask) | ((dim & 0x02) ? lampsOn : 0);
+  lampLayer->lampsFlashing[bankNum] = (lampLayer->lampsFlashing[bankNum] & ~mask) | lampsFlashing;
+
+  if (lampsFlashing) {
+    int adjustedLampFlash = flashPeriod / 50;
+    if (adjustedLampFlash == 0) adjustedLampFlash = 1;
+    if (adjustedLampFlash > 250) adjustedLampFlash = 250;
+
+    byte lampNum = bankNum * 8;
+    for (byte lampBit = 0x01; lampBit; lampBit *= 2, lampNum++) {
+      if (lampsFlashing & lampBit) LampLayerFlashPeriod[lampNum] = adjustedLampFlash;
+    }
+  }
+}
+
+
+void Lamp_SetLamp(byte layer, byte lampNum, byte lampOn, byte dim, int flashPeriod) {
+  if (lampNum >= RPU_MAX_LAMPS) return;
+  Lamp_SetLayerBank(layer, lampNum / 8, 0x01 << (lampNum % 8), lampOn ? 0xFF : 0x00, dim, flashPeriod);
+}
+
+
+void Lamp_SetLayerFrame(byte layer, const byte *lampsOn, const byte *mask) {
+  if (layer >= LAMP_NUM_LAYERS) return;
+  for (byte bankNum = 0; bankNum < RPU_NUM_LAMP_BANKS; bankNum++) {
+    Lamp_SetLayerBank(layer, bankNum, mask ? mask[bankNum] : 0xFF, lampsOn[bankNum]);
+  }
+}
+
+
+void Lamp_ReleaseLamp(byte layer, byte lampNum) {
+  if (layer >= LAMP_NUM_LAYERS || lampNum >= RPU_MAX_LAMPS) return;
+  LampLayers[layer].mask[lampNum / 8] &= ~(0x01 << (lampNum % 8));
+}
+
+
+void Lamp_ClearLayer(byte layer) {
+  if (layer >= LAMP_NUM_LAYERS) return;
+  LampLayer *lampLayer = &LampLayers[layer];
+  for (byte bankNum = 0; bankNum < RPU_NUM_LAMP_BANKS; bankNum++) {
+    lampLayer->mask[bankNum] = 0;
+    lampLayer->lampsOn[bankNum] = 0;
+    lampLayer->lampsDim1[bankNum] = 0;
+    lampLayer->lampsDim2[bankNum] = 0;
+    lampLayer->lampsFlashing[bankNum] = 0;
+  }
+}
+
+
+void Lamp_ClearAllLayers() {
+  for (byte layer = 0; layer < LAMP_NUM_LAYERS; layer++) Lamp_ClearLayer(layer);
+  Lamp_InvalidateLamps();
+}
+
+
+void Lamp_InvalidateLamps() {
+  // Something wrote the lamp banks directly
+  // (RPU_TurnOffAllLamps, the lamp test, etc.)
+  LampFrameInvalid = true;
+}
+
+
+void Lamp_UpdateLamps(unsigned long currentTime) {
+  byte lampsOn[RPU_NUM_LAMP_BANKS];
+  byte lampsDim1[RPU_NUM_LAMP_BANKS];
+  byte lampsDim2[RPU_NUM_LAMP_BANKS];
+  byte frameMask[RPU_NUM_LAMP_BANKS];
+  boolean frameChanged = LampFrameInvalid;
+
+  for (byte bankNum = 0; bankNum < RPU_NUM_LAMP_BANKS; bankNum++) {
+    byte owned = 0, bankOn = 0, bankDim1 = 0, bankDim2 = 0, bankFlashing = 0;
+
+    for (byte layer = 0; layer < LAMP_NUM_LAYERS; layer++) {
+      LampLayer *lampLayer = &LampLayers[layer];
+      byte mask = lampLayer->mask[bankNum];
+      if (mask == 0) continue;
+      owned |= mask;
+      bankOn = (bankOn & ~mask) | lampLayer->lampsOn[bankNum];
+      bankDim1 = (bankDim1 & ~mask) | lampLayer->lampsDim1[bankNum];
+      bankDim2 = (bankDim2 & ~mask) | lampLayer->lampsDim2[bankNum];
+      bankFlashing = (bankFlashing & ~mask) | lampLayer->lampsFlashing[bankNum];
+    }
+
+    if (bankFlashing) {
+      byte lampNum = bankNum * 8;
+      for (byte lampBit = 0x01; lampBit; lampBit *= 2, lampNum++) {
+        if ((bankFlashing & lampBit) && (currentTime / ((unsigned long)LampLayerFlashPeriod[lampNum] * 50)) % 2) {
+          bankOn &= ~lampBit;
+        }
+      }
+    }
+
+    // Lamps that a layer has just let go of (and no other
+    // layer covers) are turned off once, then left alone
+    frameMask[bankNum] = owned | LampsOwned[bankNum];
+    if (owned != LampsOwned[bankNum] || bankOn != CommittedLampsOn[bankNum] ||
+        bankDim1 != CommittedLampsDim1[bankNum] || bankDim2 != CommittedLampsDim2[bankNum]) {
+      frameChanged = true;
+    }
+
+    LampsOwned[bankNum] = owned;
+    lampsOn[bankNum] = CommittedLampsOn[bankNum] = bankOn;
+    lampsDim1[bankNum] = CommittedLampsDim1[bankNum] = bankDim1;
+    lampsDim2[bankNum] = CommittedLampsDim2[bankNum] = bankDim2;
+  }
+
+  if (!frameChanged) return;
+  RPU_SetLampFrame(lampsOn, frameMask, lampsDim1, lampsDim2);
+  LampFrameInvalid = false;
+}
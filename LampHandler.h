@@ -0,0 +1,41 @@
+// Lamp Layer Functions
+//
+// Game code can draw lamps into prioritized layers instead of
+// straight into the RPU lamp banks. Each layer only owns the lamps
+// it has set (its mask); Lamp_UpdateLamps() flattens the layers,
+// with higher layers covering lower ones, and commits the result
+// with RPU_SetLampFrame(). When a layer lets go of a lamp, whatever
+// is underneath shows through again without being redrawn.
+//
+// Lamps that no layer owns are left alone, so they can still be
+// driven with RPU_SetLampState().
+
+#ifndef LAMP_HANDLER_H
+
+#define LAMP_LAYER_STATUS       0     // base game status
+#define LAMP_LAYER_MODE         1     // mode highlights
+#define LAMP_LAYER_EFFECT       2     // transient effects
+#define LAMP_LAYER_SHOW         3     // full playfield shows
+#define LAMP_NUM_LAYERS         4
+
+struct LampLayer {
+  byte mask[RPU_NUM_LAMP_BANKS];
+  byte lampsOn[RPU_NUM_LAMP_BANKS];
+  byte lampsDim1[RPU_NUM_LAMP_BANKS];
+  byte lampsDim2[RPU_NUM_LAMP_BANKS];
+  byte lampsFlashing[RPU_NUM_LAMP_BANKS];
+};
+
+// Flash periods are kept per lamp (not per layer), so the
+// last layer to flash a lamp sets its rate
+void Lamp_SetLamp(byte layer, byte lampNum, byte lampOn, byte dim = 0, int flashPeriod = 0);
+void Lamp_SetLayerBank(byte layer, byte bankNum, byte mask, byte lampsOn, byte dim = 0, int flashPeriod = 0);
+void Lamp_SetLayerFrame(byte layer, const byte *lampsOn, const byte *mask = NULL);
+void Lamp_ReleaseLamp(byte layer, byte lampNum);
+void Lamp_ClearLayer(byte layer);
+void Lamp_ClearAllLayers();
+void Lamp_InvalidateLamps();
+void Lamp_UpdateLamps(unsigned long currentTime);
+
+#define LAMP_HANDLER_H
+#endif
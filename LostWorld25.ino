@@ -14,7 +14,9 @@
 #include "OperatorMenus.h"
 #include "AudioHandler.h"
 #include "DisplayHandler.h"
+#include "LampHandler.h"
 #include "LampAnimations.h"
+#include "SerialChannels.h"
 #include <EEPROM.h>
 
 // switch test not showing switches in player displays
@@ -26,8 +28,25 @@
 
 #if (DEBUG_MESSAGES==1)
 #define DEBUG_SHOW_LOOPS_PER_SECOND
+//#define DEBUG_SHOW_AUDIO_TRAFFIC
 #endif
 
+// Debug event IDs (sent on SERIAL_CHANNEL_DEBUG_EVENT
+// and named on the host by DEBUG_EVENT_NAMES in tools/serial_stream.py)
+#define DEBUG_EVENT_STARTING                  1
+#define DEBUG_EVENT_INITIALIZING_MPU          2
+#define DEBUG_EVENT_INIT_RESULT               3
+#define DEBUG_EVENT_ORIGINAL_CODE_REQUESTED   4
+#define DEBUG_EVENT_ENTERING_ATTRACT          5
+#define DEBUG_EVENT_ATTRACT_TRAPPED_BALL_CHECK 6
+#define DEBUG_EVENT_UNHANDLED_SWITCH          7
+#define DEBUG_EVENT_GAME_MODE                 8
+#define DEBUG_EVENT_UNSTRUCTURED_PLAY         9
+#define DEBUG_EVENT_BALL_SAVE                 10
+#define DEBUG_EVENT_COUNTDOWN_OVER            11
+#define DEBUG_EVENT_START_BUTTON              12
+#define DEBUG_EVENT_LOOPS_PER_SECOND          13
+
 #ifdef RPU_SIMPLIFY_DISPLAY_FOR_7VOLUTION
 #define DISPLAY_DASH_STYLE  DISPLAY_DASH_INTERMITTENT_FLASH
 #else
@@ -79,6 +98,7 @@ boolean MachineStateChanged = true;
 #define EEPROM_POP_BUMPER_STRENGTH                136
 #define EEPROM_GAME_RULES_SELECTION               137
 #define EEPROM_MATCH_FEATURE_BYTE                 138
+#define EEPROM_DISPLAY_REFRESH_BYTE               139
 #define EEPROM_EXTRA_BALL_SCORE_UL                160
 #define EEPROM_SPECIAL_SCORE_UL                   164
 
@@ -274,6 +294,9 @@ byte BallServeSolenoidStrength = 4;
 byte SaucerSolenoidStrength = 4;
 byte TempSlingStrength = 4;
 byte TempPopStrength = 4;
+byte DisplayRefreshMode;
+unsigned long DisplayRefreshBusyUntil;
+unsigned long LastAudioFramesSent;
 byte LettersHit[RPU_NUMBER_OF_PLAYERS_ALLOWED][6];
 byte SpinnerPhase;
 byte SaucerValue[RPU_NUMBER_OF_PLAYERS_ALLOWED];
@@ -294,6 +317,12 @@ byte DragonsDenValue[RPU_NUMBER_OF_PLAYERS_ALLOWED];
 #define GAME_RULES_PROGRESSIVE  4
 #define GAME_RULES_CUSTOM       5
 
+// Adaptive refresh speeds the displays up in attract mode
+// and slows them down while the game is busy
+#define DISPLAY_REFRESH_FIXED             0
+#define DISPLAY_REFRESH_ADAPTIVE          1
+#define DISPLAY_REFRESH_BUSY_HOLD_MS      250
+
 unsigned long PlayfieldMultiplierTimeLeft;
 unsigned long BonusChangedTime;
 unsigned long BonusXAnimationStart;
@@ -340,6 +369,7 @@ void SetAllParameterDefaults() {
   ExtraBallValue = 20000;
   SpecialValue = 40000;
   TimeRequiredToResetGame = 2;
+  DisplayRefreshMode = DISPLAY_REFRESH_ADAPTIVE;
   CPCSelection[0] = 4;
   CPCSelection[1] = 4;
   CPCSelection[2] = 4;
@@ -396,6 +426,7 @@ void WriteParameters(boolean onlyWriteRulesParameters = true) {
     RPU_WriteULToEEProm(EEPROM_EXTRA_BALL_SCORE_UL, ExtraBallValue);
     RPU_WriteULToEEProm(EEPROM_SPECIAL_SCORE_UL, SpecialValue);
     RPU_WriteByteToEEProm(EEPROM_CRB_HOLD_TIME, TimeRequiredToResetGame);
+    RPU_WriteByteToEEProm(EEPROM_DISPLAY_REFRESH_BYTE, DisplayRefreshMode);
 
     // Set baseline for audits
     RPU_WriteByteToEEProm(RPU_CHUTE_1_COINS_START_BYTE, 0);
@@ -464,6 +495,8 @@ void ReadStoredParameters() {
   
     TimeRequiredToResetGame = ReadSetting(EEPROM_CRB_HOLD_TIME, 1, 99);
     if (TimeRequiredToResetGame > 3 && TimeRequiredToResetGame != 99) TimeRequiredToResetGame = 1;
+
+    DisplayRefreshMode = ReadSetting(EEPROM_DISPLAY_REFRESH_BYTE, DISPLAY_REFRESH_ADAPTIVE, DISPLAY_REFRESH_ADAPTIVE);
     
     // Read game rules
     GameRulesSelection = ReadSetting(EEPROM_GAME_RULES_SELECTION, GAME_RULES_MEDIUM, GAME_RULES_CUSTOM);
@@ -624,11 +657,13 @@ byte SolenoidConvertDisplayNumberToTestStrength(byte displayNumber) {
 
 void setup() {
 
-  if (DEBUG_MESSAGES) {
-    // If debug is on, set up the Serial port for communication
-    Serial.begin(115200);
-    Serial.write("Starting\n");
-  }
+  // Debug events and telemetry share the channel port
+#ifdef RPU_OS_USE_TELEMETRY
+  Channel_Begin(115200);
+#else
+  if (DEBUG_MESSAGES) Channel_Begin(115200);
+#endif
+  if (DEBUG_MESSAGES) Channel_DebugEvent(DEBUG_EVENT_STARTING, millis());
 
   // Set up the Audio handler in order to play boot messages
   CurrentTime = millis();
@@ -650,7 +685,7 @@ void setup() {
 
   // Set up the chips and interrupts
   unsigned long initResult = 0;
-  if (DEBUG_MESSAGES) Serial.write("Initializing MPU\n");
+  if (DEBUG_MESSAGES) Channel_DebugEvent(DEBUG_EVENT_INITIALIZING_MPU, millis());
 
   // If the hardware has the ability to switch on the Credit/Reset button (requires Rev 4 or greater)
   // then that can be used to choose Original or New code. Otherwise, the hardware switch
@@ -658,14 +693,8 @@ void setup() {
   initResult = RPU_InitializeMPU(   RPU_CMD_BOOT_ORIGINAL_IF_CREDIT_RESET | RPU_CMD_BOOT_ORIGINAL_IF_NOT_SWITCH_CLOSED |
                                     RPU_CMD_INIT_AND_RETURN_EVEN_IF_ORIGINAL_CHOSEN | RPU_CMD_PERFORM_MPU_TEST, SW_CREDIT_RESET);
 
-  if (DEBUG_MESSAGES) {
-    char buf[128];
-    sprintf(buf, "Return from init = 0x%04lX\n", initResult);
-    Serial.write(buf);
-    if (initResult & RPU_RET_6800_DETECTED) Serial.write("Detected 6800 clock\n");
-    else if (initResult & RPU_RET_6802_OR_8_DETECTED) Serial.write("Detected 6802/8 clock\n");
-    Serial.write("Back from init\n");
-  }
+  // The host decodes the clock detection from the RPU_RET_ flags
+  if (DEBUG_MESSAGES) Channel_DebugEvent(DEBUG_EVENT_INIT_RESULT, millis(), (long)initResult);
 
   if (initResult & RPU_RET_SELECTOR_SWITCH_ON) QueueDIAGNotification(SOUND_EFFECT_DIAG_SELECTOR_SWITCH_ON);
   else QueueDIAGNotification(SOUND_EFFECT_DIAG_SELECTOR_SWITCH_OFF);
@@ -678,7 +707,7 @@ void setup() {
   }
 
   if (initResult & RPU_RET_ORIGINAL_CODE_REQUESTED) {
-    if (DEBUG_MESSAGES) Serial.write("Asked to run original code\n");
+    if (DEBUG_MESSAGES) Channel_DebugEvent(DEBUG_EVENT_ORIGINAL_CODE_REQUESTED, millis());
     delay(100);
     QueueDIAGNotification(SOUND_EFFECT_DIAG_STARTING_ORIGINAL_CODE);
     delay(100);
@@ -766,21 +795,22 @@ void ShowPlayerLamps() {
   }  
 }
 
-byte BonusLampAssignments[11] = {LAMP_BONUS_1K, LAMP_BONUS_2K, LAMP_BONUS_3K, LAMP_BONUS_4K, LAMP_BONUS_5K, LAMP_BONUS_6K, LAMP_BONUS_7K, LAMP_BONUS_8K, LAMP_BONUS_9K, LAMP_BONUS_10K, LAMP_BONUS_20K};
-
 void ShowBonusLamps() {
+  // The bonus lamps are wired as lamps 0-10 (1K-9K, 10K, 20K),
+  // so they're built as one 11-bit value and written as two banks
+  unsigned short bonusLamps;
 
   if (GameMode == GAME_MODE_SKILL_SHOT) {
-    byte bonusPhase = (CurrentTime/100)%11;
-    for (byte count=0; count<11; count++) RPU_SetLampState(BonusLampAssignments[count], count==bonusPhase);
+    bonusLamps = 1 << ((CurrentTime/100)%11);
   } else {
-    RPU_SetLampState(LAMP_BONUS_20K, Bonus[CurrentPlayer]>=20);
-    RPU_SetLampState(LAMP_BONUS_10K, Bonus[CurrentPlayer]>=10 && Bonus[CurrentPlayer]<20);
-    for (byte count=1; count<10; count++) {
-      RPU_SetLampState(BonusLampAssignments[count-1], (Bonus[CurrentPlayer]%10)==count);
-    }
+    byte bonusUnits = Bonus[CurrentPlayer]%10;
+    bonusLamps = (bonusUnits) ? (1 << (bonusUnits-1)) : 0;
+    if (Bonus[CurrentPlayer]>=20) bonusLamps |= (1 << 10);
+    else if (Bonus[CurrentPlayer]>=10) bonusLamps |= (1 << 9);
   }
 
+  Lamp_SetLayerBank(LAMP_LAYER_STATUS, LAMP_BONUS_1K/8, 0xFF, (byte)bonusLamps);
+  Lamp_SetLayerBank(LAMP_LAYER_STATUS, LAMP_BONUS_9K/8, 0x07, (byte)(bonusLamps >> 8));
 }
 
 void ShowBonusXLamps() {
@@ -789,9 +819,9 @@ void ShowBonusXLamps() {
   }
 
   // T
-  RPU_SetLampState(LAMP_2X, BonusX[CurrentPlayer]==2, 0, (BonusXAnimationStart) ? 100 : 0);
-  RPU_SetLampState(LAMP_3X, BonusX[CurrentPlayer]==3, 0, (BonusXAnimationStart) ? 100 : 0);
-  RPU_SetLampState(LAMP_5X, BonusX[CurrentPlayer]==5, 0, (BonusXAnimationStart) ? 100 : 0);
+  Lamp_SetLamp(LAMP_LAYER_STATUS, LAMP_2X, BonusX[CurrentPlayer]==2, 0, (BonusXAnimationStart) ? 100 : 0);
+  Lamp_SetLamp(LAMP_LAYER_STATUS, LAMP_3X, BonusX[CurrentPlayer]==3, 0, (BonusXAnimationStart) ? 100 : 0);
+  Lamp_SetLamp(LAMP_LAYER_STATUS, LAMP_5X, BonusX[CurrentPlayer]==5, 0, (BonusXAnimationStart) ? 100 : 0);
 }
 
 byte LetterLamps[6] = {LAMP_A, LAMP_B, LAMP_C, LAMP_D, LAMP_E, LAMP_F};
@@ -800,16 +830,16 @@ void ShowLetterLamps() {
 
   for (byte count=0; count<6; count++) {
     if (LettersHit[CurrentPlayer][count]==0) {
-      RPU_SetLampState(LetterLamps[count], 1);
+      Lamp_SetLamp(LAMP_LAYER_STATUS, LetterLamps[count], 1);
     } else {
       if (LastTimeLetterHit[count]!=0) {
         if (CurrentTime<(LastTimeLetterHit[count]+500)) {
-          RPU_SetLampState(LetterLamps[count], 1, 0, 50);  
+          Lamp_SetLamp(LAMP_LAYER_STATUS, LetterLamps[count], 1, 0, 50);  
         } else {
           LastTimeLetterHit[count] = 0;
         }
       } else {
-        RPU_SetLampState(LetterLamps[count], 0);
+        Lamp_SetLamp(LAMP_LAYER_STATUS, LetterLamps[count], 0);
       }
       
     }
@@ -819,31 +849,28 @@ void ShowLetterLamps() {
 byte SpinnerLampAssignments[5] = {LAMP_SPINNER_1_BOTTOM, LAMP_SPINNER_2, LAMP_SPINNER_3, LAMP_SPINNER_4, LAMP_SPINNER_5_TOP};
 void ShowSpinnerLamps() {
   for (byte count=0; count<5; count++) {
-    RPU_SetLampState(SpinnerLampAssignments[count], count==SpinnerPhase);
+    Lamp_SetLamp(LAMP_LAYER_STATUS, SpinnerLampAssignments[count], count==SpinnerPhase);
   }
 }
 
-byte SaucerLampAssignments[7] = {LAMP_SAUCER_1K, LAMP_SAUCER_2K, LAMP_SAUCER_4K, LAMP_SAUCER_6K, LAMP_SAUCER_8K, LAMP_SAUCER_10K, LAMP_SAUCER_SPECIAL};
 void ShowSaucerLamps() {
   if (CurrentTime >  (SaucerValueChangedTime + 2000)) {
     SaucerValueChangedTime = 0;
   }
-  if (GameMode==GAME_MODE_SKILL_SHOT) {
-    for (byte count=0; count<7; count++) {
-      RPU_SetLampState(SaucerLampAssignments[count], 0);
-    }
-  } else {
-    for (byte count=0; count<7; count++) {
-      RPU_SetLampState(SaucerLampAssignments[count], SaucerValue[CurrentPlayer]==(count+1), 0, (SaucerValueChangedTime)?100 : 0);
-    }
+
+  // The saucer lamps are the bottom 7 lamps of one bank
+  byte saucerLamps = 0;
+  if (GameMode!=GAME_MODE_SKILL_SHOT && SaucerValue[CurrentPlayer]>0 && SaucerValue[CurrentPlayer]<=7) {
+    saucerLamps = 1 << (SaucerValue[CurrentPlayer]-1);
   }
+  Lamp_SetLayerBank(LAMP_LAYER_STATUS, LAMP_SAUCER_1K/8, 0x7F, saucerLamps, 0, (SaucerValueChangedTime)?100 : 0);
 }
 
 void ShowLaneLamps() {
-  RPU_SetLampState(LAMP_LEFT_OUTLANE, LaneFlags[CurrentPlayer] & LANE_FLAG_LEFT_OUTLANE);
-  RPU_SetLampState(LAMP_LEFT_INLANE, LaneFlags[CurrentPlayer] & LANE_FLAG_LEFT_INLANE);
-  RPU_SetLampState(LAMP_RIGHT_INLANE, LaneFlags[CurrentPlayer] & LANE_FLAG_RIGHT_INLANE);
-  RPU_SetLampState(LAMP_RIGHT_OUTLANE, LaneFlags[CurrentPlayer] & LANE_FLAG_RIGHT_OUTLANE);
+  Lamp_SetLamp(LAMP_LAYER_STATUS, LAMP_LEFT_OUTLANE, LaneFlags[CurrentPlayer] & LANE_FLAG_LEFT_OUTLANE);
+  Lamp_SetLamp(LAMP_LAYER_STATUS, LAMP_LEFT_INLANE, LaneFlags[CurrentPlayer] & LANE_FLAG_LEFT_INLANE);
+  Lamp_SetLamp(LAMP_LAYER_STATUS, LAMP_RIGHT_INLANE, LaneFlags[CurrentPlayer] & LANE_FLAG_RIGHT_INLANE);
+  Lamp_SetLamp(LAMP_LAYER_STATUS, LAMP_RIGHT_OUTLANE, LaneFlags[CurrentPlayer] & LANE_FLAG_RIGHT_OUTLANE);
 }
 
 void ShowDragonLamps() {
@@ -854,8 +881,8 @@ void ShowDragonLamps() {
     DragonsDenHitFor5KTime = 0;
   }
   
-  RPU_SetLampState(LAMP_DRAGONS_DEN_5K, DragonsDenValue[CurrentPlayer]==DRAGONS_DEN_5K, 0, DragonsDenHitFor5KTime ? 50 : 0);
-  RPU_SetLampState(LAMP_DRAGONS_DEN_EB, DragonsDenValue[CurrentPlayer]==DRAGONS_DEN_EXTRA_BALL, 0, DragonsDenHitForEBTime ? 50 : 0);
+  Lamp_SetLamp(LAMP_LAYER_STATUS, LAMP_DRAGONS_DEN_5K, DragonsDenValue[CurrentPlayer]==DRAGONS_DEN_5K, 0, DragonsDenHitFor5KTime ? 50 : 0);
+  Lamp_SetLamp(LAMP_LAYER_STATUS, LAMP_DRAGONS_DEN_EB, DragonsDenValue[CurrentPlayer]==DRAGONS_DEN_EXTRA_BALL, 0, DragonsDenHitForEBTime ? 50 : 0);
 }
 
 
@@ -864,9 +891,9 @@ void ShowShootAgainLamp() {
   if ( (BallFirstSwitchHitTime == 0 && BallSaveNumSeconds) || (BallSaveEndTime && CurrentTime < BallSaveEndTime) ) {
     unsigned long msRemaining = 5000;
     if (BallSaveEndTime != 0) msRemaining = BallSaveEndTime - CurrentTime;
-    RPU_SetLampState(LAMP_SHOOT_AGAIN, 1, 0, (msRemaining < 5000) ? 100 : 500);
+    Lamp_SetLamp(LAMP_LAYER_STATUS, LAMP_SHOOT_AGAIN, 1, 0, (msRemaining < 5000) ? 100 : 500);
   } else {
-    RPU_SetLampState(LAMP_SHOOT_AGAIN, SamePlayerShootsAgain);
+    Lamp_SetLamp(LAMP_LAYER_STATUS, LAMP_SHOOT_AGAIN, SamePlayerShootsAgain);
   }
 }
 
@@ -923,6 +950,7 @@ void AddCredit(boolean playSound = false, byte numToAdd = 1) {
     Credits += numToAdd;
     if (Credits > MaximumCredits) Credits = MaximumCredits;
     RPU_WriteByteToEEProm(RPU_CREDITS_EEPROM_BYTE, Credits);
+    Channel_LogTelemetry(TELEMETRY_EVENT_CREDIT, numToAdd, CurrentTime, Credits);
     if (playSound) {
       //PlaySoundEffect(SOUND_EFFECT_ADD_CREDIT);
       RPU_PushToSolenoidStack(SOL_KNOCKER, KNOCKER_SOLENOID_STRENGTH, true);
@@ -945,6 +973,7 @@ byte SwitchToChuteNum(byte switchHit) {
 boolean AddCoin(byte chuteNum) {
   boolean creditAdded = false;
   if (chuteNum > 2) return false;
+  Channel_LogTelemetry(TELEMETRY_EVENT_COIN, chuteNum, CurrentTime);
   byte cpcSelection = GetCPCSelection(chuteNum);
 
   // Find the lowest chute num with the same ratio selection
@@ -1001,7 +1030,7 @@ boolean AwardExtraBall(boolean basedOnScore = false) {
       if (!basedOnScore) CurrentScores[CurrentPlayer] += ExtraBallValue * PlayfieldMultiplier;
     } else {
       SamePlayerShootsAgain = true;
-      RPU_SetLampState(LAMP_SHOOT_AGAIN, SamePlayerShootsAgain);
+      Lamp_SetLamp(LAMP_LAYER_STATUS, LAMP_SHOOT_AGAIN, SamePlayerShootsAgain);
       QueueNotification(SOUND_EFFECT_VP_EXTRA_BALL, 8);
     }
     return true;
@@ -1132,7 +1161,8 @@ void SetBallSave(unsigned long duration, byte numberOfSaves = 0xFF, boolean addT
 #define OM_GAME_ADJ_SLINGSHOT_STRENGTH              2
 #define OM_GAME_ADJ_POP_BUMPER_STRENGTH             3
 #define OM_GAME_ADJ_MINIMODE_REQUALIFY_BEHAVIOR     4
-#define OM_GAME_ADJ_FINISHED                        5
+#define OM_GAME_ADJ_DISPLAY_REFRESH                 5
+#define OM_GAME_ADJ_FINISHED                        6
 #define SOUND_EFFECT_AP_LOCK_BEHAVIOR               (1800 + OM_GAME_ADJ_TROUGH_EJECT_STRENGTH)
 
 unsigned long SoundSettingTimeout;
@@ -1145,6 +1175,7 @@ void RunOperatorMenu() {
     RPU_SetDisplayCredits(Credits, !FreePlayMode);
     Audio.StopAllAudio();
     RPU_TurnOffAllLamps();
+    Lamp_ClearAllLayers();
     if (MachineState==MACHINE_STATE_ATTRACT) {
       RPU_SetDisplayBallInPlay(0, true);
     } else {
@@ -1458,6 +1489,13 @@ void RunOperatorMenu() {
           currentAdjustmentByte = &TempPopStrength;
           currentAdjustmentStorageByte = EEPROM_POP_BUMPER_STRENGTH;
           break;
+        case OM_GAME_ADJ_DISPLAY_REFRESH:
+          adjustmentType = OPERATOR_MENU_ADJ_TYPE_MIN_MAX;
+          adjustmentValues[0] = DISPLAY_REFRESH_FIXED;
+          adjustmentValues[1] = DISPLAY_REFRESH_ADAPTIVE;
+          currentAdjustmentByte = &DisplayRefreshMode;
+          currentAdjustmentStorageByte = EEPROM_DISPLAY_REFRESH_BYTE;
+          break;
       }
       
       Menus.SetParameterControls(   adjustmentType, numAdjustmentValues, adjustmentValues, parameterCallout,
@@ -1597,7 +1635,7 @@ void PlaySoundEffect(unsigned int soundEffectNum) {
 }
 
 
-void QueueNotification(unsigned int soundEffectNum, byte priority) {
+void QueueNotification(unsigned int soundEffectNum, byte priority, unsigned long expirationTime = VOICE_NOTIFICATION_NO_EXPIRATION) {
   if (CalloutsVolume == 0) return;
 
   // With RPU_OS_HARDWARE_REV 4 and above, the WAV trigger has two-way communication,
@@ -1605,13 +1643,15 @@ void QueueNotification(unsigned int soundEffectNum, byte priority) {
   // earlier hardware, you'll need an array of VoicePromptLengths for each prompt
   // played (for queueing and ducking)
   //  Audio.QueuePrioritizedNotification(soundEffectNum, VoicePromptLengths[soundEffectNum-SOUND_EFFECT_VP_VOICE_NOTIFICATIONS_START], priority, CurrentTime);
-  Audio.QueuePrioritizedNotification(soundEffectNum, 0, priority, CurrentTime);
+  Audio.QueuePrioritizedNotification(soundEffectNum, 0, priority, CurrentTime, expirationTime);
 
 }
 
 
 void AlertPlayerUp() {
-  QueueNotification(SOUND_EFFECT_VP_PLAYER_1_UP + CurrentPlayer, 1);
+  // "Player N up" is meaningless once the ball is in play, so
+  // don't let it sit in the queue for more than a few seconds
+  QueueNotification(SOUND_EFFECT_VP_PLAYER_1_UP + CurrentPlayer, 1, CurrentTime + 3000);
 }
 
 
@@ -1771,9 +1811,10 @@ int RunAttractMode(int curState, boolean curStateChanged) {
     // playing sound
     RPU_DisableSolenoidStack();
     RPU_TurnOffAllLamps();
+    Lamp_ClearAllLayers();
     RPU_SetDisableFlippers(true);    
     if (DEBUG_MESSAGES) {
-      Serial.write("Entering Attract Mode\n\r");
+      Channel_DebugEvent(DEBUG_EVENT_ENTERING_ATTRACT, CurrentTime);
     }
     AttractLastHeadMode = 0;
     RPU_SetDisplayCredits(Credits, !FreePlayMode);
@@ -1787,7 +1828,7 @@ int RunAttractMode(int curState, boolean curStateChanged) {
   if (CurrentTime > (AttractModeStartTime + 5000) && !AttractCheckedForTrappedBall) {
     AttractCheckedForTrappedBall = true;
     if (DEBUG_MESSAGES) {
-      Serial.write("In Attract for 10 seconds - make sure there are no balls trapped\n");
+      Channel_DebugEvent(DEBUG_EVENT_ATTRACT_TRAPPED_BALL_CHECK, CurrentTime);
     }
 
     if (RPU_ReadSingleSwitchState(SW_LEFT_SAUCER)) {
@@ -1856,11 +1897,7 @@ int RunAttractMode(int curState, boolean curStateChanged) {
       Menus.EnterOperatorMenu();
       Menus.SetCreditAndBIPRestore(FreePlayMode?0xFF:Credits, 0);
     } else {
-#ifdef DEBUG_MESSAGES
-      char buf[128];
-      sprintf(buf, "sw %d\n", switchHit);
-      Serial.write(buf);
-#endif       
+      if (DEBUG_MESSAGES) Channel_DebugEvent(DEBUG_EVENT_UNHANDLED_SWITCH, CurrentTime, switchHit);
     }
   }
 
@@ -1910,11 +1947,8 @@ void SetGameMode(byte newGameMode) {
   GameModeStartTime = 0;
   GameModeEndTime = 0;
 
-  if (DEBUG_MESSAGES) {
-    char buf[128];
-    sprintf(buf, "Game Mode = %d\n", newGameMode);
-    Serial.write(buf);
-  }
+  Channel_LogTelemetry(TELEMETRY_EVENT_GAME_MODE, newGameMode, CurrentTime, LastGameMode);
+  if (DEBUG_MESSAGES) Channel_DebugEvent(DEBUG_EVENT_GAME_MODE, CurrentTime, newGameMode);
 }
 
 byte CountBallsInTrough() {
@@ -1967,6 +2001,7 @@ int InitGamePlay(boolean curStateChanged) {
 
   if (curStateChanged) {
     RPU_TurnOffAllLamps();
+    Lamp_ClearAllLayers();
     SetGeneralIlluminationOn(true);
     GameStartNotificationTime = CurrentTime;
     Audio.StopAllAudio();
@@ -2031,6 +2066,7 @@ int InitNewBall(bool curStateChanged) {
   if (curStateChanged) {
     //RPU_FireContinuousSolenoid(0x20, 5);
     RPU_TurnOffAllLamps();
+    Lamp_ClearAllLayers();
     RPU_EnableSolenoidStack();
     RPU_SetDisableFlippers(false);
     BallFirstSwitchHitTime = 0;
@@ -2049,7 +2085,7 @@ int InitNewBall(bool curStateChanged) {
     }
 
     if (BallSaveNumSeconds > 0) {
-      RPU_SetLampState(LAMP_SHOOT_AGAIN, 1, 0, 500);
+      Lamp_SetLamp(LAMP_LAYER_STATUS, LAMP_SHOOT_AGAIN, 1, 0, 500);
     }
 
     BallSaveUsed = false;
@@ -2209,7 +2245,6 @@ unsigned long LastLoopTick = 0;
 int ManageGameMode() {
   int returnState = MACHINE_STATE_NORMAL_GAMEPLAY;
 
-  boolean specialAnimationRunning = false;
   boolean statusRunning = false;
 
   if ((CurrentTime - LastSwitchHitTime) > 3000) TimersPaused = true;
@@ -2282,7 +2317,7 @@ int ManageGameMode() {
         GameModeStartTime = CurrentTime;
         DisplaysNeedRefreshing = true;
         if (DEBUG_MESSAGES) {
-          Serial.write("Entering unstructured play\n");
+          Channel_DebugEvent(DEBUG_EVENT_UNSTRUCTURED_PLAY, CurrentTime);
         }
         SetGeneralIlluminationOn(true);
         unsigned short songNum = SOUND_EFFECT_BACKGROUND_SONG_1;
@@ -2321,7 +2356,9 @@ int ManageGameMode() {
 
   }
 
-  if ( !statusRunning && !specialAnimationRunning && NumTiltWarnings <= MaxTiltWarnings ) {
+  // Status lamps draw into their own layer, so anything
+  // shown over them doesn't have to stop them updating
+  if ( NumTiltWarnings <= MaxTiltWarnings ) {
     ShowBonusLamps();
     ShowBonusXLamps();
     ShowLetterLamps();
@@ -2361,27 +2398,25 @@ int ManageGameMode() {
           if (BallSaveEndTime && CurrentTime < (BallSaveEndTime + BALL_SAVE_GRACE_PERIOD)) {
             RPU_PushToTimedSolenoidStack(SOL_OUTHOLE, BallServeSolenoidStrength, CurrentTime + 100);
 
-            RPU_SetLampState(LAMP_SHOOT_AGAIN, 0);
+            Lamp_SetLamp(LAMP_LAYER_STATUS, LAMP_SHOOT_AGAIN, 0);
             BallTimeInTrough = CurrentTime;
             returnState = MACHINE_STATE_NORMAL_GAMEPLAY;
 
+            Channel_LogTelemetry(TELEMETRY_EVENT_BALL_SAVE, CurrentPlayer, CurrentTime, NumberOfBallSavesRemaining);
             if (NumberOfBallSavesRemaining && NumberOfBallSavesRemaining != 0xFF) {
               NumberOfBallSavesRemaining -= 1;
               if (NumberOfBallSavesRemaining == 0) {
                 BallSaveEndTime = 0;
-                if (DEBUG_MESSAGES) {
-                  Serial.write("Last ball save\n");
-                }
+                if (DEBUG_MESSAGES) Channel_DebugEvent(DEBUG_EVENT_BALL_SAVE, CurrentTime, 0);
                 QueueNotification(SOUND_EFFECT_VP_BALL_SAVE, 10);
               } else {
-                if (DEBUG_MESSAGES) {
-                  Serial.write("Not last ball save\n");
-                }                
+                if (DEBUG_MESSAGES) Channel_DebugEvent(DEBUG_EVENT_BALL_SAVE, CurrentTime, NumberOfBallSavesRemaining);
               }
             }
 
           } else {
 
+            Channel_LogTelemetry(TELEMETRY_EVENT_BALL_DRAIN, CurrentPlayer, CurrentTime, CurrentBallInPlay);
             NumberOfBallsInPlay -= 1;
             if (NumberOfBallsInPlay == 0) {
               Display_ClearOverride(0xFF);
@@ -2494,7 +2529,7 @@ int CountdownBonus(boolean curStateChanged) {
   if (CurrentTime > BonusCountDownEndTime) {
 
     if (DEBUG_MESSAGES) {
-      Serial.write("Count down over, moving to ball over\n");
+      Channel_DebugEvent(DEBUG_EVENT_COUNTDOWN_OVER, CurrentTime);
     }
     // Reset any lights & variables of goals that weren't completed
     BonusCountDownEndTime = 0xFFFFFFFF;
@@ -2679,10 +2714,12 @@ int HandleSystemSwitches(int curState, byte switchHit) {
         if ( CurrentTime > (LastTiltWarningTime + TILT_WARNING_DEBOUNCE_TIME) ) {
           LastTiltWarningTime = CurrentTime;
           NumTiltWarnings += 1;
+          Channel_LogTelemetry(TELEMETRY_EVENT_TILT_WARNING, CurrentPlayer, CurrentTime, NumTiltWarnings);
           if (NumTiltWarnings > MaxTiltWarnings) {
             RPU_DisableSolenoidStack();
             RPU_SetDisableFlippers(true);
             RPU_TurnOffAllLamps();
+            Lamp_ClearAllLayers();
             Audio.StopAllAudio();
             if (BallSaveEndTime) {
               BallSaveEndTime = 0;
@@ -2787,6 +2824,8 @@ void ToggleLaneFlags() {
 
 void HandleGamePlaySwitches(byte switchHit) {
 
+  unsigned long scoreBeforeSwitch = CurrentScores[CurrentPlayer];
+
   switch (switchHit) {
 
     case SW_ROLLOVER_RIGHT_STANDUP:
@@ -2929,6 +2968,10 @@ void HandleGamePlaySwitches(byte switchHit) {
 
   }
 
+  if (CurrentScores[CurrentPlayer] != scoreBeforeSwitch) {
+    Channel_LogTelemetry(TELEMETRY_EVENT_SCORE, switchHit, CurrentTime, CurrentScores[CurrentPlayer] - scoreBeforeSwitch);
+  }
+
 }
 
 
@@ -3000,7 +3043,7 @@ int RunGamePlayMode(int curState, boolean curStateChanged) {
       // If we haven't finished the first ball, we can add players
       AddPlayer();
       if (DEBUG_MESSAGES) {
-        Serial.write("Start game button pressed\n\r");
+        Channel_DebugEvent(DEBUG_EVENT_START_BUTTON, CurrentTime, CurrentNumPlayers);
       }
       CreditResetPressStarted = 0;
     } else {
@@ -3068,6 +3111,27 @@ unsigned long LastLEDUpdateTime = 0;
 byte LEDPhase = 0;
 #endif
 
+#if (RPU_MPU_ARCHITECTURE<10)
+void UpdateDisplayRefreshRate() {
+  // Several queued solenoids or a burst of WAV Trigger commands
+  // means the loop needs the time more than the displays do -
+  // hold the slower rate for a moment so it doesn't hunt
+  unsigned long framesSent = Audio.GetFramesSent();
+  if (framesSent < LastAudioFramesSent) LastAudioFramesSent = 0;
+  if (RPU_GetSolenoidStackDepth() > 1 || (framesSent - LastAudioFramesSent) > 2) {
+    DisplayRefreshBusyUntil = CurrentTime + DISPLAY_REFRESH_BUSY_HOLD_MS;
+  }
+  LastAudioFramesSent = framesSent;
+
+  int refreshConstant = RPU_OS_SOFTWARE_DISPLAY_INTERRUPT_INTERVAL;
+  if (DisplayRefreshMode == DISPLAY_REFRESH_ADAPTIVE && !Menus.OperatorMenusActive()) {
+    if (MachineState == MACHINE_STATE_ATTRACT) refreshConstant = RPU_OS_MIN_DISPLAY_INTERRUPT_INTERVAL;
+    else if (CurrentTime < DisplayRefreshBusyUntil) refreshConstant = RPU_OS_MAX_DISPLAY_INTERRUPT_INTERVAL;
+  }
+  RPU_SetDisplayRefreshConstant(refreshConstant);
+}
+#endif
+
 #ifdef DEBUG_SHOW_LOOPS_PER_SECOND
 unsigned long NumLoops = 0;
 unsigned long LastLoopReportTime = 0;
@@ -3084,15 +3148,18 @@ void loop() {
   if (LastLoopReportTime==0) LastLoopReportTime = CurrentTime;
   if (CurrentTime>(LastLoopReportTime+1000)) {
     LastLoopReportTime = CurrentTime;
-    char buf[128];
-    sprintf(buf, "Loop running at %lu Hz (alive for %d seconds)\n", NumLoops, (int)(CurrentTime/1000));
-    Serial.write(buf);
+    Channel_DebugEvent(DEBUG_EVENT_LOOPS_PER_SECOND, CurrentTime, (long)NumLoops);
     NumLoops = 0;
+#ifdef DEBUG_SHOW_AUDIO_TRAFFIC
+    Audio.OutputTrafficStats(CurrentTime);
+#endif
   }
 #endif
 
   if (Menus.OperatorMenusActive()) {
     RunOperatorMenu();
+    // Display_UpdateDisplays() isn't called in the menus
+    Display_UpdateFrameClock();
   } else {
     if (MachineState < 0) {
       newMachineState = 0;
@@ -3110,10 +3177,16 @@ void loop() {
     } else {
       MachineStateChanged = false;
     }
+
+    Lamp_UpdateLamps(CurrentTime);
   }
   
   RPU_Update(CurrentTime);
   Audio.Update(CurrentTime);
+  Channel_ServiceTelemetry(CurrentTime);
+#if (RPU_MPU_ARCHITECTURE<10)
+  UpdateDisplayRefreshRate();
+#endif
 
 #if (RPU_MPU_ARCHITECTURE>=10)
   if (LastLEDUpdateTime == 0 || (CurrentTime - LastLEDUpdateTime) > 250) {
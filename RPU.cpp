@@ -25,6 +25,9 @@
 #define RPU_CPP_FILE
 #include "RPU_Config.h"
 #include "RPU.h"
+#ifdef RPU_OS_USE_TELEMETRY
+#include "SerialChannels.h"
+#endif
 
 #define DEBUG_MESSAGES  0
 
@@ -113,10 +116,48 @@ volatile byte DisplayText[2][RPU_OS_NUM_DIGITS];
 // Global variables
 volatile byte DisplayDigits[5][RPU_OS_NUM_DIGITS];
 volatile byte DisplayDigitEnable[5];
+// One bit per display written since RPU_GetDisplaysWritten()
+byte DisplaysWritten = 0;
 volatile boolean DisplayOffCycle = false;
 volatile byte CurrentDisplayDigit = 0;
+#if (RPU_MPU_ARCHITECTURE<10)
+// Displays that are completely blank only need to be
+// latched with a blank digit once - after that the
+// display ISR leaves them alone
+volatile byte DisplaysLatchedBlank = 0;
+unsigned short DisplayRefreshConstant = RPU_OS_SOFTWARE_DISPLAY_INTERRUPT_INTERVAL;
+#endif
 volatile byte LampStates[RPU_NUM_LAMP_BANKS], LampDim1[RPU_NUM_LAMP_BANKS], LampDim2[RPU_NUM_LAMP_BANKS];
 volatile byte LampFlashPeriod[RPU_MAX_LAMPS];
+byte LampFlashing[RPU_NUM_LAMP_BANKS];
+#ifdef RPU_OS_USE_LAMP_BRIGHTNESS
+// Brightness levels are kept as three bit planes (weights 1, 2, 4).
+// The lamp ISR shows plane 2 on four zero crossings out of every
+// seven, plane 1 on two, and plane 0 on one.
+#define LAMP_BRIGHTNESS_PLANES    3
+#define LAMP_BRIGHTNESS_SLOTS     7
+const byte LampBrightnessSlotPlane[LAMP_BRIGHTNESS_SLOTS] = {2, 1, 2, 0, 2, 1, 2};
+byte LampBrightnessPlanes[LAMP_BRIGHTNESS_PLANES][RPU_NUM_LAMP_BANKS];
+// Lamps with an explicit level (the rest use LampDim1/LampDim2)
+byte LampBrightnessSet[RPU_NUM_LAMP_BANKS];
+byte LampFading[RPU_NUM_LAMP_BANKS];
+// What the ISR writes for each plane (active low, like
+// LampStates) - rebuilt by RPU_Update
+volatile byte LampPlaneOutput[LAMP_BRIGHTNESS_PLANES][RPU_NUM_LAMP_BANKS];
+volatile byte LampBrightnessSlot = 0;
+
+#define LAMP_FADE_SLOTS           8
+#define LAMP_FADE_UNUSED          0xFF
+struct LampFade {
+  byte lampNum;
+  byte fromLevel;
+  byte toLevel;
+  boolean pulse;
+  unsigned long startTime;
+  unsigned short duration;
+};
+LampFade LampFades[LAMP_FADE_SLOTS];
+#endif
 byte DimDivisor1 = 2;
 byte DimDivisor2 = 3;
 
@@ -166,6 +207,47 @@ volatile byte SwitchStackFirst;
 volatile byte SwitchStackLast;
 volatile byte SwitchStack[SWITCH_STACK_SIZE];
 
+#if defined(RPU_OS_USE_S_AND_T) || defined(RPU_OS_USE_DASH50) || defined(RPU_OS_USE_DASH51)
+// Playing a sound is just a push onto this queue. The latch is
+// strobed by a small state machine that runs each phase (tens to
+// hundreds of microseconds) off a one-shot on Timer3, so nothing
+// masks interrupts or busy-waits while a sound goes out. Boards
+// without Timer3 fall back to strobing with interrupts masked.
+#define SOUND_LATCH_QUEUE_SIZE        16
+#define SOUND_LATCH_IDLE              0
+#define SOUND_LATCH_STROBE_LOW        1
+#define SOUND_LATCH_FIRST_NIBBLE      2
+#define SOUND_LATCH_SECOND_NIBBLE     3
+
+#ifdef RPU_OS_USE_S_AND_T
+#define SOUND_LATCH_STROBE_LOW_US     32
+#define SOUND_LATCH_FIRST_NIBBLE_US   138
+#define SOUND_LATCH_SECOND_NIBBLE_US  145
+#else
+#define SOUND_LATCH_STROBE_LOW_US     68
+#define SOUND_LATCH_FIRST_NIBBLE_US   180
+#endif
+
+#if defined(TCCR3A)
+#define SOUND_LATCH_USE_TIMER3
+// Timer3 runs at F_CPU/8 (2 counts per microsecond at 16 MHz)
+#define SOUND_LATCH_COUNTS_PER_US     (F_CPU/8000000UL)
+// A sound is only started when the display timer (64 us per
+// count) is at least this far from its next tick, so a whole
+// sound fits between two display refreshes
+#define SOUND_LATCH_DISPLAY_MARGIN    8
+#endif
+
+volatile byte SoundLatchQueue[SOUND_LATCH_QUEUE_SIZE];
+volatile byte SoundLatchQueueFirst = 0;
+volatile byte SoundLatchQueueLast = 0;
+volatile byte SoundLatchPhase = SOUND_LATCH_IDLE;
+byte SoundLatchByte;
+// What the sequencer has on the momentary solenoid lines
+volatile byte SoundLatchNibble;
+byte SoundLatchDisplayBit;
+#endif
+
 
 // The WTYPE1 and WTYPE2 sound cards can only play one sound at a time,
 // so these structures allow the app to send in as many calls as they
@@ -1376,6 +1458,10 @@ byte RPU_PullFirstFromSwitchStack() {
   SwitchStackFirst += 1;
   if (SwitchStackFirst >= SWITCH_STACK_SIZE) SwitchStackFirst = 0;
 
+#ifdef RPU_OS_USE_TELEMETRY
+  Channel_LogTelemetry(TELEMETRY_EVENT_SWITCH, retVal, millis());
+#endif
+
   return retVal;
 }
 
@@ -1388,6 +1474,11 @@ boolean RPU_ReadSingleSwitchState(byte switchNum) {
   else return false;
 }
 
+byte RPU_ReadSwitchByte(byte switchByte) {
+  if (switchByte >= NUM_SWITCH_BYTES) return 0x00;
+  return SwitchesNow[switchByte];
+}
+
 boolean RPU_SetSwitchInversion(byte switchNum) {
   if (switchNum >= MAX_NUM_SWITCHES) return false;
   byte oldSwitchInverter = SwitchInverter[switchNum / 8];
@@ -1522,6 +1613,25 @@ void RPU_UpdateTimedSolenoidStack(unsigned long curTime) {
 
 #if (RPU_MPU_ARCHITECTURE<10)
 
+// RPU_MPU_ARCHITECTURE < 10
+void WriteCurrentSolenoidByte() {
+#if defined(RPU_OS_USE_S_AND_T) || defined(RPU_OS_USE_DASH50) || defined(RPU_OS_USE_DASH51)
+  // While a sound is being latched, the sequencer owns the momentary
+  // lines for a few hundred microseconds. The continuous solenoids
+  // still go out now, and the last phase writes CurrentSolenoidByte.
+  byte oldSREG = SREG;
+  cli();
+  if (SoundLatchPhase != SOUND_LATCH_IDLE) {
+    RPU_DataWrite(ADDRESS_U11_B, (CurrentSolenoidByte & 0xF0) | SoundLatchNibble);
+  } else {
+    RPU_DataWrite(ADDRESS_U11_B, CurrentSolenoidByte);
+  }
+  SREG = oldSREG;
+#else
+  RPU_DataWrite(ADDRESS_U11_B, CurrentSolenoidByte);
+#endif
+}
+
 // RPU_MPU_ARCHITECTURE < 10
 void RPU_SetCoinLockout(boolean lockoutOff, byte solbit) {
   if (!lockoutOff) {
@@ -1529,7 +1639,7 @@ void RPU_SetCoinLockout(boolean lockoutOff, byte solbit) {
   } else {
     CurrentSolenoidByte = CurrentSolenoidByte | solbit;
   }
-  RPU_DataWrite(ADDRESS_U11_B, CurrentSolenoidByte);
+  WriteCurrentSolenoidByte();
 }
 
 // RPU_MPU_ARCHITECTURE < 10
@@ -1540,7 +1650,7 @@ void RPU_SetDisableFlippers(boolean disableFlippers, byte solbit) {
     CurrentSolenoidByte = CurrentSolenoidByte & ~solbit;
   }
 
-  RPU_DataWrite(ADDRESS_U11_B, CurrentSolenoidByte);
+  WriteCurrentSolenoidByte();
 }
 
 // RPU_MPU_ARCHITECTURE < 10
@@ -1555,7 +1665,7 @@ void RPU_SetContinuousSolenoidBit(boolean bitOn, byte solbit) {
   } else {
     CurrentSolenoidByte = CurrentSolenoidByte & ~solbit;
   }
-  RPU_DataWrite(ADDRESS_U11_B, CurrentSolenoidByte);
+  WriteCurrentSolenoidByte();
 }
 
 // RPU_MPU_ARCHITECTURE < 10
@@ -1589,6 +1699,11 @@ boolean RPU_IsSolenoidStackEnabled() {
   return SolenoidStackEnabled;
 }
 
+// RPU_MPU_ARCHITECTURE < 10
+byte RPU_GetSolenoidStackDepth() {
+  return (SOLENOID_STACK_SIZE - 1) - SpaceLeftOnSolenoidStack();
+}
+
 #elif (RPU_MPU_ARCHITECTURE>=10)
 // RPU_MPU_ARCHITECTURE >= 10
 void RPU_SetDisableFlippers(boolean disableFlippers, byte solbit) {
@@ -1659,10 +1774,71 @@ boolean RPU_IsSolenoidStackEnabled() {
  *    
  *    
 *******************************************************/
+
+// Packed BCD holds one decimal digit per nibble (8 digits
+// in an unsigned long), so digits can be pulled out and
+// shifted without the software divide the AVR needs for / and %
+unsigned long BCDPowersOfTen[8] = {10000000, 1000000, 100000, 10000, 1000, 100, 10, 1};
+
+unsigned long RPU_ConvertToBCD(unsigned long value) {
+  // Anything past 8 digits is dropped
+  while (value >= 100000000) value -= 100000000;
+
+  unsigned long bcdValue = 0;
+  for (byte count = 0; count < 8; count++) {
+    byte digit = 0;
+    while (value >= BCDPowersOfTen[count]) {
+      value -= BCDPowersOfTen[count];
+      digit += 1;
+    }
+    bcdValue = (bcdValue << 4) | digit;
+  }
+  return bcdValue;
+}
+
+unsigned long RPU_ConvertFromBCD(unsigned long bcdValue) {
+  unsigned long value = 0;
+  for (byte count = 0; count < 8; count++) {
+    value = (value * 10) + (bcdValue >> 28);
+    bcdValue <<= 4;
+  }
+  return value;
+}
+
+unsigned long RPU_AddBCD(unsigned long bcdValue1, unsigned long bcdValue2) {
+  // Add with every nibble biased by 6 so decimal carries
+  // become binary carries, then take the bias back out of
+  // the nibbles that didn't carry
+  unsigned long biased = bcdValue1 + 0x06666666;
+  unsigned long sum = biased + bcdValue2;
+  unsigned long noCarry = ~(sum ^ biased ^ bcdValue2) & 0x11111110;
+  return sum - ((noCarry >> 2) | (noCarry >> 3));
+}
+
+unsigned long RPU_MultiplyBCD(unsigned long bcdValue, byte multiplier) {
+  unsigned long result = 0;
+  while (multiplier) {
+    if (multiplier & 0x01) result = RPU_AddBCD(result, bcdValue);
+    bcdValue = RPU_AddBCD(bcdValue, bcdValue);
+    multiplier >>= 1;
+  }
+  return result;
+}
+
+byte RPU_MagnitudeOfBCD(unsigned long bcdValue) {
+  byte numDigits = 0;
+  while (bcdValue) {
+    bcdValue >>= 4;
+    numDigits += 1;
+  }
+  return numDigits;
+}
+
 #if (RPU_MPU_ARCHITECTURE<15)
 // RPU_MPU_ARCHITECTURE < 15
 byte RPU_SetDisplay(int displayNumber, unsigned long value, boolean blankByMagnitude, byte minDigits, boolean showCommasByMagnitude) {
   if (displayNumber < 0 || displayNumber > 4) return 0;
+  DisplaysWritten |= (0x01 << displayNumber);
 
   byte blank = 0x00;
 #if (RPU_MPU_ARCHITECTURE>=13)
@@ -1697,6 +1873,45 @@ byte RPU_SetDisplay(int displayNumber, unsigned long value, boolean blankByMagni
 
   return blank;
 }
+
+// RPU_MPU_ARCHITECTURE < 15
+byte RPU_SetDisplayBCD(int displayNumber, unsigned long bcdValue, boolean blankByMagnitude, byte minDigits, boolean showCommasByMagnitude) {
+  if (displayNumber < 0 || displayNumber > 4) return 0;
+  DisplaysWritten |= (0x01 << displayNumber);
+
+  byte blank = 0x00;
+#if (RPU_MPU_ARCHITECTURE>=13)
+  byte commaBit = 0x01 << (2 * displayNumber);
+  if (!showCommasByMagnitude) {
+    DisplayCommas &= ~(commaBit | (commaBit * 2));
+  }
+#endif
+
+  for (int count = 0; count < RPU_OS_NUM_DIGITS; count++) {
+    blank = blank * 2;
+    if (bcdValue != 0 || count < minDigits) blank |= 1;
+
+#if (RPU_MPU_ARCHITECTURE>=13)
+    if (showCommasByMagnitude) {
+      if (bcdValue) {
+        if (count == 3) DisplayCommas |= commaBit;
+        if (count == 6) DisplayCommas |= (commaBit * 2);
+      } else {
+        if (count == 3) DisplayCommas &= ~(commaBit);
+        if (count == 6) DisplayCommas &= ~(commaBit * 2);
+      }
+    }
+#else
+    (void)showCommasByMagnitude;
+#endif
+    DisplayDigits[displayNumber][(RPU_OS_NUM_DIGITS - 1) - count] = bcdValue & 0x0F;
+    bcdValue >>= 4;
+  }
+
+  if (blankByMagnitude) DisplayDigitEnable[displayNumber] = blank;
+
+  return blank;
+}
 #endif
 
 
@@ -1857,6 +2072,7 @@ void RPU_SetDisplayMatch(int value, boolean displayOn, boolean showBothDigits) {
 //   bit=   b0 b1 b2 b3 b4 b5
 void RPU_SetDisplayBlank(int displayNumber, byte bitMask) {
   if (displayNumber < 0 || displayNumber > 4) return;
+  DisplaysWritten |= (0x01 << displayNumber);
 
 #if (RPU_MPU_ARCHITECTURE>=13)
   if (bitMask == 0x00) {
@@ -1868,12 +2084,39 @@ void RPU_SetDisplayBlank(int displayNumber, byte bitMask) {
   DisplayDigitEnable[displayNumber] = bitMask;
 }
 
+byte RPU_GetDisplaysWritten() {
+  byte displaysWritten = DisplaysWritten;
+  DisplaysWritten = 0;
+  return displaysWritten;
+}
+
 byte RPU_GetDisplayBlank(int displayNumber) {
   if (displayNumber < 0 || displayNumber > 4) return 0;
   return DisplayDigitEnable[displayNumber];
 }
 
-#if defined(RPU_OS_ADJUSTABLE_DISPLAY_INTERRUPT)
+#if (RPU_MPU_ARCHITECTURE<10)
+void RPU_SetDisplayRefreshConstant(int intervalConstant) {
+  if (intervalConstant < RPU_OS_MIN_DISPLAY_INTERRUPT_INTERVAL) intervalConstant = RPU_OS_MIN_DISPLAY_INTERRUPT_INTERVAL;
+  if (intervalConstant > RPU_OS_MAX_DISPLAY_INTERRUPT_INTERVAL) intervalConstant = RPU_OS_MAX_DISPLAY_INTERRUPT_INTERVAL;
+  if ((unsigned short)intervalConstant == DisplayRefreshConstant) return;
+  DisplayRefreshConstant = intervalConstant;
+
+  // Timer1 keeps running - only the compare value changes.
+  // If the counter is already past the new value it would
+  // have to wrap at 0xFFFF (about 4 seconds with no display
+  // refresh), so restart the count instead.
+  byte oldSREG = SREG;
+  cli();
+  OCR1A = intervalConstant;
+  if (TCNT1 >= (unsigned short)intervalConstant) TCNT1 = 0;
+  SREG = oldSREG;
+}
+
+int RPU_GetDisplayRefreshConstant() {
+  return DisplayRefreshConstant;
+}
+#elif defined(RPU_OS_ADJUSTABLE_DISPLAY_INTERRUPT)
 void RPU_SetDisplayRefreshConstant(int intervalConstant) {
   cli();
   //set timer1 interrupt at 1Hz
@@ -1918,6 +2161,7 @@ void RPU_SetDisplayFlashCredits(unsigned long curTime, int period) {
 // RPU_MPU_ARCHITECTURE = 15
 byte RPU_SetDisplayText(int displayNumber, char *text, boolean blankByLength) {
   if (displayNumber > 1 || displayNumber < 0) return 0;
+  DisplaysWritten |= (0x01 << displayNumber);
   byte stringLength = 0xff;
   boolean writeSpace = false;
   byte blank = 0;
@@ -1941,6 +2185,7 @@ byte RPU_SetDisplayText(int displayNumber, char *text, boolean blankByLength) {
 // RPU_MPU_ARCHITECTURE = 15
 byte RPU_SetDisplay(int displayNumber, unsigned long value, boolean blankByMagnitude, byte minDigits, boolean showCommasByMagnitude) {
   if (displayNumber < 0 || displayNumber > 3) return 0;
+  DisplaysWritten |= (0x01 << displayNumber);
 
   byte blank = 0x00;
 
@@ -1962,6 +2207,32 @@ byte RPU_SetDisplay(int displayNumber, unsigned long value, boolean blankByMagni
   return blank;
 }
 
+// RPU_MPU_ARCHITECTURE = 15
+byte RPU_SetDisplayBCD(int displayNumber, unsigned long bcdValue, boolean blankByMagnitude, byte minDigits, boolean showCommasByMagnitude) {
+  if (displayNumber < 0 || displayNumber > 3) return 0;
+  DisplaysWritten |= (0x01 << displayNumber);
+  (void)showCommasByMagnitude;
+
+  byte blank = 0x00;
+
+  for (int count = 0; count < RPU_OS_NUM_DIGITS; count++) {
+    blank = blank * 2;
+    if (bcdValue != 0 || count < minDigits) {
+      blank |= 1;
+      if (displayNumber / 2) DisplayDigits[displayNumber][(RPU_OS_NUM_DIGITS - 1) - count] = SevenSegmentNumbers[bcdValue & 0x0F];
+      else DisplayText[displayNumber][(RPU_OS_NUM_DIGITS - 1) - count] = (bcdValue & 0x0F) + 16;
+    } else {
+      if (displayNumber / 2) DisplayDigits[displayNumber][(RPU_OS_NUM_DIGITS - 1) - count] = 0;
+      else DisplayText[displayNumber][(RPU_OS_NUM_DIGITS - 1) - count] = 0;
+    }
+    bcdValue >>= 4;
+  }
+
+  if (blankByMagnitude) DisplayDigitEnable[displayNumber] = blank;
+
+  return blank;
+}
+
 // RPU_MPU_ARCHITECTURE = 15
 void RPU_SetDisplayCredits(int value, boolean displayOn, boolean showBothDigits) {
   byte blank = 0x02;
@@ -2013,25 +2284,68 @@ void RPU_SetDimDivisor(byte level, byte divisor) {
 // left shift is iterative on Arduinos, so a bit array is suprisingly faster
 byte BitShiftValues[8] = {0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80};
 
+byte ConvertFlashPeriod(int flashPeriod) {
+  if (flashPeriod <= 0) return 0;
+  int adjustedLampFlash = flashPeriod / 50;
+  if (adjustedLampFlash == 0) adjustedLampFlash = 1;
+  if (adjustedLampFlash > 250) adjustedLampFlash = 250;
+  return (byte)adjustedLampFlash;
+}
+
+#ifdef RPU_OS_USE_LAMP_BRIGHTNESS
+void StopLampFades(byte bankNum, byte mask) {
+  if ((LampFading[bankNum] & mask) == 0) return;
+  for (byte fadeSlot = 0; fadeSlot < LAMP_FADE_SLOTS; fadeSlot++) {
+    byte lampNum = LampFades[fadeSlot].lampNum;
+    if (lampNum == LAMP_FADE_UNUSED || (lampNum / 8) != bankNum) continue;
+    if (mask & BitShiftValues[lampNum % 8]) LampFades[fadeSlot].lampNum = LAMP_FADE_UNUSED;
+  }
+  LampFading[bankNum] &= ~mask;
+}
+
+void ReleaseLampBrightness(byte bankNum, byte mask) {
+  // The legacy calls go back to LampDim1/LampDim2
+  StopLampFades(bankNum, mask);
+  LampBrightnessSet[bankNum] &= ~mask;
+}
+
+void SetLampBrightnessBits(byte lampNum, byte level) {
+  byte bankNum = lampNum / 8;
+  byte lampBit = BitShiftValues[lampNum % 8];
+
+  for (byte plane = 0; plane < LAMP_BRIGHTNESS_PLANES; plane++) {
+    if (level & BitShiftValues[plane]) LampBrightnessPlanes[plane][bankNum] |= lampBit;
+    else LampBrightnessPlanes[plane][bankNum] &= ~lampBit;
+  }
+  LampBrightnessSet[bankNum] |= lampBit;
+
+  if (level) LampStates[bankNum] &= ~lampBit;
+  else LampStates[bankNum] |= lampBit;
+}
+#endif
+
 void RPU_SetLampState(int lampNum, byte s_lampState, byte s_lampDim, int s_lampFlashPeriod) {
   if (lampNum >= RPU_MAX_LAMPS || lampNum < 0) return;
   byte lampRow = lampNum % 8;
   byte lampCol = lampNum / 8;
   byte lampBit = BitShiftValues[lampRow];
+#ifdef RPU_OS_USE_LAMP_BRIGHTNESS
+  ReleaseLampBrightness(lampCol, lampBit);
+#endif
 
   if (s_lampState) {
-    int adjustedLampFlash = s_lampFlashPeriod / 50;
-
-    if (s_lampFlashPeriod != 0 && adjustedLampFlash == 0) adjustedLampFlash = 1;
-    if (adjustedLampFlash > 250) adjustedLampFlash = 250;
+    byte adjustedLampFlash = ConvertFlashPeriod(s_lampFlashPeriod);
 
     // Only turn on the lamp if there's no flash, because if there's a flash
     // then the lamp will be turned on by the ApplyFlashToLamps function
-    if (s_lampFlashPeriod == 0) LampStates[lampCol] &= ~(lampBit);
+    if (adjustedLampFlash == 0) LampStates[lampCol] &= ~(lampBit);
     LampFlashPeriod[lampNum] = adjustedLampFlash;
+    if (adjustedLampFlash) LampFlashing[lampCol] |= lampBit;
+    else LampFlashing[lampCol] &= ~lampBit;
   } else {
     LampStates[lampCol] |= lampBit;
     LampFlashPeriod[lampNum] = 0;
+    LampFlashing[lampCol] &= ~lampBit;
   }
 
   if (s_lampDim & 0x01) {
@@ -2048,6 +2362,182 @@ void RPU_SetLampState(int lampNum, byte s_lampState, byte s_lampDim, int s_lampF
 
 }
 
+void SetLampBankFlash(byte bankNum, byte mask, byte flashingLamps, byte adjustedLampFlash) {
+  // Only lamps that are (or were) flashing need their period touched
+  byte changedLamps = (LampFlashing[bankNum] & mask) | flashingLamps;
+  if (changedLamps == 0) return;
+
+  byte lampNum = bankNum * 8;
+  for (byte lampBit = 0x01; lampBit; lampBit *= 2, lampNum++) {
+    if (changedLamps & lampBit) LampFlashPeriod[lampNum] = (flashingLamps & lampBit) ? adjustedLampFlash : 0;
+  }
+  LampFlashing[bankNum] = (LampFlashing[bankNum] & ~mask) | flashingLamps;
+}
+
+void RPU_SetLampBank(byte bankNum, byte mask, byte lampsOn, byte dimLevel, int flashPeriod) {
+  if (bankNum >= RPU_NUM_LAMP_BANKS) return;
+  lampsOn &= mask;
+#ifdef RPU_OS_USE_LAMP_BRIGHTNESS
+  ReleaseLampBrightness(bankNum, mask);
+#endif
+
+  byte adjustedLampFlash = ConvertFlashPeriod(flashPeriod);
+  SetLampBankFlash(bankNum, mask, adjustedLampFlash ? lampsOn : 0, adjustedLampFlash);
+
+  // LampStates is active low. Flashing lamps are
+  // left alone - RPU_ApplyFlashToLamps will set them.
+  byte lampStates = LampStates[bankNum] | (mask & ~LampFlashing[bankNum]);
+  if (!adjustedLampFlash) lampStates &= ~lampsOn;
+  LampStates[bankNum] = lampStates;
+
+  byte dimLamps = (dimLevel & 0x01) ? lampsOn : 0;
+  LampDim1[bankNum] = (LampDim1[bankNum] & ~mask) | dimLamps;
+  dimLamps = (dimLevel & 0x02) ? lampsOn : 0;
+  LampDim2[bankNum] = (LampDim2[bankNum] & ~mask) | dimLamps;
+}
+
+void RPU_SetLampFrame(const byte *lampsOn, const byte *frameMask, const byte *lampsDim1, const byte *lampsDim2) {
+  // Flash periods are cleared first so the lamp
+  // banks themselves can be swapped in one go
+  for (byte bankNum = 0; bankNum < RPU_NUM_LAMP_BANKS; bankNum++) {
+    SetLampBankFlash(bankNum, frameMask ? frameMask[bankNum] : 0xFF, 0, 0);
+#ifdef RPU_OS_USE_LAMP_BRIGHTNESS
+    ReleaseLampBrightness(bankNum, frameMask ? frameMask[bankNum] : 0xFF);
+#endif
+  }
+
+  byte oldSREG = SREG;
+  cli();
+  for (byte bankNum = 0; bankNum < RPU_NUM_LAMP_BANKS; bankNum++) {
+    byte mask = frameMask ? frameMask[bankNum] : 0xFF;
+    LampStates[bankNum] = (LampStates[bankNum] | mask) & ~(lampsOn[bankNum] & mask);
+    LampDim1[bankNum] = (LampDim1[bankNum] & ~mask) | (lampsDim1 ? (lampsDim1[bankNum] & mask) : 0);
+    LampDim2[bankNum] = (LampDim2[bankNum] & ~mask) | (lampsDim2 ? (lampsDim2[bankNum] & mask) : 0);
+  }
+  SREG = oldSREG;
+}
+
+byte RPU_ReadLampBank(byte bankNum) {
+  if (bankNum >= RPU_NUM_LAMP_BANKS) return 0x00;
+  return ~LampStates[bankNum];
+}
+
+#ifdef RPU_OS_USE_LAMP_BRIGHTNESS
+void RPU_SetLampBrightness(byte lampNum, byte level) {
+  if (lampNum >= RPU_MAX_LAMPS) return;
+  if (level > RPU_LAMP_MAX_BRIGHTNESS) level = RPU_LAMP_MAX_BRIGHTNESS;
+  byte bankNum = lampNum / 8;
+  byte lampBit = BitShiftValues[lampNum % 8];
+
+  StopLampFades(bankNum, lampBit);
+  SetLampBankFlash(bankNum, lampBit, 0, 0);
+  SetLampBrightnessBits(lampNum, level);
+}
+
+byte RPU_ReadLampBrightness(byte lampNum) {
+  if (lampNum >= RPU_MAX_LAMPS) return 0;
+  byte bankNum = lampNum / 8;
+  byte lampBit = BitShiftValues[lampNum % 8];
+
+  if (LampStates[bankNum] & lampBit) return 0;
+
+  if ((LampBrightnessSet[bankNum] & lampBit) == 0) {
+    boolean dim1 = (LampDim1[bankNum] & lampBit) ? true : false;
+    boolean dim2 = (LampDim2[bankNum] & lampBit) ? true : false;
+    if (dim1 && dim2) return 1;
+    if (dim1) return 4;
+    if (dim2) return 2;
+    return RPU_LAMP_MAX_BRIGHTNESS;
+  }
+
+  byte level = 0;
+  for (byte plane = 0; plane < LAMP_BRIGHTNESS_PLANES; plane++) {
+    if (LampBrightnessPlanes[plane][bankNum] & lampBit) level |= BitShiftValues[plane];
+  }
+  return level;
+}
+
+boolean RPU_FadeLamp(byte lampNum, byte toLevel, unsigned short duration, unsigned long currentTime, boolean pulse) {
+  if (lampNum >= RPU_MAX_LAMPS) return false;
+  if (toLevel > RPU_LAMP_MAX_BRIGHTNESS) toLevel = RPU_LAMP_MAX_BRIGHTNESS;
+  if (duration == 0) {
+    RPU_SetLampBrightness(lampNum, toLevel);
+    return true;
+  }
+
+  byte fromLevel = RPU_ReadLampBrightness(lampNum);
+  byte bankNum = lampNum / 8;
+  byte lampBit = BitShiftValues[lampNum % 8];
+  StopLampFades(bankNum, lampBit);
+
+  for (byte fadeSlot = 0; fadeSlot < LAMP_FADE_SLOTS; fadeSlot++) {
+    LampFade *fade = &LampFades[fadeSlot];
+    if (fade->lampNum != LAMP_FADE_UNUSED) continue;
+    fade->lampNum = lampNum;
+    fade->fromLevel = fromLevel;
+    fade->toLevel = toLevel;
+    fade->pulse = pulse;
+    fade->startTime = currentTime;
+    fade->duration = duration;
+    LampFading[bankNum] |= lampBit;
+    SetLampBankFlash(bankNum, lampBit, 0, 0);
+    SetLampBrightnessBits(lampNum, fromLevel);
+    return true;
+  }
+
+  // No free fade slot - just jump to the new level
+  SetLampBrightnessBits(lampNum, toLevel);
+  return false;
+}
+
+void UpdateLampBrightness(unsigned long currentTime) {
+  for (byte fadeSlot = 0; fadeSlot < LAMP_FADE_SLOTS; fadeSlot++) {
+    LampFade *fade = &LampFades[fadeSlot];
+    byte lampNum = fade->lampNum;
+    if (lampNum == LAMP_FADE_UNUSED) continue;
+
+    unsigned long elapsed = currentTime - fade->startTime;
+    byte startLevel = fade->fromLevel;
+    byte endLevel = fade->toLevel;
+    if (fade->pulse) {
+      // Odd passes run back the other way
+      if ((elapsed / fade->duration) % 2) {
+        startLevel = fade->toLevel;
+        endLevel = fade->fromLevel;
+      }
+      elapsed = elapsed % fade->duration;
+    } else if (elapsed >= fade->duration) {
+      fade->lampNum = LAMP_FADE_UNUSED;
+      LampFading[lampNum / 8] &= ~BitShiftValues[lampNum % 8];
+      elapsed = fade->duration;
+    }
+
+    int levelChange = ((long)((int)endLevel - (int)startLevel) * (long)elapsed) / (long)fade->duration;
+    SetLampBrightnessBits(lampNum, (byte)((int)startLevel + levelChange));
+  }
+
+  for (byte bankNum = 0; bankNum < RPU_NUM_LAMP_BANKS; bankNum++) {
+    byte lampsLit = ~LampStates[bankNum];
+    byte lampsDim1 = LampDim1[bankNum];
+    byte lampsDim2 = LampDim2[bankNum];
+    byte lampsLeveled = LampBrightnessSet[bankNum];
+    // Undimmed lamps are on in every plane, dim 1 is
+    // plane 2 (level 4), dim 2 is plane 1 (level 2),
+    // and both is plane 0 (level 1)
+    byte lampsFull = ~(lampsDim1 | lampsDim2);
+    byte legacyPlanes[LAMP_BRIGHTNESS_PLANES];
+    legacyPlanes[0] = lampsFull | (lampsDim1 & lampsDim2);
+    legacyPlanes[1] = lampsFull | (lampsDim2 & ~lampsDim1);
+    legacyPlanes[2] = lampsFull | (lampsDim1 & ~lampsDim2);
+
+    for (byte plane = 0; plane < LAMP_BRIGHTNESS_PLANES; plane++) {
+      byte planeOn = (legacyPlanes[plane] & ~lampsLeveled) | (LampBrightnessPlanes[plane][bankNum] & lampsLeveled);
+      LampPlaneOutput[plane][bankNum] = ~(lampsLit & planeOn);
+    }
+  }
+}
+#endif
+
 byte RPU_ReadLampState(int lampNum) {
   if (lampNum >= RPU_MAX_LAMPS || lampNum < 0) return 0x00;
   byte lampStateByte = LampStates[lampNum / 8];
@@ -2078,6 +2568,10 @@ void RPU_ApplyFlashToLamps(unsigned long curTime) {
   int curLampNum = 0;
 
   for (curLampByte = 0; curLampByte < RPU_NUM_LAMP_BANKS; curLampByte++) {
+    if (LampFlashing[curLampByte] == 0) {
+      curLampNum += 8;
+      continue;
+    }
     curLampBit = 0x01;
     for (byte curBit = 0; curBit < 8; curBit++) {
       if ( LampFlashPeriod[curLampNum] != 0 ) {
@@ -2153,12 +2647,27 @@ void RPU_ClearVariables() {
     LampStates[lampBankCounter] = 0xFF;
     LampDim1[lampBankCounter] = 0x00;
     LampDim2[lampBankCounter] = 0x00;
+    LampFlashing[lampBankCounter] = 0x00;
   }
 
   for (int lampFlashCount = 0; lampFlashCount < RPU_MAX_LAMPS; lampFlashCount++) {
     LampFlashPeriod[lampFlashCount] = 0;
   }
 
+#ifdef RPU_OS_USE_LAMP_BRIGHTNESS
+  for (int lampBankCounter = 0; lampBankCounter < RPU_NUM_LAMP_BANKS; lampBankCounter++) {
+    for (byte plane = 0; plane < LAMP_BRIGHTNESS_PLANES; plane++) {
+      LampBrightnessPlanes[plane][lampBankCounter] = 0x00;
+      LampPlaneOutput[plane][lampBankCounter] = 0xFF;
+    }
+    LampBrightnessSet[lampBankCounter] = 0x00;
+    LampFading[lampBankCounter] = 0x00;
+  }
+  for (byte fadeSlot = 0; fadeSlot < LAMP_FADE_SLOTS; fadeSlot++) {
+    LampFades[fadeSlot].lampNum = LAMP_FADE_UNUSED;
+  }
+#endif
+
   // Reset all the switch values
   // (set them as closed so that if they're stuck they don't register as new events)
   byte switchCount;
@@ -2233,51 +2742,129 @@ void RPU_ClearVariables() {
  *    
 *******************************************************/
 
-#ifdef RPU_OS_USE_S_AND_T
-
-void RPU_PlaySoundSAndT(byte soundByte) {
+#if defined(RPU_OS_USE_S_AND_T) || defined(RPU_OS_USE_DASH50) || defined(RPU_OS_USE_DASH51)
 
-  byte oldSolenoidControlByte, soundLowerNibble, soundUpperNibble;
+void WriteSoundLatchNibble(byte nibble) {
+  SoundLatchNibble = nibble;
+  RPU_DataWrite(ADDRESS_U11_B, (CurrentSolenoidByte & 0xF0) | nibble);
+}
 
-  // mask further zero-crossing interrupts during this
-  noInterrupts();
+// Runs the next phase of the sound being latched and returns how
+// long (in microseconds) to hold it, or 0 once the latch is released
+unsigned short AdvanceSoundLatch() {
+  if (SoundLatchPhase == SOUND_LATCH_IDLE) {
+    // Put 1s on momentary solenoid lines
+    WriteSoundLatchNibble(0x0F);
+    // Put sound latch low
+    RPU_DataWrite(ADDRESS_U11_B_CONTROL, 0x34);
+    SoundLatchPhase = SOUND_LATCH_STROBE_LOW;
+    return SOUND_LATCH_STROBE_LOW_US;
+  }
 
-  // Get the current value of U11:PortB - current solenoids
-  oldSolenoidControlByte = RPU_DataRead(ADDRESS_U11_B);
-  soundLowerNibble = (oldSolenoidControlByte & 0xF0) | (soundByte & 0x0F);
-  soundUpperNibble = (oldSolenoidControlByte & 0xF0) | (soundByte / 16);
+  if (SoundLatchPhase == SOUND_LATCH_STROBE_LOW) {
+#if defined(RPU_OS_USE_DASH50) || defined(RPU_OS_USE_DASH51)
+    // This device has 32 possible sounds, but they're mapped to
+    // 0 - 15 and then 128 - 143 on the original card, with bits b4, b5, and b6 reserved
+    // for timing controls.
+    // For ease of use, I've mapped the sounds from 0-31
+    // so bit 4 goes out on Display Enable 7 (the display
+    // refresh carries that bit through with 6-digit displays)
+    byte displayByte = RPU_DataRead(ADDRESS_U11_A);
+    SoundLatchDisplayBit = displayByte & 0x02;
+    if (SoundLatchByte & 0x10) RPU_DataWrite(ADDRESS_U11_A, displayByte | 0x02);
+    else RPU_DataWrite(ADDRESS_U11_A, displayByte & 0xFD);
+#endif
+    // Put sound latch high and load the lower nibble
+    RPU_DataWrite(ADDRESS_U11_B_CONTROL, 0x3C);
+    WriteSoundLatchNibble(SoundLatchByte & 0x0F);
+    SoundLatchPhase = SOUND_LATCH_FIRST_NIBBLE;
+    return SOUND_LATCH_FIRST_NIBBLE_US;
+  }
 
-  // Put 1s on momentary solenoid lines
-  RPU_DataWrite(ADDRESS_U11_B, oldSolenoidControlByte | 0x0F);
+#ifdef RPU_OS_USE_S_AND_T
+  if (SoundLatchPhase == SOUND_LATCH_FIRST_NIBBLE) {
+    WriteSoundLatchNibble(SoundLatchByte / 16);
+    SoundLatchPhase = SOUND_LATCH_SECOND_NIBBLE;
+    return SOUND_LATCH_SECOND_NIBBLE_US;
+  }
+#else
+  // Give Display Enable 7 back
+  RPU_DataWrite(ADDRESS_U11_A, (RPU_DataRead(ADDRESS_U11_A) & 0xFD) | SoundLatchDisplayBit);
+#endif
 
-  // Put sound latch low
+  // Restore the solenoid byte (including anything the zero-crossing
+  // handler fired while we had the port) and drop the latch
+  SoundLatchPhase = SOUND_LATCH_IDLE;
+  RPU_DataWrite(ADDRESS_U11_B, CurrentSolenoidByte);
   RPU_DataWrite(ADDRESS_U11_B_CONTROL, 0x34);
+  return 0;
+}
 
-  // Let the strobe stay low for a moment
-  delayMicroseconds(32);
-
-  // Put sound latch high
-  RPU_DataWrite(ADDRESS_U11_B_CONTROL, 0x3C);
-
-  // put the new byte on U11:PortB (the lower nibble is currently loaded)
-  RPU_DataWrite(ADDRESS_U11_B, soundLowerNibble);
-
-  // wait 138 microseconds
-  delayMicroseconds(138);
+#ifdef SOUND_LATCH_USE_TIMER3
+// Called with interrupts off -- starts the next queued sound
+// if the latch is free and it will be done before the display
+// timer's next tick (otherwise the display ISR starts it)
+void StartNextSoundLatch() {
+  if (SoundLatchPhase != SOUND_LATCH_IDLE) return;
+  if (SoundLatchQueueFirst == SoundLatchQueueLast) return;
+  unsigned short displayCount = TCNT1;
+  if (displayCount >= OCR1A || (OCR1A - displayCount) < SOUND_LATCH_DISPLAY_MARGIN) return;
+
+  SoundLatchByte = SoundLatchQueue[SoundLatchQueueFirst];
+  SoundLatchQueueFirst = (SoundLatchQueueFirst + 1) % SOUND_LATCH_QUEUE_SIZE;
+  unsigned short holdTime = AdvanceSoundLatch();
+
+  // One-shot: CTC on OCR3A, 1/8 prescaler
+  TCCR3A = 0;
+  TCCR3B = 0;
+  TCNT3 = 0;
+  OCR3A = holdTime * SOUND_LATCH_COUNTS_PER_US;
+  TIFR3 = (1 << OCF3A);
+  TIMSK3 |= (1 << OCIE3A);
+  TCCR3B = (1 << WGM32) | (1 << CS31);
+}
 
-  // put the new byte on U11:PortB (the uppper nibble is currently loaded)
-  RPU_DataWrite(ADDRESS_U11_B, soundUpperNibble);
+ISR(TIMER3_COMPA_vect) {
+  unsigned short holdTime = AdvanceSoundLatch();
+  if (holdTime) {
+    OCR3A = holdTime * SOUND_LATCH_COUNTS_PER_US;
+    return;
+  }
+  TCCR3B = 0;
+  TIMSK3 &= ~(1 << OCIE3A);
+  StartNextSoundLatch();
+}
+#endif
 
-  // wait 76 microseconds
-  delayMicroseconds(145);
+void PushToSoundLatchQueue(byte soundByte) {
+  byte oldSREG = SREG;
+  cli();
+  byte nextLast = (SoundLatchQueueLast + 1) % SOUND_LATCH_QUEUE_SIZE;
+  // If the queue is full, the sound is dropped
+  if (nextLast != SoundLatchQueueFirst) {
+    SoundLatchQueue[SoundLatchQueueLast] = soundByte;
+    SoundLatchQueueLast = nextLast;
+  }
+#ifdef SOUND_LATCH_USE_TIMER3
+  StartNextSoundLatch();
+#else
+  // No spare timer -- strobe it now
+  while (SoundLatchQueueFirst != SoundLatchQueueLast) {
+    SoundLatchByte = SoundLatchQueue[SoundLatchQueueFirst];
+    SoundLatchQueueFirst = (SoundLatchQueueFirst + 1) % SOUND_LATCH_QUEUE_SIZE;
+    unsigned short holdTime;
+    while ((holdTime = AdvanceSoundLatch())) delayMicroseconds(holdTime);
+  }
+#endif
+  SREG = oldSREG;
+}
 
-  // Restore the original solenoid byte
-  RPU_DataWrite(ADDRESS_U11_B, oldSolenoidControlByte);
+#endif
 
-  // Put sound latch low
-  RPU_DataWrite(ADDRESS_U11_B_CONTROL, 0x34);
+#ifdef RPU_OS_USE_S_AND_T
 
-  interrupts();
+void RPU_PlaySoundSAndT(byte soundByte) {
+  PushToSoundLatchQueue(soundByte);
 }
 #endif
 
@@ -2323,56 +2910,7 @@ void RPU_PlaySB100Chime(byte soundByte) {
 
 #if defined(RPU_OS_USE_DASH50) || defined(RPU_OS_USE_DASH51)
 void RPU_PlaySoundDash51(byte soundByte) {
-
-  // This device has 32 possible sounds, but they're mapped to
-  // 0 - 15 and then 128 - 143 on the original card, with bits b4, b5, and b6 reserved
-  // for timing controls.
-  // For ease of use, I've mapped the sounds from 0-31
-
-  byte oldSolenoidControlByte, soundLowerNibble, displayWithSoundBit4, oldDisplayByte;
-
-  // mask further zero-crossing interrupts during this
-  noInterrupts();
-
-  // Get the current value of U11:PortB - current solenoids
-  oldSolenoidControlByte = RPU_DataRead(ADDRESS_U11_B);
-  oldDisplayByte = RPU_DataRead(ADDRESS_U11_A);
-  soundLowerNibble = (oldSolenoidControlByte & 0xF0) | (soundByte & 0x0F);
-  displayWithSoundBit4 = oldDisplayByte;
-  if (soundByte & 0x10) displayWithSoundBit4 |= 0x02;
-  else displayWithSoundBit4 &= 0xFD;
-
-  // Put 1s on momentary solenoid lines
-  RPU_DataWrite(ADDRESS_U11_B, oldSolenoidControlByte | 0x0F);
-
-  // Put sound latch low
-  RPU_DataWrite(ADDRESS_U11_B_CONTROL, 0x34);
-
-  // Let the strobe stay low for a moment
-  delayMicroseconds(68);
-
-  // put bit 4 on Display Enable 7
-  RPU_DataWrite(ADDRESS_U11_A, displayWithSoundBit4);
-
-  // Put sound latch high
-  RPU_DataWrite(ADDRESS_U11_B_CONTROL, 0x3C);
-
-  // put the new byte on U11:PortB (the lower nibble is currently loaded)
-  RPU_DataWrite(ADDRESS_U11_B, soundLowerNibble);
-
-  // wait 180 microseconds
-  delayMicroseconds(180);
-
-  // Restore the original solenoid byte
-  RPU_DataWrite(ADDRESS_U11_B, oldSolenoidControlByte);
-
-  // Restore the original display byte
-  RPU_DataWrite(ADDRESS_U11_A, oldDisplayByte);
-
-  // Put sound latch low
-  RPU_DataWrite(ADDRESS_U11_B_CONTROL, 0x34);
-
-  interrupts();
+  PushToSoundLatchQueue(soundByte);
 }
 
 #endif
@@ -2631,6 +3169,18 @@ ISR(TIMER1_COMPA_vect) {    //This is the interrupt request
   for (int displayCount = 0; displayCount < 5; displayCount++) {
 
     // The BCD for this digit is in b4-b7, and the display latch strobes are in b0-b3 (and U11A:b0)
+    // A display with no digits enabled keeps whatever was
+    // last latched, so once that was a blank it can be skipped
+    if (DisplayDigitEnable[displayCount]==0) {
+      if (DisplaysLatchedBlank & displayStrobeMask) {
+        displayStrobeMask *= 2;
+        continue;
+      }
+      DisplaysLatchedBlank |= displayStrobeMask;
+    } else {
+      DisplaysLatchedBlank &= ~displayStrobeMask;
+    }
+
     byte displayDataByte = ((DisplayDigits[displayCount][CurrentDisplayDigit]) << 4) | 0x0F;
     byte displayEnable = ((DisplayDigitEnable[displayCount]) >> CurrentDisplayDigit) & 0x01;
 
@@ -2684,6 +3234,10 @@ ISR(TIMER1_COMPA_vect) {    //This is the interrupt request
   // Restore 10A from backup
   RPU_DataWrite(ADDRESS_U10_A, backupU10A);
 
+#ifdef SOUND_LATCH_USE_TIMER3
+  // Anything that was waiting for the refresh can go now
+  StartNextSoundLatch();
+#endif
 }
 
 // RPU_MPU_ARCHITECTURE < 10
@@ -2912,12 +3466,15 @@ void InterruptService3() {
     byte momentarySolenoidAtStart = PullFirstFromSolenoidStack();
     if (momentarySolenoidAtStart != SOLENOID_STACK_EMPTY) {
       CurrentSolenoidByte = (CurrentSolenoidByte & 0xF0) | momentarySolenoidAtStart;
-      RPU_DataWrite(ADDRESS_U11_B, CurrentSolenoidByte);
+      WriteCurrentSolenoidByte();
     } else {
       CurrentSolenoidByte = (CurrentSolenoidByte & 0xF0) | SOL_NONE;
-      RPU_DataWrite(ADDRESS_U11_B, CurrentSolenoidByte);
+      WriteCurrentSolenoidByte();
     }
 
+#ifdef RPU_OS_USE_LAMP_BRIGHTNESS
+    byte lampPlane = LampBrightnessSlotPlane[LampBrightnessSlot];
+#endif
     for (int lampByteCount = 0; lampByteCount < 8; lampByteCount++) {
       for (byte nibbleCount = 0; nibbleCount < 2; nibbleCount++) {
 
@@ -2949,11 +3506,16 @@ void InterruptService3() {
         // Use the inhibit lines to set the actual data to the lamp SCRs
         // (here, we don't care about the lower nibble because the address was already latched)
         byte nibbleOffset = (nibbleCount) ? 1 : 16;
+#ifdef RPU_OS_USE_LAMP_BRIGHTNESS
+        // The planes already have the dim lamps taken out
+        byte lampOutput = (LampPlaneOutput[lampPlane][lampByteCount] * nibbleOffset);
+#else
         byte lampOutput = (LampStates[lampByteCount] * nibbleOffset);
         // Every other time through the cycle, we OR in the dim variable
         // in order to dim those lights
         if (numberOfU10Interrupts % DimDivisor1) lampOutput |= (LampDim1[lampByteCount] * nibbleOffset);
         if (numberOfU10Interrupts % DimDivisor2) lampOutput |= (LampDim2[lampByteCount] * nibbleOffset);
+#endif
 
         RPU_DataWrite(ADDRESS_U10_A, lampOutput | 0x0F);
 #ifdef RPU_SLOW_DOWN_LAMP_STROBE
@@ -2978,11 +3540,16 @@ void InterruptService3() {
       for (byte nibbleCount = 0; nibbleCount < 2; nibbleCount++) {
         if (lampByteCount == 7) nibbleCount = 1; // skip the first nibble of byte 7 because it belongs to primary lamps
         byte nibbleOffset = (nibbleCount) ? 1 : 16;
+#ifdef RPU_OS_USE_LAMP_BRIGHTNESS
+        // The planes already have the dim lamps taken out
+        byte lampOutput = (LampPlaneOutput[lampPlane][lampByteCount] * nibbleOffset);
+#else
         byte lampOutput = (LampStates[lampByteCount] * nibbleOffset);
         // Every other time through the cycle, we OR in the dim variable
         // in order to dim those lights
         if (numberOfU10Interrupts % DimDivisor1) lampOutput |= (LampDim1[lampByteCount] * nibbleOffset);
         if (numberOfU10Interrupts % DimDivisor2) lampOutput |= (LampDim2[lampByteCount] * nibbleOffset);
+#endif
 
         // The data will be in the upper nibble, but we need the bank count in the lower
         lampOutput &= 0xF0;
@@ -3017,6 +3584,10 @@ void InterruptService3() {
     // Read U10B to clear interrupt
     RPU_DataRead(ADDRESS_U10_B);
     numberOfU10Interrupts += 1;
+#ifdef RPU_OS_USE_LAMP_BRIGHTNESS
+    LampBrightnessSlot += 1;
+    if (LampBrightnessSlot >= LAMP_BRIGHTNESS_SLOTS) LampBrightnessSlot = 0;
+#endif
   }
 }
 
@@ -3038,7 +3609,7 @@ void RPU_HookInterrupts() {
   TCCR1B = 0;// same for TCCR1B
   TCNT1  = 0;//initialize counter value to 0
   // set compare match register for selected increment
-  OCR1A = RPU_OS_SOFTWARE_DISPLAY_INTERRUPT_INTERVAL;
+  OCR1A = DisplayRefreshConstant;
   // turn on CTC mode
   TCCR1B |= (1 << WGM12);
   // Set CS10 and CS12 bits for 1024 prescaler
@@ -3881,6 +4452,9 @@ void RPU_Update(unsigned long currentTime) {
   }
 
   RPU_ApplyFlashToLamps(currentTime);
+#ifdef RPU_OS_USE_LAMP_BRIGHTNESS
+  UpdateLampBrightness(currentTime);
+#endif
   RPU_UpdateTimedSolenoidStack(currentTime);
 #if (RPU_MPU_ARCHITECTURE>=10) && (defined(RPU_OS_USE_WTYPE_1_SOUND) || defined(RPU_OS_USE_WTYPE_2_SOUND))
   RPU_UpdateTimedSoundStack(currentTime);
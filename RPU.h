@@ -81,6 +81,8 @@ byte RPU_GetDipSwitches(byte index);
 byte RPU_PullFirstFromSwitchStack();
 boolean RPU_SetSwitchInversion(byte switchNum);
 boolean RPU_ReadSingleSwitchState(byte switchNum);
+// Switches switchByte*8 through switchByte*8+7, closed = 1
+byte RPU_ReadSwitchByte(byte switchByte);
 void RPU_PushToSwitchStack(byte switchNumber);
 boolean RPU_GetUpDownSwitchState(); // This always returns true for RPU_MPU_ARCHITECTURE==1 (no up/down switch)
 void RPU_ClearUpDownSwitchState();
@@ -99,11 +101,20 @@ byte RPU_ReadContinuousSolenoids();
 void RPU_DisableSolenoidStack();
 void RPU_EnableSolenoidStack();
 boolean RPU_IsSolenoidStackEnabled();
+#if (RPU_MPU_ARCHITECTURE<10)
+byte RPU_GetSolenoidStackDepth();
+#endif
 boolean RPU_PushToTimedSolenoidStack(byte solenoidNumber, byte numPushes, unsigned long whenToFire, boolean disableOverride = false);
 void RPU_UpdateTimedSolenoidStack(unsigned long curTime);
 
 //   Displays
 byte RPU_SetDisplay(int displayNumber, unsigned long value, boolean blankByMagnitude=false, byte minDigits=2, boolean showCommasByMagnitude=false);
+byte RPU_SetDisplayBCD(int displayNumber, unsigned long bcdValue, boolean blankByMagnitude=false, byte minDigits=2, boolean showCommasByMagnitude=false);
+unsigned long RPU_ConvertToBCD(unsigned long value);
+unsigned long RPU_ConvertFromBCD(unsigned long bcdValue);
+unsigned long RPU_AddBCD(unsigned long bcdValue1, unsigned long bcdValue2);
+unsigned long RPU_MultiplyBCD(unsigned long bcdValue, byte multiplier);
+byte RPU_MagnitudeOfBCD(unsigned long bcdValue);
 void RPU_SetDisplayBlank(int displayNumber, byte bitMask);
 void RPU_SetDisplayCredits(int value, boolean displayOn = true, boolean showBothDigits=true);
 void RPU_SetDisplayMatch(int value, boolean displayOn = true, boolean showBothDigits=true);
@@ -112,15 +123,39 @@ void RPU_SetDisplayFlash(int displayNumber, unsigned long value, unsigned long c
 void RPU_SetDisplayFlashCredits(unsigned long curTime, int period=100);
 void RPU_CycleAllDisplays(unsigned long curTime, byte digitNum=0, byte digitValue=0xFF); // Self-test function
 byte RPU_GetDisplayBlank(int displayNumber);
+byte RPU_GetDisplaysWritten();  // displays written (bitmask) since the last call
 #if (RPU_MPU_ARCHITECTURE==15)
 byte RPU_SetDisplayText(int displayNumber, char *text, boolean blankByLength=true);
 #endif
-#if defined(RPU_OS_ADJUSTABLE_DISPLAY_INTERRUPT)
+#if (RPU_MPU_ARCHITECTURE<10)
+void RPU_SetDisplayRefreshConstant(int intervalConstant);
+int RPU_GetDisplayRefreshConstant();
+#elif defined(RPU_OS_ADJUSTABLE_DISPLAY_INTERRUPT)
 void RPU_SetDisplayRefreshConstant(int intervalConstant);
 #endif
 
 //   Lamps
 void RPU_SetLampState(int lampNum, byte s_lampState, byte s_lampDim=0, int s_lampFlashPeriod=0);
+// Bank functions work on 8 lamps at a time (lamps bankNum*8 to bankNum*8+7).
+// Only lamps in mask are changed; bits in lampsOn are 1 for lit lamps.
+void RPU_SetLampBank(byte bankNum, byte mask, byte lampsOn, byte dimLevel=0, int flashPeriod=0);
+// Frames are RPU_NUM_LAMP_BANKS bytes, one bit per lamp. All banks are
+// written with interrupts off so the lamp ISR never sees half a frame.
+void RPU_SetLampFrame(const byte *lampsOn, const byte *frameMask=NULL, const byte *lampsDim1=NULL, const byte *lampsDim2=NULL);
+byte RPU_ReadLampBank(byte bankNum);
+#ifdef RPU_OS_USE_LAMP_BRIGHTNESS
+// Brightness runs from 0 (off) to RPU_LAMP_MAX_BRIGHTNESS (full).
+// RPU_SetLampState() and the bank functions still work - they
+// drop any level (or fade) that was set on the lamps they touch,
+// and their dim settings map to levels 4 (dim 1), 2 (dim 2),
+// and 1 (both).
+#define RPU_LAMP_MAX_BRIGHTNESS   7
+void RPU_SetLampBrightness(byte lampNum, byte level);
+byte RPU_ReadLampBrightness(byte lampNum);
+// Fades run from the lamp's current level to toLevel over duration ms.
+// A pulse fades back and forth until the lamp is set again.
+boolean RPU_FadeLamp(byte lampNum, byte toLevel, unsigned short duration, unsigned long currentTime, boolean pulse=false);
+#endif
 void RPU_ApplyFlashToLamps(unsigned long curTime);
 void RPU_FlashAllLamps(unsigned long curTime); // Self-test function
 void RPU_TurnOffAllLamps();
@@ -59,8 +59,20 @@
 //#define RPU_OS_USE_SB300
 //#define RPU_OS_USE_WAV_TRIGGER
 #define RPU_OS_USE_WAV_TRIGGER_1p3
+// Debug & telemetry frames go to this port if it's defined,
+// otherwise they go to Serial. Rev 3 uses pins 14-30 for the
+// bus, so there's no spare UART and the frames share Serial
+// with the WAV Trigger. Rev 4 moves the WAV Trigger to Serial1.
+//#define RPU_OS_DEBUG_SERIAL Serial
+// Buffer game events (switches, scores, drains, coins)
+// and send them on the telemetry channel
+//#define RPU_OS_USE_TELEMETRY
 //#define RPU_OS_DISABLE_CPC_FOR_SPACE
 //#define RPU_OS_USE_AUX_LAMPS
+// 8-level lamp brightness and fades (-17/-35/100/200 only).
+// The levels are spread over 7 zero crossings, so the
+// dimmest ones can flicker on fast bulbs and LEDs
+//#define RPU_OS_USE_LAMP_BRIGHTNESS
 //#define RPU_OS_USE_7_DIGIT_DISPLAYS
 //#define RPU_USE_EXTENDED_SWITCHES_ON_PB4
 //#define RPU_USE_EXTENDED_SWITCHES_ON_PB7
@@ -72,6 +84,9 @@
 #define RPU_NUMBER_OF_PLAYER_DISPLAYS       4
 //#define RPU_BALLY_SIXTH_DISPLAY
 #define RPU_SIMPLIFY_DISPLAY_FOR_7VOLUTION
+// For i2c (DMD) displays whose firmware accepts the
+// partial text write (0x09) - only changed characters are sent
+//#define RPU_DMD_PARTIAL_TEXT_WRITES
 #define RPU_NATIVE_7VOLUTION_SUPPORT
 
 
@@ -90,6 +105,7 @@
 //          (must be <65536)
 // Choose one of these values (or do whatever)
 //  Value         Frequency 
+//  56            274 Hz     (slowest allowed at runtime)
 //  48            318.8 Hz
 //  47            325.5 Hz
 //  46            332.4 Hz increments   (I use this for 6-digits displays)
@@ -98,7 +114,10 @@
 //  35            434 Hz     (This would probably be good for 7-digit displays)
 //  34            446.4 Hz      
 #define RPU_OS_SOFTWARE_DISPLAY_INTERRUPT_INTERVAL  48  
-//#define RPU_OS_ADJUSTABLE_DISPLAY_INTERRUPT
+// RPU_SetDisplayRefreshConstant() can change the interval while
+// the game is running - values are held to this range
+#define RPU_OS_MIN_DISPLAY_INTERRUPT_INTERVAL       34
+#define RPU_OS_MAX_DISPLAY_INTERRUPT_INTERVAL       56
 
 #ifdef RPU_OS_USE_6_DIGIT_CREDIT_DISPLAY_WITH_7_DIGIT_DISPLAYS
 #define RPU_OS_MASK_SHIFT_1            0x60
@@ -144,6 +163,9 @@
 #define RPU_NUM_LAMP_BANKS             8
 #define RPU_MAX_LAMPS                  64
 
+// Brightness levels need the zero-crossing lamp interrupt
+#undef RPU_OS_USE_LAMP_BRIGHTNESS
+
 #define NUM_SWITCH_BYTES                8
 #define MAX_NUM_SWITCHES                64
  
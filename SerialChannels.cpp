@@ -0,0 +1,202 @@
+////////////////////////////////////////////////////////////////////////////
+//
+//  Serial Channel functions
+//
+////////////////////////////////////////////////////////////////////////////
+#include <Arduino.h>
+#include <HardwareSerial.h>
+#include "RPU_Config.h"
+#include "SerialChannels.h"
+
+#ifdef RPU_OS_DEBUG_SERIAL
+#define ChannelSerial RPU_OS_DEBUG_SERIAL
+#else
+#define ChannelSerial Serial
+#endif
+
+unsigned long ChannelDroppedFrames = 0;
+
+#ifdef RPU_OS_USE_TELEMETRY
+TelemetryRecord TelemetryRing[TELEMETRY_RING_SIZE];
+byte TelemetryRingFirst = 0;
+byte TelemetryRingLast = 0;
+unsigned short TelemetryNextSequence = 0;
+unsigned long TelemetryDropped = 0;
+unsigned long TelemetryDroppedUnreported = 0;
+#endif
+
+
+void Channel_Begin(unsigned long baudRate) {
+#if defined(RPU_OS_DEBUG_SERIAL)
+  ChannelSerial.begin(baudRate);
+#elif (defined(RPU_OS_USE_WAV_TRIGGER) || defined(RPU_OS_USE_WAV_TRIGGER_1p3)) && (RPU_OS_HARDWARE_REV<=3)
+  // Serial belongs to the WAV Trigger on these boards, so it runs
+  // at the WAV Trigger's 57600 (wavTrigger::start() sets the same
+  // rate again). It still has to be started here so frames written
+  // before the AudioHandler is set up aren't lost.
+  (void)baudRate;
+  Serial.begin(57600);
+#else
+  Serial.begin(baudRate);
+#endif
+}
+
+
+boolean ChannelByteNeedsEscape(byte value) {
+  return (value==SERIAL_CHANNEL_FRAME_START || value==SERIAL_CHANNEL_ESCAPE || value==0xF0);
+}
+
+
+byte ChannelEncodeByte(byte *buf, byte pos, byte value) {
+  if (ChannelByteNeedsEscape(value)) {
+    buf[pos++] = SERIAL_CHANNEL_ESCAPE;
+    buf[pos++] = value ^ SERIAL_CHANNEL_ESCAPE_XOR;
+  } else {
+    buf[pos++] = value;
+  }
+  return pos;
+}
+
+
+boolean Channel_WriteFrame(byte channel, const byte *payload, byte length) {
+  if (channel==SERIAL_CHANNEL_AUDIO || length>SERIAL_CHANNEL_MAX_PAYLOAD) return false;
+
+  byte frame[4 + 2*(SERIAL_CHANNEL_MAX_PAYLOAD+2)];
+  byte pos = 0;
+  byte checksum = channel + length;
+
+  frame[pos++] = SERIAL_CHANNEL_FRAME_START;
+  pos = ChannelEncodeByte(frame, pos, channel);
+  pos = ChannelEncodeByte(frame, pos, length);
+  for (byte count=0; count<length; count++) {
+    checksum += payload[count];
+    pos = ChannelEncodeByte(frame, pos, payload[count]);
+  }
+  pos = ChannelEncodeByte(frame, pos, (byte)(0x100 - checksum));
+
+  // Never wait on the port - if there's no room
+  // in the transmit buffer, the frame is lost
+  if (ChannelSerial.availableForWrite()<(int)pos) {
+    ChannelDroppedFrames += 1;
+    return false;
+  }
+  ChannelSerial.write(frame, pos);
+  return true;
+}
+
+
+boolean Channel_DebugEvent(byte eventID, unsigned long currentTime, long value) {
+  byte record[SERIAL_CHANNEL_DEBUG_EVENT_LENGTH];
+  record[0] = eventID;
+  for (byte count=0; count<4; count++) {
+    record[1+count] = (byte)(currentTime >> (8*count));
+    record[5+count] = (byte)(((unsigned long)value) >> (8*count));
+  }
+  return Channel_WriteFrame(SERIAL_CHANNEL_DEBUG_EVENT, record, SERIAL_CHANNEL_DEBUG_EVENT_LENGTH);
+}
+
+
+void Channel_DebugText(const char *text) {
+  // Longer strings are split across frames
+  // and reassembled by the host
+  unsigned int length = strlen(text);
+  while (length) {
+    byte chunk = (length>SERIAL_CHANNEL_MAX_PAYLOAD) ? SERIAL_CHANNEL_MAX_PAYLOAD : length;
+    Channel_WriteFrame(SERIAL_CHANNEL_DEBUG_TEXT, (const byte *)text, chunk);
+    text += chunk;
+    length -= chunk;
+  }
+}
+
+
+unsigned long Channel_GetDroppedFrames() {
+  return ChannelDroppedFrames;
+}
+
+
+void Channel_ResetDroppedFrames() {
+  ChannelDroppedFrames = 0;
+}
+
+
+#ifdef RPU_OS_USE_TELEMETRY
+boolean PushToTelemetryRing(byte eventType, byte detail, unsigned long currentTime, unsigned long value) {
+  byte nextLast = TelemetryRingLast + 1;
+  if (nextLast >= TELEMETRY_RING_SIZE) nextLast = 0;
+  if (nextLast == TelemetryRingFirst) return false;
+
+  TelemetryRing[TelemetryRingLast].eventType = eventType;
+  TelemetryRing[TelemetryRingLast].detail = detail;
+  TelemetryRing[TelemetryRingLast].sequence = TelemetryNextSequence;
+  TelemetryRing[TelemetryRingLast].timestamp = currentTime;
+  TelemetryRing[TelemetryRingLast].value = value;
+  TelemetryRingLast = nextLast;
+  return true;
+}
+
+byte EncodeTelemetryRecord(byte *buf, TelemetryRecord *record) {
+  buf[0] = record->eventType;
+  buf[1] = record->detail;
+  buf[2] = (byte)(record->sequence);
+  buf[3] = (byte)(record->sequence >> 8);
+  for (byte count=0; count<4; count++) {
+    buf[4+count] = (byte)(record->timestamp >> (8*count));
+    buf[8+count] = (byte)(record->value >> (8*count));
+  }
+  return TELEMETRY_RECORD_LENGTH;
+}
+#endif
+
+
+void Channel_LogTelemetry(byte eventType, byte detail, unsigned long currentTime, unsigned long value) {
+#ifdef RPU_OS_USE_TELEMETRY
+  if (!PushToTelemetryRing(eventType, detail, currentTime, value)) {
+    TelemetryDropped += 1;
+    TelemetryDroppedUnreported += 1;
+  }
+  TelemetryNextSequence += 1;
+#else
+  (void)eventType;
+  (void)detail;
+  (void)currentTime;
+  (void)value;
+#endif
+}
+
+
+void Channel_ServiceTelemetry(unsigned long currentTime) {
+#ifdef RPU_OS_USE_TELEMETRY
+  // Once there's room again, tell the host
+  // how many records were lost
+  if (TelemetryDroppedUnreported && PushToTelemetryRing(TELEMETRY_EVENT_DROPPED, 0, currentTime, TelemetryDroppedUnreported)) {
+    TelemetryDroppedUnreported = 0;
+    TelemetryNextSequence += 1;
+  }
+
+  // Send one frame per call; records only leave
+  // the ring once the frame has been queued
+  if (TelemetryRingFirst == TelemetryRingLast) return;
+
+  byte payload[TELEMETRY_RECORDS_PER_FRAME*TELEMETRY_RECORD_LENGTH];
+  byte length = 0;
+  byte ringPos = TelemetryRingFirst;
+  for (byte count=0; count<TELEMETRY_RECORDS_PER_FRAME && ringPos!=TelemetryRingLast; count++) {
+    length += EncodeTelemetryRecord(payload + length, &TelemetryRing[ringPos]);
+    ringPos += 1;
+    if (ringPos >= TELEMETRY_RING_SIZE) ringPos = 0;
+  }
+
+  if (Channel_WriteFrame(SERIAL_CHANNEL_TELEMETRY, payload, length)) TelemetryRingFirst = ringPos;
+#else
+  (void)currentTime;
+#endif
+}
+
+
+unsigned long Channel_GetDroppedTelemetry() {
+#ifdef RPU_OS_USE_TELEMETRY
+  return TelemetryDropped;
+#else
+  return 0;
+#endif
+}
@@ -0,0 +1,85 @@
+// Serial Channel Functions
+//
+// Debug and telemetry output are wrapped in small frames so they
+// can share a UART with the WAV Trigger (Rev 3 and earlier put
+// both on Serial) without the WAV Trigger ever seeing one of its
+// start-of-message bytes in the debug traffic. If
+// RPU_OS_DEBUG_SERIAL names a free hardware UART, the frames go
+// there instead and the audio port is left alone.
+//
+// Frame:  SERIAL_CHANNEL_FRAME_START, channel, length, payload[length], checksum
+// Any 0x7E, 0x7D, or 0xF0 after the start byte is sent as
+// 0x7D followed by the byte XOR 0x20. The checksum is the
+// two's complement of the sum of channel, length, and payload.
+
+#ifndef SERIAL_CHANNELS_H
+
+#define SERIAL_CHANNEL_FRAME_START      0x7E
+#define SERIAL_CHANNEL_ESCAPE           0x7D
+#define SERIAL_CHANNEL_ESCAPE_XOR       0x20
+
+// The audio channel is never framed - WAV Trigger
+// commands are written raw by the AudioHandler
+#define SERIAL_CHANNEL_AUDIO            0
+#define SERIAL_CHANNEL_TELEMETRY        1
+#define SERIAL_CHANNEL_DEBUG_EVENT      2
+#define SERIAL_CHANNEL_DEBUG_TEXT       3
+
+// Worst case (everything escaped) has to fit in the 64-byte
+// HardwareSerial transmit buffer so a frame can be queued
+// without blocking
+#define SERIAL_CHANNEL_MAX_PAYLOAD      28
+
+// Debug event records are 9 bytes:
+//  [0] event id
+//  [1-4] timestamp (ms, little-endian)
+//  [5-8] value (little-endian)
+#define SERIAL_CHANNEL_DEBUG_EVENT_LENGTH   9
+
+// Telemetry records (RPU_OS_USE_TELEMETRY) are 12 bytes:
+//  [0] event type
+//  [1] detail (switch, player, chute, or mode)
+//  [2-3] sequence number (little-endian)
+//  [4-7] timestamp (ms, little-endian)
+//  [8-11] value (little-endian)
+// Records wait in a RAM ring until Channel_ServiceTelemetry()
+// can send them. If the ring is full the new record is dropped,
+// but its sequence number is still used up so the host can see
+// the gap.
+#ifndef TELEMETRY_RING_SIZE
+#define TELEMETRY_RING_SIZE             16
+#endif
+#define TELEMETRY_RECORD_LENGTH         12
+#define TELEMETRY_RECORDS_PER_FRAME     (SERIAL_CHANNEL_MAX_PAYLOAD/TELEMETRY_RECORD_LENGTH)
+
+#define TELEMETRY_EVENT_SWITCH          1
+#define TELEMETRY_EVENT_SCORE           2
+#define TELEMETRY_EVENT_GAME_MODE       3
+#define TELEMETRY_EVENT_BALL_DRAIN      4
+#define TELEMETRY_EVENT_BALL_SAVE       5
+#define TELEMETRY_EVENT_COIN            6
+#define TELEMETRY_EVENT_CREDIT          7
+#define TELEMETRY_EVENT_TILT_WARNING    8
+#define TELEMETRY_EVENT_DROPPED         0xFF
+
+struct TelemetryRecord {
+  byte eventType;
+  byte detail;
+  unsigned short sequence;
+  unsigned long timestamp;
+  unsigned long value;
+};
+
+void Channel_Begin(unsigned long baudRate);
+boolean Channel_WriteFrame(byte channel, const byte *payload, byte length);
+boolean Channel_DebugEvent(byte eventID, unsigned long currentTime, long value = 0);
+void Channel_DebugText(const char *text);
+unsigned long Channel_GetDroppedFrames();
+void Channel_ResetDroppedFrames();
+
+void Channel_LogTelemetry(byte eventType, byte detail, unsigned long currentTime, unsigned long value = 0);
+void Channel_ServiceTelemetry(unsigned long currentTime);
+unsigned long Channel_GetDroppedTelemetry();
+
+#define SERIAL_CHANNELS_H
+#endif
@@ -0,0 +1,253 @@
+#!/usr/bin/env python3
+#
+# Accessory Lamp Board stand-in
+#
+# Decodes ALB frames the way the accessory board would and keeps a
+# model of what the board is showing, so the protocol can be checked
+# without the board. Input is one I2C transmission per line as hex
+# bytes (an export from a logic analyzer, or a dump of what
+# AccessoryLampBoard handed to Wire):
+#
+#   F0 BB 06 01 79 55
+#   F0 BB 0B 07 03 02 04 05 06 21 55
+#
+#   python3 tools/alb_standin.py capture.txt
+#   python3 tools/alb_standin.py < capture.txt
+#
+# Each command is printed with the board state after it. Commands
+# that don't change anything are flagged as redundant, since the
+# batcher in AccessoryLampBoard should never send them. The exit code
+# is 1 if any frame was malformed.
+
+import argparse
+import re
+import sys
+
+HEADER_BYTE_1 = 0xF0
+HEADER_BYTE_2 = 0xBB
+END_OF_MESSAGE = 0x55
+FRAME_OVERHEAD = 5
+MAX_FRAME_LENGTH = 32
+
+COMMAND_GET_ACCESSORY_ID = 0
+COMMAND_ENABLE_LAMPS = 1
+COMMAND_DISABLE_LAMPS = 2
+COMMAND_PLAY_ANIMATION = 3
+COMMAND_LOOP_ANIMATION = 4
+COMMAND_STOP_ANIMATION = 5
+COMMAND_STOP_ALL_ANIMATIONS = 6
+COMMAND_BATCH = 7
+COMMAND_SET_LAMP_BITMAP = 8
+COMMAND_SYNC_CLOCK = 9
+COMMAND_START_ANIMATION_AT = 10
+START_ANIMATION_LOOP = 0x01
+COMMAND_ALL_LAMPS_OFF = 99
+
+COMMAND_NAMES = {
+    COMMAND_GET_ACCESSORY_ID: "GetAccessoryID",
+    COMMAND_ENABLE_LAMPS: "EnableLamps",
+    COMMAND_DISABLE_LAMPS: "DisableLamps",
+    COMMAND_PLAY_ANIMATION: "PlayAnimation",
+    COMMAND_LOOP_ANIMATION: "LoopAnimation",
+    COMMAND_STOP_ANIMATION: "StopAnimation",
+    COMMAND_STOP_ALL_ANIMATIONS: "StopAllAnimations",
+    COMMAND_SET_LAMP_BITMAP: "SetLampBitmap",
+    COMMAND_SYNC_CLOCK: "SyncClock",
+    COMMAND_START_ANIMATION_AT: "StartAnimationAt",
+    COMMAND_ALL_LAMPS_OFF: "AllLampsOff",
+}
+
+
+class FrameError(Exception):
+    pass
+
+
+def crc8(data):
+    # Same CRC-8 as ALBUpdateCRC() (polynomial 0x07, starting from 0)
+    crc = 0
+    for b in data:
+        crc ^= b
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x07) & 0xFF if crc & 0x80 else (crc << 1) & 0xFF
+    return crc
+
+
+def command_length(data, offset):
+    # Same rules as ALBCommandLength()
+    command = data[offset]
+    if command in (COMMAND_PLAY_ANIMATION, COMMAND_LOOP_ANIMATION, COMMAND_STOP_ANIMATION):
+        return 2
+    if command == COMMAND_SET_LAMP_BITMAP:
+        if offset + 1 >= len(data):
+            raise FrameError("lamp bitmap command is cut off")
+        return 2 + data[offset + 1]
+    if command == COMMAND_SYNC_CLOCK:
+        return 7
+    if command == COMMAND_START_ANIMATION_AT:
+        return 5
+    return 1
+
+
+class Board:
+    def __init__(self):
+        self.lamps_enabled = None
+        self.bitmap = None
+        self.looping = set()
+        self.playing = set()
+        # Until a StopAllAnimations, the sender can't know
+        # what was already running on the board
+        self.animations_known = False
+        self.shared_time = None
+        self.frame_duration = None
+        self.scheduled = {}
+
+    def apply(self, command, args):
+        before = self.snapshot()
+        if command == COMMAND_ENABLE_LAMPS:
+            self.lamps_enabled = True
+        elif command == COMMAND_DISABLE_LAMPS:
+            self.lamps_enabled = False
+        elif command == COMMAND_PLAY_ANIMATION:
+            # One-shots end on their own, so playing one
+            # twice is never treated as redundant
+            self.playing.add(args[0])
+            return True
+        elif command == COMMAND_LOOP_ANIMATION:
+            self.looping.add(args[0])
+        elif command == COMMAND_STOP_ANIMATION:
+            self.looping.discard(args[0])
+            self.scheduled.pop(args[0], None)
+            if args[0] in self.playing or not self.animations_known:
+                self.playing.discard(args[0])
+                return True
+        elif command == COMMAND_STOP_ALL_ANIMATIONS:
+            stopped_something = bool(self.playing) or not self.animations_known
+            self.playing = set()
+            self.looping = set()
+            self.scheduled = {}
+            self.animations_known = True
+            if stopped_something:
+                return True
+        elif command == COMMAND_SYNC_CLOCK:
+            # Syncs are resent on purpose to correct drift
+            self.shared_time = args[0] | (args[1] << 8) | (args[2] << 16) | (args[3] << 24)
+            self.frame_duration = args[4] | (args[5] << 8)
+            return True
+        elif command == COMMAND_START_ANIMATION_AT:
+            if self.shared_time is None:
+                raise FrameError("animation scheduled before the clock was synced")
+            start_frame = args[2] | (args[3] << 8)
+            self.scheduled[args[0]] = start_frame
+            if args[1] & START_ANIMATION_LOOP:
+                self.looping.add(args[0])
+            else:
+                self.playing.add(args[0])
+                return True
+        elif command == COMMAND_SET_LAMP_BITMAP:
+            self.bitmap = list(args[1:])
+        elif command == COMMAND_ALL_LAMPS_OFF:
+            self.bitmap = [0] * (len(self.bitmap) if self.bitmap else 8)
+        elif command == COMMAND_GET_ACCESSORY_ID:
+            return True
+        else:
+            raise FrameError("unknown command %d" % command)
+        return self.snapshot() != before
+
+    def snapshot(self):
+        # A new start frame for an animation that's already
+        # looping still changes what the board does
+        return (self.lamps_enabled, tuple(self.bitmap) if self.bitmap else None,
+                tuple(sorted(self.looping)), tuple(sorted(self.scheduled.items())))
+
+    def describe(self):
+        enabled = {None: "?", True: "on", False: "off"}[self.lamps_enabled]
+        if self.bitmap is None:
+            lamps = "?"
+        else:
+            lamps = " ".join("%02X" % b for b in self.bitmap)
+        looping = ",".join(str(a) for a in sorted(self.looping)) or "-"
+        text = "lamps %s  bitmap [%s]  looping %s" % (enabled, lamps, looping)
+        if self.shared_time is not None:
+            frame = (self.shared_time // self.frame_duration) & 0xFFFF if self.frame_duration else 0
+            text += "  clock %d ms (frame %d)" % (self.shared_time, frame)
+        if self.scheduled:
+            text += "  start " + ",".join("%d@%d" % (a, f) for a, f in sorted(self.scheduled.items()))
+        return text
+
+
+def parse_frame(frame):
+    if len(frame) < FRAME_OVERHEAD + 1:
+        raise FrameError("frame is too short")
+    if frame[0] != HEADER_BYTE_1 or frame[1] != HEADER_BYTE_2:
+        raise FrameError("bad header")
+    if frame[2] != len(frame):
+        raise FrameError("length byte says %d, frame is %d" % (frame[2], len(frame)))
+    if len(frame) > MAX_FRAME_LENGTH:
+        raise FrameError("frame is longer than the %d-byte Wire buffer" % MAX_FRAME_LENGTH)
+    if frame[-1] != END_OF_MESSAGE:
+        raise FrameError("missing end of message")
+    if crc8(frame[2:-2]) != frame[-2]:
+        raise FrameError("crc is %02X, should be %02X" % (frame[-2], crc8(frame[2:-2])))
+
+    body = frame[3:-2]
+    if body[0] == COMMAND_BATCH:
+        body = body[1:]
+        if not body:
+            raise FrameError("empty batch")
+    elif command_length(body, 0) != len(body):
+        raise FrameError("single command has the wrong length")
+
+    commands = []
+    offset = 0
+    while offset < len(body):
+        length = command_length(body, offset)
+        if offset + length > len(body):
+            raise FrameError("command %d runs past the end of the frame" % body[offset])
+        commands.append((body[offset], body[offset + 1:offset + length]))
+        offset += length
+    return commands
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode ALB frames against a model accessory board")
+    parser.add_argument("capture", nargs="?", help="one hex frame per line (default: stdin)")
+    args = parser.parse_args()
+
+    source = open(args.capture) if args.capture else sys.stdin
+    board = Board()
+    num_frames = num_commands = num_redundant = num_errors = 0
+
+    for line_num, line in enumerate(source, 1):
+        line = line.split("#", 1)[0].strip()
+        if not line:
+            continue
+        try:
+            frame = [int(b, 16) for b in re.split(r"[\s,]+", line) if b]
+        except ValueError:
+            print("line %d: not hex: %s" % (line_num, line))
+            num_errors += 1
+            continue
+
+        num_frames += 1
+        try:
+            commands = parse_frame(frame)
+            for command, command_args in commands:
+                changed = board.apply(command, command_args)
+                num_commands += 1
+                name = COMMAND_NAMES.get(command, str(command))
+                arg_text = " ".join("%02X" % a for a in command_args)
+                flag = "" if changed else "  (redundant)"
+                if not changed:
+                    num_redundant += 1
+                print("line %d: %s %s%s" % (line_num, name, arg_text, flag))
+                print("         %s" % board.describe())
+        except FrameError as e:
+            print("line %d: bad frame: %s" % (line_num, e))
+            num_errors += 1
+
+    print("%d frames, %d commands, %d redundant, %d bad" % (num_frames, num_commands, num_redundant, num_errors))
+    return 1 if num_errors else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,216 @@
+#!/usr/bin/env python3
+#
+# Audio benchmark
+#
+# Reads a timestamped capture of the audio UART (the --log from
+# wavtrigger_standin.py, or any capture in the serial_stream.py
+# format) and reports:
+#
+#   - command throughput: frames and bytes per second, the busiest
+#     window, and how much of the port that uses
+#   - bytes per game event: WAV Trigger bytes sent for each telemetry
+#     record, overall and by event type
+#   - switch-to-audio latency: from a switch closing on the machine to
+#     the WAV Trigger starting the sound it triggered
+#
+#   python3 tools/wavtrigger_standin.py --port /dev/ttyUSB0 --latency 8 --log run.txt
+#   python3 tools/audio_benchmark.py run.txt
+#
+# The game events come from telemetry frames, so the sketch needs
+# RPU_OS_USE_TELEMETRY with telemetry on the audio port (as it is on
+# Rev 3 boards). Switch records are stamped with the machine's clock
+# and the capture with the host's. The two are lined up using the
+# debug event or telemetry record that went out soonest after it was
+# stamped (debug events, like the loops-per-second report, go out
+# straight away), less its time on the wire. Whatever that frame
+# still waited makes the latencies read short by as much. A sound
+# starts at the stand-in's track report when the capture has one, or
+# else when its command arrived plus --audio-latency. Exit code 1 if
+# the capture can't be measured.
+
+import argparse
+import sys
+
+from serial_stream import (CaptureError, StreamDecoder, CHANNEL_DEBUG_EVENT, CHANNEL_TELEMETRY,
+                           DEBUG_EVENT_LENGTH, TELEMETRY_EVENT_DROPPED,
+                           TELEMETRY_EVENT_NAMES, TELEMETRY_EVENT_SWITCH, parse_debug_event,
+                           parse_telemetry_records,
+                           read_capture)
+
+CMD_TRACK_CONTROL = 3
+CMD_TRACK_CONTROL_EX = 13
+TRK_PLAY_SOLO = 0
+TRK_PLAY_POLY = 1
+RSP_TRACK_REPORT = 132
+
+
+class Capture:
+    def __init__(self):
+        self.commands = []      # (host ms, frame)
+        self.starts = []        # (host ms, track) from track reports
+        self.records = []       # (host ms, record)
+        self.clock = []         # (host ms sent, machine ms)
+        self.first = None
+        self.last = None
+        self.errors = 0
+
+
+def load_capture(source, baud):
+    capture = Capture()
+    decoders = {"<": StreamDecoder(), ">": StreamDecoder()}
+    for line_num, stamp, direction, data in read_capture(source):
+        if stamp is None:
+            raise CaptureError("line %d has no timestamp" % line_num)
+        if capture.first is None:
+            capture.first = stamp
+        capture.last = stamp
+        for event in decoders[direction].feed(data):
+            if event[0] == "error":
+                capture.errors += 1
+            elif direction == ">":
+                frame = event[1] if event[0] == "wav" else None
+                if frame and frame[3] == RSP_TRACK_REPORT and frame[7]:
+                    capture.starts.append((stamp, (frame[4] | (frame[5] << 8)) + 1))
+            elif event[0] == "wav":
+                capture.commands.append((stamp, event[1]))
+            else:
+                # The stamp is when the frame's last byte arrived
+                sent = stamp - (len(event[2]) + 4) * 10000.0 / baud
+                if event[1] == CHANNEL_TELEMETRY:
+                    for record in parse_telemetry_records(event[2]):
+                        capture.records.append((stamp, record))
+                        capture.clock.append((sent, record["timestamp"]))
+                elif event[1] == CHANNEL_DEBUG_EVENT and len(event[2]) == DEBUG_EVENT_LENGTH:
+                    capture.clock.append((sent, parse_debug_event(event[2])["timestamp"]))
+    return capture
+
+
+def is_play(frame):
+    return frame[3] in (CMD_TRACK_CONTROL, CMD_TRACK_CONTROL_EX) and frame[4] in (TRK_PLAY_SOLO, TRK_PLAY_POLY)
+
+
+def percentile(values, fraction):
+    ordered = sorted(values)
+    return ordered[min(len(ordered) - 1, int(fraction * len(ordered)))]
+
+
+def report_throughput(capture, window, baud):
+    duration = max(capture.last - capture.first, 1.0)
+    num_bytes = sum(len(frame) for _, frame in capture.commands)
+    print("Throughput")
+    print("  %d frames, %d bytes in %.1f s" % (len(capture.commands), num_bytes, duration / 1000.0))
+    print("  %.1f frames/s, %.1f bytes/s" % (len(capture.commands) * 1000.0 / duration, num_bytes * 1000.0 / duration))
+
+    # Busiest window, sliding over frame arrivals
+    busiest = 0
+    first = 0
+    in_window = 0
+    for stamp, frame in capture.commands:
+        in_window += len(frame)
+        while capture.commands[first][0] <= stamp - window:
+            in_window -= len(capture.commands[first][1])
+            first += 1
+        busiest = max(busiest, in_window)
+    capacity = baud / 10.0 * window / 1000.0
+    print("  busiest %d ms: %d bytes (%.0f%% of the port at %d baud)"
+          % (window, busiest, busiest * 100.0 / capacity, baud))
+
+
+def clock_offset(capture):
+    # Host time = machine time + offset; the smallest difference
+    # is the frame that waited least before it went out
+    return min(sent - machine for sent, machine in capture.clock)
+
+
+def report_bytes_per_event(capture):
+    records = [r for _, r in capture.records if r["type"] != TELEMETRY_EVENT_DROPPED]
+    print("Bytes per game event")
+    if not records:
+        print("  no telemetry in the capture")
+        return
+    num_bytes = sum(len(frame) for _, frame in capture.commands)
+    print("  %d events, %.1f bytes each" % (len(records), float(num_bytes) / len(records)))
+
+    # Each command is charged to the latest event the machine
+    # logged before the command arrived
+    offset = clock_offset(capture)
+    by_type = {}
+    index = -1
+    for stamp, frame in capture.commands:
+        while index + 1 < len(records) and records[index + 1]["timestamp"] + offset <= stamp:
+            index += 1
+        if index >= 0:
+            event_type = records[index]["type"]
+            by_type[event_type] = by_type.get(event_type, 0) + len(frame)
+    counts = {}
+    for r in records:
+        counts[r["type"]] = counts.get(r["type"], 0) + 1
+    for event_type in sorted(counts):
+        name = TELEMETRY_EVENT_NAMES.get(event_type, "type %d" % event_type)
+        print("  %-14s %5d events %7.1f bytes each" % (name, counts[event_type],
+                                                       float(by_type.get(event_type, 0)) / counts[event_type]))
+
+
+def report_latency(capture, window, audio_latency, switches):
+    print("Switch-to-audio latency")
+    switch_records = [(stamp, r) for stamp, r in capture.records
+                      if r["type"] == TELEMETRY_EVENT_SWITCH and (not switches or r["detail"] in switches)]
+    if not switch_records:
+        print("  no switch telemetry in the capture")
+        return False
+
+    offset = clock_offset(capture)
+    plays = [(stamp, frame[5] | (frame[6] << 8)) for stamp, frame in capture.commands if is_play(frame)]
+    latencies = []
+    unmatched = 0
+    for _, record in switch_records:
+        closed = record["timestamp"] + offset
+        play = next(((stamp, track) for stamp, track in plays if closed <= stamp <= closed + window), None)
+        if play is None:
+            unmatched += 1
+            continue
+        start = next((s for s, track in capture.starts if track == play[1] and play[0] <= s <= play[0] + window),
+                     play[0] + audio_latency)
+        latencies.append(start - closed)
+
+    if not latencies:
+        print("  no sound started within %d ms of a switch" % window)
+        return False
+    print("  %d switches, %d with no sound within %d ms" % (len(switch_records), unmatched, window))
+    print("  min %.1f ms, median %.1f ms, 95th %.1f ms, max %.1f ms"
+          % (min(latencies), percentile(latencies, 0.5), percentile(latencies, 0.95), max(latencies)))
+    return True
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Measure audio throughput and latency from a capture")
+    parser.add_argument("capture", nargs="?", help="timestamped capture (default: stdin)")
+    parser.add_argument("--window", type=int, default=250, metavar="MS",
+                        help="longest a switch can take to start its sound, and the throughput window (default: 250)")
+    parser.add_argument("--audio-latency", type=float, default=0.0, metavar="MS",
+                        help="time the WAV Trigger takes to start a track, if the capture has no reports")
+    parser.add_argument("--switch", type=int, action="append", default=[],
+                        help="only measure this switch (can be repeated)")
+    parser.add_argument("--baud", type=int, default=57600, help="port speed (default: 57600)")
+    args = parser.parse_args()
+
+    try:
+        source = open(args.capture) if args.capture else sys.stdin
+        capture = load_capture(source, args.baud)
+    except (CaptureError, IOError) as e:
+        sys.stderr.write("audio_benchmark: %s\n" % e)
+        return 1
+    if not capture.commands:
+        sys.stderr.write("audio_benchmark: no WAV Trigger commands in the capture\n")
+        return 1
+
+    report_throughput(capture, args.window, args.baud)
+    report_bytes_per_event(capture)
+    report_latency(capture, args.window, args.audio_latency, set(args.switch))
+    if capture.errors:
+        print("%d bad frames in the capture" % capture.errors)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,244 @@
+#!/usr/bin/env python3
+#
+# DMD display decoder
+#
+# Applies the I2C writes DMD_ServiceQueue() sends to a shadow of each
+# display, the way the display firmware would, so the partial text
+# writes (0x09, RPU_DMD_PARTIAL_TEXT_WRITES) can be checked without a
+# display. Input is one I2C transmission per line: the 7-bit address,
+# then the bytes, all in hex, and "NACK" at the end if the display
+# didn't acknowledge it:
+#
+#   0A 02 31 32 33 30 00
+#   0A 09 03 01 35
+#
+#   python3 tools/dmd_decoder.py bus.txt
+#   python3 tools/dmd_decoder.py bus.txt --queued queue.txt
+#
+# Each text change is printed with what the display shows after it.
+# --queued takes the transactions in the order they left the front of
+# the DMD queue (same format, before DMD_EncodeTextUpdate() rewrote
+# them) and checks the bus against them: every text write has to leave
+# the display showing exactly the queued text, an unchanged text must
+# not be sent at all, and anything else has to go out as queued. The
+# exit code is 1 on any malformed write or mismatch.
+
+import argparse
+import re
+import sys
+
+FIRST_DISPLAY_ID = 0x0A
+NUM_DISPLAY_IDS = 5
+MAX_TRANSACTION_LENGTH = 24
+
+COMMAND_WRITE_TEXT = 0x02
+COMMAND_SET_INTENSITY = 0x03
+COMMAND_BALLY_INTERFACE = 0x06
+COMMAND_SEND_EVENT = 0x07
+COMMAND_FLUSH_EVENTS = 0x08
+COMMAND_WRITE_TEXT_AT = 0x09
+
+COMMAND_NAMES = {
+    COMMAND_WRITE_TEXT: "WriteText",
+    COMMAND_SET_INTENSITY: "SetIntensity",
+    COMMAND_BALLY_INTERFACE: "BallyInterface",
+    COMMAND_SEND_EVENT: "SendEvent",
+    COMMAND_FLUSH_EVENTS: "FlushEvents",
+    COMMAND_WRITE_TEXT_AT: "WriteTextAt",
+}
+
+
+class DecodeError(Exception):
+    pass
+
+
+class Transaction:
+    def __init__(self, line_num, address, data, nacked):
+        self.line_num = line_num
+        self.address = address
+        self.data = data
+        self.nacked = nacked
+
+
+def read_transactions(path):
+    transactions = []
+    with open(path) as f:
+        for line_num, line in enumerate(f, 1):
+            line = line.split("#", 1)[0].strip()
+            if not line:
+                continue
+            tokens = [t for t in re.split(r"[\s,:]+", line) if t]
+            nacked = tokens[-1].upper() == "NACK"
+            if nacked:
+                tokens = tokens[:-1]
+            try:
+                values = [int(t, 16) for t in tokens]
+            except ValueError:
+                raise DecodeError("%s:%d: not hex: %s" % (path, line_num, line))
+            if len(values) < 2 or any(v > 0xFF for v in values):
+                raise DecodeError("%s:%d: needs an address and at least one byte" % (path, line_num))
+            transactions.append(Transaction("%s:%d" % (path, line_num), values[0], values[1:], nacked))
+    return transactions
+
+
+def text_of(data):
+    # WriteText is the command, the characters, then a 0x00
+    if len(data) < 2 or data[-1] != 0x00:
+        raise DecodeError("text write without its terminator")
+    if 0x00 in data[1:-1]:
+        raise DecodeError("text write with a 0x00 inside it")
+    return "".join(chr(c) for c in data[1:-1])
+
+
+class Display:
+    def __init__(self):
+        # None until a full text write says what's showing
+        self.text = None
+
+    def apply(self, data):
+        # Returns True if the text changed
+        command = data[0]
+        if len(data) > MAX_TRANSACTION_LENGTH:
+            raise DecodeError("%d bytes is more than the %d-byte queue entry" % (len(data), MAX_TRANSACTION_LENGTH))
+        if command == COMMAND_WRITE_TEXT:
+            self.text = text_of(data)
+            return True
+        if command == COMMAND_WRITE_TEXT_AT:
+            if len(data) < 4:
+                raise DecodeError("partial write is too short")
+            offset, count = data[1], data[2]
+            if count == 0 or len(data) != count + 3:
+                raise DecodeError("partial write of %d characters carries %d" % (count, len(data) - 3))
+            if self.text is None:
+                raise DecodeError("partial write before the display's text is known")
+            if offset + count > len(self.text):
+                raise DecodeError("partial write of %d at %d runs past the %d-character text"
+                                  % (count, offset, len(self.text)))
+            if 0x00 in data[3:]:
+                raise DecodeError("partial write with a 0x00 in it")
+            self.text = self.text[:offset] + "".join(chr(c) for c in data[3:]) + self.text[offset + count:]
+            return True
+        if command == COMMAND_BALLY_INTERFACE:
+            # Re-initializing clears the text
+            self.text = None
+            return False
+        if command not in COMMAND_NAMES:
+            raise DecodeError("unknown command %02X" % command)
+        return False
+
+
+def is_score_display(address):
+    # Only these have a shadow in the firmware
+    return FIRST_DISPLAY_ID <= address < FIRST_DISPLAY_ID + NUM_DISPLAY_IDS
+
+
+def describe(transaction, display):
+    name = COMMAND_NAMES.get(transaction.data[0], "%02X" % transaction.data[0])
+    text = "%02X %s (%d bytes)" % (transaction.address, name, len(transaction.data))
+    if display.text is not None and transaction.data[0] in (COMMAND_WRITE_TEXT, COMMAND_WRITE_TEXT_AT):
+        text += "  [%s]" % display.text
+    if transaction.nacked:
+        text += "  NACK"
+    return text
+
+
+def check_against_queue(bus, queued):
+    # Walks the queue in order, pairing each entry with the bus
+    # transaction (if any) that DMD_ServiceQueue() sent for it
+    displays = {}
+    errors = []
+    bus_pos = 0
+    for entry in queued:
+        display = displays.setdefault(entry.address, Display())
+        try:
+            if entry.data[0] == COMMAND_WRITE_TEXT:
+                wanted = text_of(entry.data)
+                if display.text == wanted and is_score_display(entry.address):
+                    # Unchanged - nothing should be sent
+                    continue
+        except DecodeError as e:
+            errors.append("%s: %s" % (entry.line_num, e))
+            continue
+
+        if bus_pos >= len(bus):
+            errors.append("%s: never sent" % entry.line_num)
+            continue
+        sent = bus[bus_pos]
+        bus_pos += 1
+        if sent.address != entry.address:
+            errors.append("%s: sent to %02X, queued for %02X (%s)" % (sent.line_num, sent.address,
+                                                                      entry.address, entry.line_num))
+            continue
+        try:
+            display.apply(sent.data)
+        except DecodeError as e:
+            errors.append("%s: %s" % (sent.line_num, e))
+            display.text = None
+            continue
+        if sent.nacked:
+            # The firmware forgets what the display has, and so do we
+            display.text = None
+            continue
+        if entry.data[0] == COMMAND_WRITE_TEXT:
+            if display.text != wanted:
+                errors.append("%s: display shows [%s], queued [%s] (%s)" % (sent.line_num, display.text,
+                                                                           wanted, entry.line_num))
+                display.text = wanted
+        elif sent.data != entry.data:
+            errors.append("%s: sent differs from the queued %s (%s)" % (sent.line_num,
+                                                                       COMMAND_NAMES.get(entry.data[0], "write"),
+                                                                       entry.line_num))
+    for sent in bus[bus_pos:]:
+        errors.append("%s: sent, but nothing was queued for it" % sent.line_num)
+    return errors
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode DMD display writes against a shadow display")
+    parser.add_argument("bus", help="captured I2C transmissions")
+    parser.add_argument("--queued", metavar="FILE", help="queued transactions to check the bus against")
+    args = parser.parse_args()
+
+    try:
+        bus = read_transactions(args.bus)
+        queued = read_transactions(args.queued) if args.queued else None
+    except (DecodeError, IOError) as e:
+        sys.stderr.write("dmd_decoder: %s\n" % e)
+        return 1
+
+    displays = {}
+    num_errors = 0
+    for transaction in bus:
+        if not is_score_display(transaction.address):
+            print("%s: address %02X isn't a score display" % (transaction.line_num, transaction.address))
+        display = displays.setdefault(transaction.address, Display())
+        try:
+            display.apply(transaction.data)
+        except DecodeError as e:
+            print("%s: bad write: %s" % (transaction.line_num, e))
+            num_errors += 1
+            display.text = None
+            continue
+        print("%s: %s" % (transaction.line_num, describe(transaction, display)))
+        if transaction.nacked:
+            display.text = None
+
+    bus_bytes = sum(len(t.data) for t in bus)
+    print("%d transactions, %d bytes, %d bad" % (len(bus), bus_bytes, num_errors))
+    for address in sorted(displays):
+        text = displays[address].text
+        print("  %02X shows %s" % (address, "[%s]" % text if text is not None else "?"))
+
+    if queued is not None:
+        errors = check_against_queue(bus, queued)
+        for error in errors:
+            print(error)
+        queued_bytes = sum(len(t.data) for t in queued)
+        print("%d queued transactions, %d bytes (%d saved on the bus), %d mismatches"
+              % (len(queued), queued_bytes, queued_bytes - bus_bytes, len(errors)))
+        num_errors += len(errors)
+    return 1 if num_errors else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
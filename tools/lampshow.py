@@ -0,0 +1,309 @@
+#!/usr/bin/env python3
+#
+# Lamp show compiler and previewer
+#
+# Reads a lamp show description (see lamp_shows.txt) and writes the
+# flash-resident XOR-delta streams that ShowLampAnimation() plays
+# back from LampAnimations.h. Lamp names come from the LAMP_ defines
+# in LostWorld.h, so shows don't have to be written in hex.
+#
+#   python3 tools/lampshow.py tools/lamp_shows.txt --update LampAnimations.h
+#   python3 tools/lampshow.py tools/lamp_shows.txt --check LampAnimations.h
+#   python3 tools/lampshow.py tools/lamp_shows.txt --preview Radar [--play 100]
+#
+# --update rewrites everything between the generated-section markers
+# in the header and leaves the rest of the file alone. --check exits
+# with 1 if the header doesn't match the show file, so it can be used
+# as a build step. Only the Python 3 standard library is needed.
+
+import argparse
+import os
+import re
+import sys
+import time
+
+BEGIN_MARKER = "// BEGIN GENERATED LAMP SHOWS"
+END_MARKER = "// END GENERATED LAMP SHOWS"
+DEFAULT_FRAME_BYTES = 6
+MAX_STEPS = 255
+
+
+class ShowError(Exception):
+    pass
+
+
+class Animation:
+    def __init__(self, ident, title, line):
+        self.ident = ident
+        self.title = title
+        self.line = line
+        self.frames = []
+
+
+def read_lamp_names(path):
+    # "#define LAMP_NAME    12    // comment" -> {"LAMP_NAME": 12}
+    lamps = {}
+    define = re.compile(r"^\s*#define\s+(LAMP_\w+)\s+(\d+)\b")
+    with open(path) as f:
+        for line in f:
+            m = define.match(line)
+            if m:
+                lamps[m.group(1)] = int(m.group(2))
+    if not lamps:
+        raise ShowError("%s: no LAMP_ defines found" % path)
+    return lamps
+
+
+def read_frame_bytes(header_path):
+    if header_path and os.path.exists(header_path):
+        with open(header_path) as f:
+            m = re.search(r"#define\s+NUM_LAMP_ANIMATION_BYTES\s+(\d+)", f.read())
+            if m:
+                return int(m.group(1))
+    return DEFAULT_FRAME_BYTES
+
+
+def lookup_lamp(token, lamps, where):
+    if token.isdigit():
+        return int(token)
+    name = token if token.startswith("LAMP_") else "LAMP_" + token
+    if name not in lamps:
+        raise ShowError("%s: unknown lamp '%s'" % (where, token))
+    return lamps[name]
+
+
+def parse_show(path, lamps, frame_bytes):
+    animations = []
+    layout = []
+    current = None
+    in_layout = False
+
+    with open(path) as f:
+        for line_num, raw in enumerate(f, 1):
+            where = "%s:%d" % (path, line_num)
+            line = raw.split("#", 1)[0].strip()
+            if not line:
+                continue
+            tokens = line.split()
+
+            if tokens[0] == "layout":
+                if current or in_layout:
+                    raise ShowError("%s: layout can't be nested" % where)
+                in_layout = True
+                continue
+            if tokens[0] == "animation":
+                if current or in_layout:
+                    raise ShowError("%s: missing 'end'" % where)
+                if len(tokens) < 2 or not re.match(r"^[A-Za-z]\w*$", tokens[1]):
+                    raise ShowError("%s: animation needs an identifier" % where)
+                if any(a.ident == tokens[1] for a in animations):
+                    raise ShowError("%s: animation '%s' is defined twice" % (where, tokens[1]))
+                title = " ".join(tokens[2:]) or tokens[1]
+                current = Animation(tokens[1], title, line_num)
+                continue
+            if tokens[0] == "end":
+                if in_layout:
+                    in_layout = False
+                elif current:
+                    if not current.frames:
+                        raise ShowError("%s: animation '%s' has no frames" % (where, current.ident))
+                    if len(current.frames) > MAX_STEPS:
+                        raise ShowError("%s: animation '%s' has %d steps (max %d)"
+                                        % (where, current.ident, len(current.frames), MAX_STEPS))
+                    animations.append(current)
+                    current = None
+                else:
+                    raise ShowError("%s: 'end' without a block" % where)
+                continue
+
+            if in_layout:
+                row = []
+                for token in tokens:
+                    row.append(None if token == "." else lookup_lamp(token, lamps, where))
+                layout.append(row)
+                continue
+
+            if not current:
+                raise ShowError("%s: frame outside of an animation" % where)
+
+            # A frame line lists the lamps that are lit ("-" for none),
+            # optionally ending with xN to hold it for N steps
+            repeat = 1
+            if re.match(r"^x\d+$", tokens[-1]):
+                repeat = int(tokens[-1][1:])
+                tokens = tokens[:-1]
+                if repeat < 1:
+                    raise ShowError("%s: repeat count must be at least 1" % where)
+            frame = [0] * frame_bytes
+            for token in tokens:
+                if token == "-":
+                    continue
+                lamp = lookup_lamp(token, lamps, where)
+                if lamp >= frame_bytes * 8:
+                    raise ShowError("%s: lamp %s (%d) is outside the %d animation bytes"
+                                    % (where, token, lamp, frame_bytes))
+                bit = 1 << (lamp % 8)
+                if frame[lamp // 8] & bit:
+                    raise ShowError("%s: lamp %s is listed twice" % (where, token))
+                frame[lamp // 8] |= bit
+            current.frames.extend([list(frame) for _ in range(repeat)])
+
+    if current or in_layout:
+        raise ShowError("%s: missing 'end' at end of file" % path)
+    if not animations:
+        raise ShowError("%s: no animations" % path)
+    return animations, layout
+
+
+def encode_animation(frames):
+    # Must match GetLampAnimationFrame(): each step is a mask of the
+    # frame bytes that changed, then the XOR of each changed byte
+    steps = []
+    previous = [0] * len(frames[0])
+    for frame in frames:
+        changed = 0
+        deltas = []
+        for byte_num, value in enumerate(frame):
+            if value != previous[byte_num]:
+                changed |= 1 << byte_num
+                deltas.append(value ^ previous[byte_num])
+        steps.append([changed] + deltas)
+        previous = frame
+    return steps
+
+
+def hex_list(values):
+    return ", ".join("0x%02X" % v for v in values)
+
+
+def generate(animations, frame_bytes):
+    out = []
+    out.append("#define NUM_LAMP_ANIMATIONS       %d" % len(animations))
+    out.append("")
+    for index, anim in enumerate(animations):
+        steps = encode_animation(anim.frames)
+        data = []
+        for step_num, step in enumerate(steps):
+            comma = "," if step_num < len(steps) - 1 else ""
+            data.append(hex_list(step) + comma)
+        # Comments line up two spaces past the longest step (with its comma)
+        width = max(len(hex_list(step)) + 1 for step in steps) + 2
+        out.append("// %s Animation (index = %d)" % (anim.title, index))
+        out.append("const byte LampAnimation%s[] PROGMEM = {" % anim.ident)
+        for d, frame in zip(data, anim.frames):
+            out.append("  %s// {%s}" % (d.ljust(width), hex_list(frame)))
+        out.append("};")
+        out.append("")
+    out.append("const LampAnimation LampAnimations[NUM_LAMP_ANIMATIONS] PROGMEM = {")
+    for index, anim in enumerate(animations):
+        comma = "," if index < len(animations) - 1 else ""
+        out.append("  {LampAnimation%s, %d}%s" % (anim.ident, len(anim.frames), comma))
+    out.append("};")
+    return "\n".join(out) + "\n"
+
+
+def splice_header(header_text, generated):
+    begin = header_text.find(BEGIN_MARKER)
+    end = header_text.find(END_MARKER)
+    if begin < 0 or end < begin:
+        raise ShowError("header has no '%s' / '%s' markers" % (BEGIN_MARKER, END_MARKER))
+    begin = header_text.index("\n", begin) + 1
+    return header_text[:begin] + generated + header_text[end:]
+
+
+def report_sizes(animations, frame_bytes):
+    total = 0
+    for anim in animations:
+        size = sum(len(s) for s in encode_animation(anim.frames))
+        raw = len(anim.frames) * frame_bytes
+        total += size
+        sys.stderr.write("%-20s %3d steps %4d bytes (%d uncompressed)\n"
+                         % (anim.ident, len(anim.frames), size, raw))
+    sys.stderr.write("%-20s           %4d bytes of flash\n" % ("total", total))
+
+
+def render_frame(frame, layout, frame_bytes):
+    def lit(lamp):
+        return frame[lamp // 8] & (1 << (lamp % 8))
+
+    lines = []
+    if layout:
+        for row in layout:
+            cells = []
+            for lamp in row:
+                if lamp is None:
+                    cells.append("   ")
+                elif lamp >= frame_bytes * 8:
+                    cells.append(" . ")
+                else:
+                    cells.append("(*)" if lit(lamp) else " o ")
+            lines.append("".join(cells).rstrip())
+    else:
+        # No layout - show the lamp matrix, one frame byte per row
+        for byte_num in range(frame_bytes):
+            cells = ["*" if lit(byte_num * 8 + bit) else "." for bit in range(8)]
+            lines.append("%2d-%2d  %s" % (byte_num * 8, byte_num * 8 + 7, " ".join(cells)))
+    return lines
+
+
+def preview(anim, layout, frame_bytes, play_ms):
+    for step, frame in enumerate(anim.frames):
+        if play_ms:
+            sys.stdout.write("\x1b[H\x1b[2J")
+        print("%s  step %d/%d  {%s}" % (anim.ident, step, len(anim.frames) - 1, hex_list(frame)))
+        for line in render_frame(frame, layout, frame_bytes):
+            print("  " + line)
+        print("")
+        if play_ms:
+            sys.stdout.flush()
+            time.sleep(play_ms / 1000.0)
+
+
+def main():
+    root = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+    parser = argparse.ArgumentParser(description="Compile and preview lamp shows")
+    parser.add_argument("show", help="lamp show description")
+    parser.add_argument("--lamps", default=os.path.join(root, "LostWorld.h"),
+                        help="header with the LAMP_ defines (default: LostWorld.h)")
+    parser.add_argument("--update", metavar="HEADER", help="rewrite the generated section of HEADER")
+    parser.add_argument("--check", metavar="HEADER", help="fail if HEADER is out of date")
+    parser.add_argument("--preview", metavar="ANIMATION", help="print each step of ANIMATION")
+    parser.add_argument("--play", metavar="MS", type=int, default=0,
+                        help="with --preview, animate in the terminal at MS per step")
+    args = parser.parse_args()
+
+    header = args.update or args.check
+    try:
+        lamps = read_lamp_names(args.lamps)
+        frame_bytes = read_frame_bytes(header)
+        animations, layout = parse_show(args.show, lamps, frame_bytes)
+        generated = generate(animations, frame_bytes)
+
+        if args.preview:
+            matches = [a for a in animations if a.ident == args.preview or str(animations.index(a)) == args.preview]
+            if not matches:
+                raise ShowError("no animation named '%s'" % args.preview)
+            preview(matches[0], layout, frame_bytes, args.play)
+
+        if header:
+            with open(header) as f:
+                old_text = f.read()
+            new_text = splice_header(old_text, generated)
+            if args.check:
+                if new_text != old_text:
+                    sys.stderr.write("%s is out of date - run with --update\n" % header)
+                    return 1
+            elif new_text != old_text:
+                with open(header, "w") as f:
+                    f.write(new_text)
+            report_sizes(animations, frame_bytes)
+        elif not args.preview:
+            sys.stdout.write(generated)
+    except (ShowError, IOError) as e:
+        sys.stderr.write("lampshow: %s\n" % e)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,230 @@
+#
+# Shared UART stream decoder
+#
+# Rev 3 and earlier boards put the WAV Trigger and the SerialChannels
+# frames (debug and telemetry, see SerialChannels.h) on the same UART.
+# This splits that byte stream back into its two kinds of frame, and
+# reads and writes the capture format the host tools share:
+#
+#   @1234.5 < F0 AA 08 03 01 2C 01 55
+#   @1236.0 > F0 AA 09 84 2B 01 00 01 55
+#
+# One chunk per line: an optional host time in ms, an optional
+# direction ("<" from the machine, the default, or ">" to it) and the
+# bytes in hex. Anything after a "#" is a comment.
+#
+# Used by wavtrigger_standin.py, audio_benchmark.py and
+# telemetry_collector.py. Only the Python 3 standard library is needed.
+
+import re
+
+WAV_SOM1 = 0xF0
+WAV_SOM2 = 0xAA
+WAV_EOM = 0x55
+WAV_MIN_FRAME_LENGTH = 5
+WAV_MAX_FRAME_LENGTH = 32
+
+CHANNEL_FRAME_START = 0x7E
+CHANNEL_ESCAPE = 0x7D
+CHANNEL_ESCAPE_XOR = 0x20
+CHANNEL_MAX_PAYLOAD = 28
+
+CHANNEL_AUDIO = 0
+CHANNEL_TELEMETRY = 1
+CHANNEL_DEBUG_EVENT = 2
+CHANNEL_DEBUG_TEXT = 3
+
+TELEMETRY_RECORD_LENGTH = 12
+DEBUG_EVENT_LENGTH = 9
+
+TELEMETRY_EVENT_NAMES = {
+    1: "switch",
+    2: "score",
+    3: "game mode",
+    4: "ball drain",
+    5: "ball save",
+    6: "coin",
+    7: "credit",
+    8: "tilt warning",
+    0xFF: "dropped",
+}
+TELEMETRY_EVENT_SWITCH = 1
+TELEMETRY_EVENT_SCORE = 2
+TELEMETRY_EVENT_GAME_MODE = 3
+TELEMETRY_EVENT_BALL_DRAIN = 4
+TELEMETRY_EVENT_BALL_SAVE = 5
+TELEMETRY_EVENT_COIN = 6
+TELEMETRY_EVENT_CREDIT = 7
+TELEMETRY_EVENT_TILT_WARNING = 8
+TELEMETRY_EVENT_DROPPED = 0xFF
+
+# Same IDs as the DEBUG_EVENT_* defines in LostWorld25.ino
+DEBUG_EVENT_NAMES = {
+    1: "starting",
+    2: "initializing MPU",
+    3: "init result",
+    4: "original code requested",
+    5: "entering attract",
+    6: "attract trapped ball check",
+    7: "unhandled switch",
+    8: "game mode",
+    9: "unstructured play",
+    10: "ball save",
+    11: "countdown over",
+    12: "start button",
+    13: "loops per second",
+}
+
+BAUD_RATES = {9600: "B9600", 19200: "B19200", 38400: "B38400", 57600: "B57600", 115200: "B115200"}
+
+
+class CaptureError(Exception):
+    pass
+
+
+class StreamDecoder:
+    # Feed bytes in as they arrive; feed() returns the frames that
+    # were completed by them:
+    #   ("wav", [frame bytes])
+    #   ("channel", channel, [payload bytes])
+    #   ("error", "what went wrong")
+    # Bytes outside of any frame are counted in self.stray.
+
+    def __init__(self):
+        self.stray = 0
+        self._reset()
+
+    def _reset(self):
+        self.state = "idle"
+        self.buffer = []
+        self.escaped = False
+
+    def feed(self, data):
+        out = []
+        for b in data:
+            self._feed_byte(b, out)
+        return out
+
+    def _feed_byte(self, b, out):
+        if self.state == "idle":
+            if b == WAV_SOM1:
+                self.state = "wav"
+                self.buffer = [b]
+            elif b == CHANNEL_FRAME_START:
+                self.state = "channel"
+                self.buffer = []
+                self.escaped = False
+            else:
+                self.stray += 1
+            return
+
+        if self.state == "wav":
+            self.buffer.append(b)
+            count = len(self.buffer)
+            if count == 2 and b != WAV_SOM2:
+                self.stray += 2
+                self._reset()
+            elif count == 3 and not WAV_MIN_FRAME_LENGTH <= b <= WAV_MAX_FRAME_LENGTH:
+                out.append(("error", "WAV Trigger frame length %d" % b))
+                self._reset()
+            elif count > 3 and count == self.buffer[2]:
+                if b == WAV_EOM:
+                    out.append(("wav", self.buffer))
+                else:
+                    out.append(("error", "WAV Trigger frame without end of message"))
+                self._reset()
+            return
+
+        # Channel frame - neither start byte can appear unescaped inside
+        # one, so seeing either means the frame was cut short
+        if b == CHANNEL_FRAME_START or b == WAV_SOM1:
+            out.append(("error", "channel frame cut off"))
+            self._reset()
+            self._feed_byte(b, out)
+            return
+        if b == CHANNEL_ESCAPE:
+            self.escaped = True
+            return
+        if self.escaped:
+            b ^= CHANNEL_ESCAPE_XOR
+            self.escaped = False
+        self.buffer.append(b)
+        if len(self.buffer) == 2 and self.buffer[1] > CHANNEL_MAX_PAYLOAD:
+            out.append(("error", "channel frame length %d" % self.buffer[1]))
+            self._reset()
+        elif len(self.buffer) >= 3 and len(self.buffer) == self.buffer[1] + 3:
+            if sum(self.buffer) & 0xFF:
+                out.append(("error", "channel %d checksum" % self.buffer[0]))
+            else:
+                out.append(("channel", self.buffer[0], self.buffer[2:-1]))
+            self._reset()
+
+
+def parse_telemetry_records(payload):
+    # Same layout as the TelemetryRecord comment in SerialChannels.h
+    if len(payload) % TELEMETRY_RECORD_LENGTH:
+        raise CaptureError("telemetry payload of %d bytes" % len(payload))
+    records = []
+    for offset in range(0, len(payload), TELEMETRY_RECORD_LENGTH):
+        r = payload[offset:offset + TELEMETRY_RECORD_LENGTH]
+        records.append({
+            "type": r[0],
+            "detail": r[1],
+            "sequence": r[2] | (r[3] << 8),
+            "timestamp": r[4] | (r[5] << 8) | (r[6] << 16) | (r[7] << 24),
+            "value": r[8] | (r[9] << 8) | (r[10] << 16) | (r[11] << 24),
+        })
+    return records
+
+
+def parse_debug_event(payload):
+    # Same layout as Channel_DebugEvent(): ID, then the time and a
+    # signed value, both 4 bytes little-endian
+    if len(payload) != DEBUG_EVENT_LENGTH:
+        raise CaptureError("debug event of %d bytes" % len(payload))
+    value = payload[5] | (payload[6] << 8) | (payload[7] << 16) | (payload[8] << 24)
+    if value & 0x80000000:
+        value -= 0x100000000
+    return {
+        "id": payload[0],
+        "name": DEBUG_EVENT_NAMES.get(payload[0], "event %d" % payload[0]),
+        "timestamp": payload[1] | (payload[2] << 8) | (payload[3] << 16) | (payload[4] << 24),
+        "value": value,
+    }
+
+
+def describe_debug_event(event):
+    return "@%d ms %s %d" % (event["timestamp"], event["name"], event["value"])
+
+
+def read_capture(source):
+    # Yields (line number, host ms or None, direction, bytes)
+    line_pattern = re.compile(r"^(?:@([0-9.]+)\s*)?([<>])?\s*(.*)$")
+    for line_num, line in enumerate(source, 1):
+        line = line.split("#", 1)[0].strip()
+        if not line:
+            continue
+        m = line_pattern.match(line)
+        try:
+            stamp = float(m.group(1)) if m.group(1) else None
+            data = [int(b, 16) for b in re.split(r"[\s,]+", m.group(3)) if b]
+        except ValueError:
+            raise CaptureError("line %d: not a capture line: %s" % (line_num, line))
+        if any(b > 0xFF for b in data):
+            raise CaptureError("line %d: byte out of range" % line_num)
+        yield line_num, stamp, m.group(2) or "<", data
+
+
+def format_capture_line(stamp, direction, data):
+    return "@%.1f %s %s" % (stamp, direction, " ".join("%02X" % b for b in data))
+
+
+def set_raw(fd, baud):
+    # Raw 8N1 at baud, for a serial port or pseudo-terminal
+    import termios
+    import tty
+    tty.setraw(fd)
+    attrs = termios.tcgetattr(fd)
+    speed = getattr(termios, BAUD_RATES[baud])
+    attrs[4] = attrs[5] = speed
+    termios.tcsetattr(fd, termios.TCSANOW, attrs)
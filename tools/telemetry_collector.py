@@ -0,0 +1,222 @@
+#!/usr/bin/env python3
+#
+# Telemetry collector
+#
+# Reads the telemetry stream (RPU_OS_USE_TELEMETRY, see the record
+# layout in SerialChannels.h) from one or more machines and keeps
+# per-machine stats: switch hits, points, game modes, drains, ball saves,
+# coins, credits, tilt warnings, and any records that were lost.
+# Each source is a serial port, a named pipe, a file, or "-" for
+# stdin, optionally named:
+#
+#   python3 tools/telemetry_collector.py left=/dev/ttyUSB0 right=/dev/ttyUSB1
+#   python3 tools/telemetry_collector.py --interval 60 floor.fifo
+#   some-relay | python3 tools/telemetry_collector.py --json -
+#
+# WAV Trigger commands and debug frames on the same port are skipped.
+# Stats are printed every --interval seconds and once every source
+# has closed (or on Ctrl-C). Exit code 1 if a source can't be opened.
+
+import argparse
+import json
+import os
+import select
+import sys
+import time
+
+from serial_stream import (BAUD_RATES, StreamDecoder, CaptureError, CHANNEL_TELEMETRY,
+                           TELEMETRY_EVENT_NAMES, TELEMETRY_EVENT_SWITCH, TELEMETRY_EVENT_SCORE,
+                           TELEMETRY_EVENT_GAME_MODE, TELEMETRY_EVENT_BALL_DRAIN,
+                           TELEMETRY_EVENT_BALL_SAVE, TELEMETRY_EVENT_COIN, TELEMETRY_EVENT_CREDIT,
+                           TELEMETRY_EVENT_TILT_WARNING, TELEMETRY_EVENT_DROPPED,
+                           parse_telemetry_records, set_raw)
+
+TOP_SWITCHES = 5
+
+
+class Machine:
+    def __init__(self, name):
+        self.name = name
+        self.decoder = StreamDecoder()
+        self.records = 0
+        self.events = {}
+        self.switch_hits = {}
+        self.switch_points = {}
+        self.points = 0
+        self.game_modes = {}
+        self.drains = 0
+        self.ball_saves = 0
+        self.coins = {}
+        self.credits = 0
+        self.tilt_warnings = 0
+        self.next_sequence = None
+        self.missing = 0
+        self.reported_dropped = 0
+        self.restarts = 0
+        self.last_timestamp = None
+        self.bad_frames = 0
+
+    def feed(self, data):
+        for event in self.decoder.feed(data):
+            if event[0] == "error":
+                self.bad_frames += 1
+            elif event[0] == "channel" and event[1] == CHANNEL_TELEMETRY:
+                try:
+                    records = parse_telemetry_records(event[2])
+                except CaptureError:
+                    self.bad_frames += 1
+                    continue
+                for record in records:
+                    self.add(record)
+
+    def add(self, record):
+        # A machine that restarts starts over at sequence 0 with its
+        # clock back near 0 - that's not a gap
+        if self.last_timestamp is not None and record["timestamp"] < self.last_timestamp:
+            self.restarts += 1
+            self.next_sequence = None
+        if self.next_sequence is not None:
+            self.missing += (record["sequence"] - self.next_sequence) & 0xFFFF
+        self.next_sequence = (record["sequence"] + 1) & 0xFFFF
+        self.last_timestamp = record["timestamp"]
+
+        self.records += 1
+        event_type = record["type"]
+        self.events[event_type] = self.events.get(event_type, 0) + 1
+        detail = record["detail"]
+        value = record["value"]
+        if event_type == TELEMETRY_EVENT_SWITCH:
+            self.switch_hits[detail] = self.switch_hits.get(detail, 0) + 1
+        elif event_type == TELEMETRY_EVENT_SCORE:
+            self.points += value
+            self.switch_points[detail] = self.switch_points.get(detail, 0) + value
+        elif event_type == TELEMETRY_EVENT_GAME_MODE:
+            self.game_modes[detail] = self.game_modes.get(detail, 0) + 1
+        elif event_type == TELEMETRY_EVENT_BALL_DRAIN:
+            self.drains += 1
+        elif event_type == TELEMETRY_EVENT_BALL_SAVE:
+            self.ball_saves += 1
+        elif event_type == TELEMETRY_EVENT_COIN:
+            self.coins[detail] = self.coins.get(detail, 0) + 1
+        elif event_type == TELEMETRY_EVENT_CREDIT:
+            self.credits += detail
+        elif event_type == TELEMETRY_EVENT_TILT_WARNING:
+            self.tilt_warnings += 1
+        elif event_type == TELEMETRY_EVENT_DROPPED:
+            self.reported_dropped += value
+
+    def stats(self):
+        # Records the machine couldn't fit in its ring are counted by
+        # the machine; the rest of the gap was lost on the way here
+        return {
+            "records": self.records,
+            "events": dict((TELEMETRY_EVENT_NAMES.get(t, str(t)), n) for t, n in sorted(self.events.items())),
+            "switch_hits": dict((str(s), n) for s, n in sorted(self.switch_hits.items())),
+            "points": self.points,
+            "points_by_switch": dict((str(s), n) for s, n in sorted(self.switch_points.items())),
+            "game_modes": dict((str(m), n) for m, n in sorted(self.game_modes.items())),
+            "drains": self.drains,
+            "ball_saves": self.ball_saves,
+            "coins": dict((str(c), n) for c, n in sorted(self.coins.items())),
+            "credits": self.credits,
+            "tilt_warnings": self.tilt_warnings,
+            "missing": self.missing,
+            "dropped_by_machine": self.reported_dropped,
+            "lost_in_transit": max(0, self.missing - self.reported_dropped),
+            "restarts": self.restarts,
+            "uptime_ms": self.last_timestamp,
+            "bad_frames": self.bad_frames,
+        }
+
+    def describe(self):
+        s = self.stats()
+        lines = ["%s: %d records, up %s" % (self.name, s["records"],
+                                            "%.1f s" % (s["uptime_ms"] / 1000.0) if s["uptime_ms"] is not None else "?")]
+        lines.append("  %d points, %d drains, %d ball saves, %d tilt warnings"
+                     % (s["points"], s["drains"], s["ball_saves"], s["tilt_warnings"]))
+        lines.append("  %d coins, %d credits" % (sum(self.coins.values()), s["credits"]))
+        busiest = sorted(self.switch_hits.items(), key=lambda item: -item[1])[:TOP_SWITCHES]
+        if busiest:
+            lines.append("  busiest switches: " + ", ".join("%d (%d)" % (sw, n) for sw, n in busiest))
+        if s["missing"] or s["bad_frames"] or s["restarts"]:
+            lines.append("  %d missing (%d dropped by the machine, %d in transit), %d bad frames, %d restarts"
+                         % (s["missing"], s["dropped_by_machine"], s["lost_in_transit"],
+                            s["bad_frames"], s["restarts"]))
+        return "\n".join(lines)
+
+
+def open_source(path, baud):
+    if path == "-":
+        return sys.stdin.fileno()
+    # Non-blocking so a named pipe with no writer yet
+    # doesn't hold up the other sources
+    fd = os.open(path, os.O_RDONLY | os.O_NONBLOCK | getattr(os, "O_NOCTTY", 0))
+    if os.isatty(fd):
+        set_raw(fd, baud)
+    return fd
+
+
+def report(machines, as_json):
+    if as_json:
+        print(json.dumps(dict((m.name, m.stats()) for m in machines), sort_keys=True))
+    else:
+        for machine in machines:
+            print(machine.describe())
+    sys.stdout.flush()
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Collect per-machine stats from telemetry streams")
+    parser.add_argument("sources", nargs="+", metavar="[NAME=]SOURCE",
+                        help="serial port, named pipe, file, or - for stdin")
+    parser.add_argument("--baud", type=int, default=57600, choices=sorted(BAUD_RATES),
+                        help="speed for serial ports (default: 57600)")
+    parser.add_argument("--interval", type=float, default=0, metavar="S",
+                        help="also print stats every S seconds")
+    parser.add_argument("--json", action="store_true", help="print stats as JSON")
+    args = parser.parse_args()
+
+    machines = []
+    sources = {}
+    try:
+        for source in args.sources:
+            name, _, path = source.rpartition("=")
+            if not name:
+                name = "stdin" if path == "-" else os.path.basename(path)
+            machine = Machine(name)
+            machines.append(machine)
+            sources[open_source(path, args.baud)] = machine
+    except (OSError, KeyError) as e:
+        sys.stderr.write("telemetry_collector: %s\n" % e)
+        return 1
+
+    next_report = time.monotonic() + args.interval
+    try:
+        while sources:
+            timeout = max(0.0, next_report - time.monotonic()) if args.interval else None
+            readable, _, _ = select.select(list(sources), [], [], timeout)
+            for fd in readable:
+                try:
+                    data = os.read(fd, 4096)
+                except BlockingIOError:
+                    continue
+                except OSError:
+                    data = b""
+                if data:
+                    sources[fd].feed(data)
+                else:
+                    del sources[fd]
+                    if fd != sys.stdin.fileno():
+                        os.close(fd)
+            if args.interval and time.monotonic() >= next_report:
+                report(machines, args.json)
+                next_report += args.interval
+    except KeyboardInterrupt:
+        pass
+
+    report(machines, args.json)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
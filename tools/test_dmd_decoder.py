@@ -0,0 +1,125 @@
+#!/usr/bin/env python3
+#
+# Checks dmd_decoder.py against queue output captured from the DMD code
+# in DisplayHandler.cpp, built on the host with RPU_DMD_PARTIAL_TEXT_WRITES
+# and a Wire that logs each transmission (and NACKs one of them).
+#
+#   python3 tools/test_dmd_decoder.py
+
+import os
+import subprocess
+import sys
+import tempfile
+import unittest
+
+DECODER = os.path.join(os.path.dirname(os.path.abspath(__file__)), "dmd_decoder.py")
+
+# What left the front of the queue, in order
+QUEUED = """\
+0B 02 31 31 30 00
+0B 06 00 00
+0B 02 20 00
+0C 02 20 00
+0A 02 37 37 31 34 34 32 35 37 00
+0C 02 31 35 30 00
+0A 02 20 00
+0A 02 42 41 4C 4C 20 31 00
+0B 02 20 00
+0B 02 42 41 4C 4C 20 31 00
+0D 02 42 41 4C 4C 20 33 00
+0C 02 38 30 00
+0A 02 42 41 4C 4C 20 34 00
+0D 02 31 34 30 00
+0B 02 20 00
+0A 02 31 34 30 00
+0B 02 35 30 00
+0B 02 42 41 4C 4C 20 32 00
+0C 02 20 00
+0B 02 42 41 4C 4C 20 30 00
+0B 02 34 30 00
+0C 02 20 00
+0B 07 0B 32 20 01 FF
+0B 02 31 37 30 00
+0C 02 34 30 00
+"""
+
+# What went out on the bus for it
+BUS = """\
+0B 02 31 31 30 00
+0B 06 00 00
+0B 02 20 00
+0C 02 20 00
+0A 02 37 37 31 34 34 32 35 37 00
+0C 02 31 35 30 00
+0A 02 20 00
+0A 02 42 41 4C 4C 20 31 00
+0B 02 42 41 4C 4C 20 31 00
+0D 02 42 41 4C 4C 20 33 00
+0C 02 38 30 00
+0A 09 05 01 34
+0D 02 31 34 30 00
+0B 02 20 00
+0A 02 31 34 30 00 NACK
+0B 02 35 30 00
+0B 02 42 41 4C 4C 20 32 00
+0C 02 20 00
+0B 09 05 01 30
+0B 02 34 30 00
+0B 07 0B 32 20 01 FF
+0B 02 31 37 30 00
+0C 02 34 30 00
+"""
+
+
+class DecoderTest(unittest.TestCase):
+
+    def run_decoder(self, bus, queued=None):
+        with tempfile.TemporaryDirectory() as tmp:
+            args = [sys.executable, DECODER, os.path.join(tmp, "bus.txt")]
+            with open(args[-1], "w") as f:
+                f.write(bus)
+            if queued is not None:
+                args += ["--queued", os.path.join(tmp, "queue.txt")]
+                with open(args[-1], "w") as f:
+                    f.write(queued)
+            result = subprocess.run(args, stdout=subprocess.PIPE, stderr=subprocess.PIPE, timeout=10)
+        return result.returncode, result.stdout.decode()
+
+    def test_capture_matches_queue(self):
+        code, out = self.run_decoder(BUS, QUEUED)
+        self.assertEqual(code, 0, out)
+        self.assertIn("[BALL 4]", out)
+        self.assertIn("[BALL 0]", out)
+        self.assertIn("0A shows ?", out)
+        self.assertIn("0B shows [170]", out)
+        self.assertIn("(14 saved on the bus), 0 mismatches", out)
+
+    def test_wrong_partial_write(self):
+        code, out = self.run_decoder(BUS.replace("0A 09 05 01 34", "0A 09 04 01 34"), QUEUED)
+        self.assertEqual(code, 1)
+        self.assertIn("display shows [BALL41], queued [BALL 4]", out)
+
+    def test_unchanged_text_sent_again(self):
+        code, out = self.run_decoder(BUS.replace("0C 02 34 30 00\n", "0C 02 20 00\n0C 02 34 30 00\n"), QUEUED)
+        self.assertEqual(code, 1)
+        self.assertIn("sent, but nothing was queued for it", out)
+
+    def test_partial_write_after_nack(self):
+        # The display may not have the text the partial write patches
+        code, out = self.run_decoder("0A 02 31 30 00 NACK\n0A 09 00 01 32\n")
+        self.assertEqual(code, 1)
+        self.assertIn("before the display's text is known", out)
+
+    def test_partial_write_past_the_text(self):
+        code, out = self.run_decoder("0A 02 31 30 00\n0A 09 01 02 32 33\n")
+        self.assertEqual(code, 1)
+        self.assertIn("runs past the 2-character text", out)
+
+    def test_partial_write_after_reinit(self):
+        code, out = self.run_decoder("0A 02 31 30 00\n0A 06 00 00\n0A 09 00 01 32\n")
+        self.assertEqual(code, 1)
+        self.assertIn("before the display's text is known", out)
+
+
+if __name__ == "__main__":
+    unittest.main()
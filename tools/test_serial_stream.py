@@ -0,0 +1,70 @@
+#!/usr/bin/env python3
+#
+# Decodes frames built the way SerialChannels.cpp builds them with
+# the shared decoder in serial_stream.py.
+#
+#   python3 tools/test_serial_stream.py
+
+import os
+import re
+import unittest
+
+from serial_stream import (CaptureError, StreamDecoder, CHANNEL_DEBUG_EVENT, DEBUG_EVENT_NAMES,
+                           describe_debug_event, parse_debug_event)
+
+SKETCH = os.path.join(os.path.dirname(os.path.dirname(os.path.abspath(__file__))), "LostWorld25.ino")
+
+
+def channel_frame(channel, payload):
+    # Same framing as Channel_WriteFrame()
+    body = [channel, len(payload)] + list(payload)
+    body.append((0x100 - sum(body)) & 0xFF)
+    frame = [0x7E]
+    for b in body:
+        if b in (0x7E, 0x7D, 0xF0):
+            frame += [0x7D, b ^ 0x20]
+        else:
+            frame.append(b)
+    return bytes(frame)
+
+
+def debug_event(event_id, timestamp, value):
+    # Same layout as Channel_DebugEvent()
+    value &= 0xFFFFFFFF
+    return ([event_id] + [(timestamp >> (8 * n)) & 0xFF for n in range(4)]
+            + [(value >> (8 * n)) & 0xFF for n in range(4)])
+
+
+class DebugEventTest(unittest.TestCase):
+
+    def test_known_record(self):
+        # DEBUG_EVENT_GAME_MODE at 0x7E7D F0 ms (every byte that
+        # needs escaping), value 3
+        stream = channel_frame(CHANNEL_DEBUG_EVENT, debug_event(8, 0x7E7DF0, 3))
+        events = StreamDecoder().feed(stream)
+        self.assertEqual(len(events), 1)
+        self.assertEqual(events[0][:2], ("channel", CHANNEL_DEBUG_EVENT))
+        event = parse_debug_event(events[0][2])
+        self.assertEqual(event, {"id": 8, "name": "game mode", "timestamp": 0x7E7DF0, "value": 3})
+        self.assertEqual(describe_debug_event(event), "@8289776 ms game mode 3")
+
+    def test_negative_value_and_unknown_id(self):
+        event = parse_debug_event(debug_event(200, 1234, -2))
+        self.assertEqual(event["value"], -2)
+        self.assertEqual(event["name"], "event 200")
+
+    def test_wrong_length(self):
+        with self.assertRaises(CaptureError):
+            parse_debug_event([8, 0, 0, 0, 0, 0, 0, 0])
+
+    def test_names_match_the_sketch(self):
+        with open(SKETCH) as f:
+            ids = dict((int(m.group(2)), m.group(1)) for m in
+                       re.finditer(r"^#define DEBUG_EVENT_(\w+)\s+(\d+)", f.read(), re.M))
+        self.assertEqual(sorted(ids), sorted(DEBUG_EVENT_NAMES))
+        for event_id, define in ids.items():
+            self.assertEqual(DEBUG_EVENT_NAMES[event_id], define.lower().replace("_", " ").replace("mpu", "MPU"))
+
+
+if __name__ == "__main__":
+    unittest.main()
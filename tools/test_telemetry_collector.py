@@ -0,0 +1,130 @@
+#!/usr/bin/env python3
+#
+# Drives telemetry_collector.py through local pipes the way a machine
+# would, with frames encoded independently of the collector's decoder.
+#
+#   python3 tools/test_telemetry_collector.py
+
+import json
+import os
+import subprocess
+import sys
+import tempfile
+import threading
+import unittest
+
+COLLECTOR = os.path.join(os.path.dirname(os.path.abspath(__file__)), "telemetry_collector.py")
+
+
+def channel_frame(channel, payload):
+    # Same framing as Channel_WriteFrame()
+    body = [channel, len(payload)] + list(payload)
+    body.append((0x100 - sum(body)) & 0xFF)
+    frame = [0x7E]
+    for b in body:
+        if b in (0x7E, 0x7D, 0xF0):
+            frame += [0x7D, b ^ 0x20]
+        else:
+            frame.append(b)
+    return bytes(frame)
+
+
+def record(event_type, detail, sequence, timestamp, value=0):
+    # Same layout as EncodeTelemetryRecord()
+    return ([event_type, detail, sequence & 0xFF, sequence >> 8]
+            + [(timestamp >> (8 * n)) & 0xFF for n in range(4)]
+            + [(value >> (8 * n)) & 0xFF for n in range(4)])
+
+
+def telemetry(*records):
+    payload = []
+    for r in records:
+        payload += r
+    return channel_frame(1, payload)
+
+
+class CollectorTest(unittest.TestCase):
+
+    def run_collector(self, args, stdin=None):
+        result = subprocess.run([sys.executable, COLLECTOR, "--json"] + args, input=stdin,
+                                stdout=subprocess.PIPE, stderr=subprocess.PIPE, timeout=10)
+        self.assertEqual(result.returncode, 0, result.stderr)
+        return json.loads(result.stdout.decode().strip().splitlines()[-1])
+
+    def test_stdin_pipe(self):
+        stream = b"".join([
+            telemetry(record(1, 12, 0, 1000), record(2, 12, 1, 1000, 500)),
+            # WAV Trigger command on the shared port
+            bytes([0xF0, 0xAA, 0x08, 0x03, 0x01, 0x7E, 0x00, 0x55]),
+            # Values that need escaping
+            telemetry(record(1, 0x7E, 2, 0x7D7E, 0), record(2, 0x7E, 3, 0x7D7E, 0xF0)),
+            telemetry(record(6, 1, 4, 2000), record(7, 2, 5, 2000, 2)),
+            # Sequence 6 and 7 never arrive; the machine reports one of them
+            telemetry(record(4, 0, 8, 3000, 1), record(0xFF, 0, 9, 3000, 1)),
+            telemetry(record(5, 0, 10, 3100, 2), record(8, 0, 11, 3200, 1)),
+            telemetry(record(3, 4, 12, 3300, 0)),
+        ])
+        # A frame with a bad checksum
+        bad = bytearray(telemetry(record(1, 1, 13, 3400)))
+        bad[-1] ^= 0x01
+        stats = self.run_collector(["-"], stream + bytes(bad))["stdin"]
+
+        self.assertEqual(stats["records"], 11)
+        self.assertEqual(stats["switch_hits"], {"12": 1, "126": 1})
+        self.assertEqual(stats["points"], 500 + 0xF0)
+        self.assertEqual(stats["points_by_switch"], {"12": 500, "126": 0xF0})
+        self.assertEqual(stats["coins"], {"1": 1})
+        self.assertEqual(stats["credits"], 2)
+        self.assertEqual(stats["drains"], 1)
+        self.assertEqual(stats["ball_saves"], 1)
+        self.assertEqual(stats["tilt_warnings"], 1)
+        self.assertEqual(stats["game_modes"], {"4": 1})
+        self.assertEqual(stats["missing"], 2)
+        self.assertEqual(stats["dropped_by_machine"], 1)
+        self.assertEqual(stats["lost_in_transit"], 1)
+        self.assertEqual(stats["bad_frames"], 1)
+        self.assertEqual(stats["uptime_ms"], 3300)
+
+    def test_restart_is_not_a_gap(self):
+        stream = telemetry(record(1, 3, 40, 90000)) + telemetry(record(1, 3, 0, 20))
+        stats = self.run_collector(["-"], stream)["stdin"]
+        self.assertEqual(stats["restarts"], 1)
+        self.assertEqual(stats["missing"], 0)
+        self.assertEqual(stats["switch_hits"], {"3": 2})
+
+    def test_named_pipes_per_machine(self):
+        with tempfile.TemporaryDirectory() as tmp:
+            left = os.path.join(tmp, "left")
+            right = os.path.join(tmp, "right")
+            os.mkfifo(left)
+            os.mkfifo(right)
+
+            def machine(path, frames):
+                with open(path, "wb") as f:
+                    for frame in frames:
+                        f.write(frame)
+                        f.flush()
+
+            collector = subprocess.Popen([sys.executable, COLLECTOR, "--json", "a=" + left, "b=" + right],
+                                         stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+            writers = [
+                threading.Thread(target=machine, args=(left, [telemetry(record(1, 5, n, 100 * n)) for n in range(3)])),
+                threading.Thread(target=machine, args=(right, [telemetry(record(6, 0, 0, 50), record(7, 1, 1, 50, 1))])),
+            ]
+            for writer in writers:
+                writer.start()
+            for writer in writers:
+                writer.join(10)
+            out, err = collector.communicate(timeout=10)
+            self.assertEqual(collector.returncode, 0, err)
+            stats = json.loads(out.decode().strip().splitlines()[-1])
+
+        self.assertEqual(stats["a"]["switch_hits"], {"5": 3})
+        self.assertEqual(stats["a"]["coins"], {})
+        self.assertEqual(stats["b"]["coins"], {"0": 1})
+        self.assertEqual(stats["b"]["credits"], 1)
+        self.assertEqual(stats["b"]["switch_hits"], {})
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,596 @@
+#!/usr/bin/env python3
+#
+# WAV Trigger stand-in
+#
+# Decodes the serial commands wavTrigger (AudioHandler.cpp) sends and
+# plays them against a model of the WAV Trigger's 14-voice mixer, so
+# audio behaviour can be checked without the board. It answers the
+# way the board does: a version string, system info, and a track
+# report whenever a voice starts or stops (once reporting is on).
+#
+# Live, on the port the board would be plugged into, or on a
+# pseudo-terminal for a host build of the sketch:
+#
+#   python3 tools/wavtrigger_standin.py --port /dev/ttyUSB0 --log run.txt
+#   python3 tools/wavtrigger_standin.py --pty
+#
+# Offline, from a capture (see serial_stream.py for the format; the
+# stand-in's own --log output is one):
+#
+#   python3 tools/wavtrigger_standin.py capture.txt
+#
+# --latency sets how long the board takes to act on a command, and
+# --lengths reads track lengths ("track ms" per line) so tracks end
+# and report when the real ones would. Debug and telemetry frames that
+# share the port on Rev 3 boards are skipped (--show-channels prints
+# them). Note that wavTrigger::update() ignores reports on Rev 3
+# boards, since Serial is shared. The exit code is 1 if any frame was
+# malformed.
+
+import argparse
+import os
+import select
+import sys
+import time
+
+from serial_stream import (BAUD_RATES, CaptureError, StreamDecoder, CHANNEL_DEBUG_EVENT, CHANNEL_DEBUG_TEXT,
+                           describe_debug_event, format_capture_line, parse_debug_event, read_capture, set_raw)
+
+CMD_GET_VERSION = 1
+CMD_GET_SYS_INFO = 2
+CMD_TRACK_CONTROL = 3
+CMD_STOP_ALL = 4
+CMD_MASTER_VOLUME = 5
+CMD_TRACK_VOLUME = 8
+CMD_AMP_POWER = 9
+CMD_TRACK_FADE = 10
+CMD_RESUME_ALL_SYNC = 11
+CMD_SAMPLERATE_OFFSET = 12
+CMD_TRACK_CONTROL_EX = 13
+CMD_SET_REPORTING = 14
+CMD_SET_TRIGGER_BANK = 15
+
+TRK_PLAY_SOLO = 0
+TRK_PLAY_POLY = 1
+TRK_PAUSE = 2
+TRK_RESUME = 3
+TRK_STOP = 4
+TRK_LOOP_ON = 5
+TRK_LOOP_OFF = 6
+TRK_LOAD = 7
+
+RSP_VERSION_STRING = 129
+RSP_SYSTEM_INFO = 130
+RSP_TRACK_REPORT = 132
+
+SOM1 = 0xF0
+SOM2 = 0xAA
+EOM = 0x55
+NUM_VOICES = 14
+VERSION_STRING_LEN = 20
+MIN_GAIN = -70
+MAX_GAIN = 10
+
+# Frame length for each command, as wavTrigger sends them
+COMMAND_LENGTHS = {
+    CMD_GET_VERSION: 5,
+    CMD_GET_SYS_INFO: 5,
+    CMD_TRACK_CONTROL: 8,
+    CMD_STOP_ALL: 5,
+    CMD_MASTER_VOLUME: 7,
+    CMD_TRACK_VOLUME: 9,
+    CMD_AMP_POWER: 6,
+    CMD_TRACK_FADE: 12,
+    CMD_RESUME_ALL_SYNC: 5,
+    CMD_SAMPLERATE_OFFSET: 7,
+    CMD_TRACK_CONTROL_EX: 9,
+    CMD_SET_REPORTING: 6,
+    CMD_SET_TRIGGER_BANK: 6,
+}
+
+COMMAND_NAMES = {
+    CMD_GET_VERSION: "GetVersion",
+    CMD_GET_SYS_INFO: "GetSysInfo",
+    CMD_TRACK_CONTROL: "TrackControl",
+    CMD_STOP_ALL: "StopAll",
+    CMD_MASTER_VOLUME: "MasterGain",
+    CMD_TRACK_VOLUME: "TrackGain",
+    CMD_AMP_POWER: "AmpPower",
+    CMD_TRACK_FADE: "TrackFade",
+    CMD_RESUME_ALL_SYNC: "ResumeAllInSync",
+    CMD_SAMPLERATE_OFFSET: "SamplerateOffset",
+    CMD_TRACK_CONTROL_EX: "TrackControlEx",
+    CMD_SET_REPORTING: "SetReporting",
+    CMD_SET_TRIGGER_BANK: "SetTriggerBank",
+}
+
+TRACK_CODE_NAMES = ["PlaySolo", "PlayPoly", "Pause", "Resume", "Stop", "LoopOn", "LoopOff", "Load"]
+
+
+class FrameError(Exception):
+    pass
+
+
+def signed16(lo, hi):
+    value = lo | (hi << 8)
+    return value - 0x10000 if value & 0x8000 else value
+
+
+def make_frame(payload):
+    return [SOM1, SOM2, len(payload) + 4] + list(payload) + [EOM]
+
+
+class Voice:
+    def __init__(self, track, start_time, locked):
+        self.track = track
+        self.start_time = start_time
+        self.locked = locked
+        self.looping = False
+        self.paused_at = None
+        self.played = 0.0
+        self.fade = None
+
+
+class Mixer:
+    def __init__(self, latency, lengths, default_length, version, num_tracks):
+        self.latency = latency
+        self.lengths = lengths
+        self.default_length = default_length
+        self.version = version
+        self.num_tracks = num_tracks
+        self.voices = [None] * NUM_VOICES
+        self.track_gains = {}
+        self.master_gain = 0
+        self.amp_on = True
+        self.reporting = False
+        self.samplerate_offset = 0
+        self.trigger_bank = 1
+        self.pending = []
+        self.replies = []
+        self.notes = []
+        self.now = 0.0
+
+    # ---- frames in --------------------------------------------------
+
+    def receive(self, frame, now):
+        # Commands are checked on arrival and carried
+        # out once the board's latency has passed
+        command = frame[3]
+        if command not in COMMAND_LENGTHS:
+            raise FrameError("unknown command %d" % command)
+        if frame[2] != COMMAND_LENGTHS[command]:
+            raise FrameError("%s frame is %d bytes, should be %d"
+                             % (COMMAND_NAMES[command], frame[2], COMMAND_LENGTHS[command]))
+        if command in (CMD_TRACK_CONTROL, CMD_TRACK_CONTROL_EX) and frame[4] >= len(TRACK_CODE_NAMES):
+            raise FrameError("unknown track control code %d" % frame[4])
+        self.pending.append((now + self.latency, command, frame[4:-1]))
+
+    # ---- time -------------------------------------------------------
+
+    def track_length(self, track):
+        return self.lengths.get(track, self.default_length)
+
+    def voice_end(self, voice):
+        # When this voice next needs attention: a fade
+        # finishing or the track running out
+        times = []
+        if voice.fade:
+            times.append(voice.fade["end"])
+        if voice.paused_at is None and not voice.looping:
+            times.append(voice.start_time + self.track_length(voice.track) - voice.played)
+        return min(times) if times else None
+
+    def advance(self, now):
+        # Runs every command and voice event that's due by now, in order
+        while True:
+            next_time = None
+            next_voice = None
+            for num, voice in enumerate(self.voices):
+                if voice:
+                    end = self.voice_end(voice)
+                    if end is not None and (next_time is None or end < next_time):
+                        next_time, next_voice = end, num
+            if self.pending and (next_time is None or self.pending[0][0] <= next_time):
+                next_time, next_voice = self.pending[0][0], None
+            if next_time is None or next_time > now:
+                break
+            self.now = next_time
+            if next_voice is None:
+                _, command, args = self.pending.pop(0)
+                self.execute(command, args)
+            else:
+                self.finish_voice(next_voice)
+        self.now = max(self.now, now)
+
+    def finish_voice(self, num):
+        voice = self.voices[num]
+        if voice.fade and voice.fade["end"] <= self.now:
+            self.set_gain(voice.track, voice.fade["target"])
+            stop = voice.fade["stop"]
+            voice.fade = None
+            if stop:
+                self.stop_voice(num, "faded out")
+            return
+        self.stop_voice(num, "ended")
+
+    # ---- voices -----------------------------------------------------
+
+    def report(self, num, track, playing):
+        if self.reporting:
+            # wavTrigger::update() adds one back to the track number
+            track -= 1
+            self.replies.append((self.now, make_frame([RSP_TRACK_REPORT, track & 0xFF, (track >> 8) & 0xFF,
+                                                       num, 1 if playing else 0])))
+
+    def start_voice(self, track, locked, paused):
+        free = [num for num, voice in enumerate(self.voices) if voice is None]
+        if free:
+            num = free[0]
+        else:
+            # Like the board, steal the oldest voice that isn't locked
+            unlocked = [num for num, voice in enumerate(self.voices) if not voice.locked]
+            if not unlocked:
+                self.notes.append("no free voice for track %d" % track)
+                return
+            num = min(unlocked, key=lambda n: self.voices[n].start_time)
+            self.stop_voice(num, "stolen")
+        voice = Voice(track, self.now, locked)
+        if paused:
+            voice.paused_at = self.now
+        self.voices[num] = voice
+        self.report(num, track, True)
+
+    def stop_voice(self, num, why):
+        track = self.voices[num].track
+        self.voices[num] = None
+        self.notes.append("voice %d track %d %s" % (num, track, why))
+        self.report(num, track, False)
+
+    def voices_playing(self, track):
+        return [num for num, voice in enumerate(self.voices) if voice and voice.track == track]
+
+    def pause_voice(self, voice):
+        if voice.paused_at is None:
+            voice.played += self.now - voice.start_time
+            voice.paused_at = self.now
+
+    def resume_voice(self, voice):
+        if voice.paused_at is not None:
+            voice.start_time = self.now
+            voice.paused_at = None
+
+    def gain(self, track):
+        # Current gain, following any fade in progress
+        for voice in self.voices:
+            if voice and voice.track == track and voice.fade:
+                fade = voice.fade
+                span = fade["end"] - fade["start"]
+                done = (self.now - fade["start"]) / span if span > 0 else 1.0
+                return fade["from"] + (fade["target"] - fade["from"]) * min(done, 1.0)
+        return self.track_gains.get(track, 0)
+
+    def set_gain(self, track, gain):
+        self.track_gains[track] = max(MIN_GAIN, min(MAX_GAIN, gain))
+
+    # ---- commands ---------------------------------------------------
+
+    def execute(self, command, args):
+        if command == CMD_GET_VERSION:
+            text = self.version.encode("ascii", "replace")[:VERSION_STRING_LEN].ljust(VERSION_STRING_LEN, b"\0")
+            self.replies.append((self.now, make_frame([RSP_VERSION_STRING] + list(text))))
+        elif command == CMD_GET_SYS_INFO:
+            self.replies.append((self.now, make_frame([RSP_SYSTEM_INFO, NUM_VOICES,
+                                                       self.num_tracks & 0xFF, self.num_tracks >> 8])))
+        elif command in (CMD_TRACK_CONTROL, CMD_TRACK_CONTROL_EX):
+            code = args[0]
+            track = args[1] | (args[2] << 8)
+            locked = command == CMD_TRACK_CONTROL_EX and args[3] != 0
+            self.track_control(code, track, locked)
+        elif command == CMD_STOP_ALL:
+            for num, voice in enumerate(self.voices):
+                if voice:
+                    self.stop_voice(num, "stopped")
+        elif command == CMD_MASTER_VOLUME:
+            self.master_gain = signed16(args[0], args[1])
+        elif command == CMD_TRACK_VOLUME:
+            track = args[0] | (args[1] << 8)
+            self.set_gain(track, signed16(args[2], args[3]))
+            for num in self.voices_playing(track):
+                self.voices[num].fade = None
+        elif command == CMD_TRACK_FADE:
+            track = args[0] | (args[1] << 8)
+            target = max(MIN_GAIN, min(MAX_GAIN, signed16(args[2], args[3])))
+            duration = args[4] | (args[5] << 8)
+            stop = args[6] != 0
+            playing = self.voices_playing(track)
+            if not playing:
+                self.notes.append("fade of track %d, which isn't playing" % track)
+            start_gain = self.gain(track)
+            for num in playing:
+                self.voices[num].fade = {"from": start_gain, "target": target, "start": self.now,
+                                         "end": self.now + duration, "stop": stop}
+        elif command == CMD_AMP_POWER:
+            self.amp_on = args[0] != 0
+        elif command == CMD_RESUME_ALL_SYNC:
+            for voice in self.voices:
+                if voice:
+                    self.resume_voice(voice)
+        elif command == CMD_SAMPLERATE_OFFSET:
+            self.samplerate_offset = signed16(args[0], args[1])
+        elif command == CMD_SET_REPORTING:
+            self.reporting = args[0] != 0
+        elif command == CMD_SET_TRIGGER_BANK:
+            self.trigger_bank = args[0]
+
+    def track_control(self, code, track, locked):
+        if code == TRK_PLAY_SOLO:
+            for num, voice in enumerate(self.voices):
+                if voice and not voice.locked:
+                    self.stop_voice(num, "stopped by solo track %d" % track)
+            self.start_voice(track, locked, False)
+        elif code == TRK_PLAY_POLY:
+            self.start_voice(track, locked, False)
+        elif code == TRK_LOAD:
+            self.start_voice(track, locked, True)
+        else:
+            playing = self.voices_playing(track)
+            if not playing:
+                self.notes.append("%s of track %d, which isn't playing" % (TRACK_CODE_NAMES[code], track))
+            for num in playing:
+                voice = self.voices[num]
+                if code == TRK_PAUSE:
+                    self.pause_voice(voice)
+                elif code == TRK_RESUME:
+                    self.resume_voice(voice)
+                elif code == TRK_STOP:
+                    self.stop_voice(num, "stopped")
+                elif code == TRK_LOOP_ON:
+                    voice.looping = True
+                elif code == TRK_LOOP_OFF:
+                    # The track runs out at the end of the pass it's on
+                    if voice.looping:
+                        voice.looping = False
+                        length = self.track_length(track)
+                        if voice.paused_at is None:
+                            voice.played += self.now - voice.start_time
+                            voice.start_time = self.now
+                        voice.played = voice.played % length if length else 0
+
+    # ---- output -----------------------------------------------------
+
+    def take_replies(self):
+        replies, self.replies = self.replies, []
+        return replies
+
+    def take_notes(self):
+        notes, self.notes = self.notes, []
+        return notes
+
+    def describe(self):
+        voices = []
+        for num, voice in enumerate(self.voices):
+            if voice:
+                flags = ""
+                if voice.looping:
+                    flags += "L"
+                if voice.paused_at is not None:
+                    flags += "P"
+                if voice.locked:
+                    flags += "K"
+                if voice.fade:
+                    flags += "F"
+                voices.append("%d:%d%s(%+.0fdB)" % (num, voice.track, "/" + flags if flags else "",
+                                                     self.gain(voice.track)))
+        text = "master %+ddB  %d/%d voices" % (self.master_gain, len(voices), NUM_VOICES)
+        if voices:
+            text += "  " + " ".join(voices)
+        if not self.amp_on:
+            text += "  amp off"
+        return text
+
+
+def describe_command(frame):
+    command = frame[3]
+    args = frame[4:-1]
+    name = COMMAND_NAMES.get(command, str(command))
+    if command in (CMD_TRACK_CONTROL, CMD_TRACK_CONTROL_EX):
+        text = "%s track %d" % (TRACK_CODE_NAMES[args[0]], args[1] | (args[2] << 8))
+        if command == CMD_TRACK_CONTROL_EX and args[3]:
+            text += " (locked)"
+        return text
+    if command == CMD_TRACK_VOLUME:
+        return "%s track %d %+ddB" % (name, args[0] | (args[1] << 8), signed16(args[2], args[3]))
+    if command == CMD_TRACK_FADE:
+        return "%s track %d to %+ddB over %d ms%s" % (name, args[0] | (args[1] << 8), signed16(args[2], args[3]),
+                                                      args[4] | (args[5] << 8), ", then stop" if args[6] else "")
+    if command in (CMD_MASTER_VOLUME, CMD_SAMPLERATE_OFFSET):
+        return "%s %+d" % (name, signed16(args[0], args[1]))
+    if args:
+        return "%s %s" % (name, " ".join("%02X" % a for a in args))
+    return name
+
+
+def describe_reply(frame):
+    if frame[3] == RSP_TRACK_REPORT:
+        return "TrackReport voice %d track %d %s" % (frame[6], (frame[4] | (frame[5] << 8)) + 1,
+                                                     "on" if frame[7] else "off")
+    if frame[3] == RSP_VERSION_STRING:
+        return "VersionString '%s'" % bytes(frame[4:-1]).rstrip(b"\0").decode("ascii", "replace")
+    if frame[3] == RSP_SYSTEM_INFO:
+        return "SystemInfo %d voices, %d tracks" % (frame[4], frame[5] | (frame[6] << 8))
+    return "reply %02X" % frame[3]
+
+
+def read_lengths(path):
+    lengths = {}
+    with open(path) as f:
+        for line_num, line in enumerate(f, 1):
+            line = line.split("#", 1)[0].strip()
+            if not line:
+                continue
+            fields = line.replace("=", " ").split()
+            if len(fields) != 2 or not fields[0].isdigit() or not fields[1].isdigit():
+                raise CaptureError("%s:%d: expected 'track ms'" % (path, line_num))
+            lengths[int(fields[0])] = int(fields[1])
+    return lengths
+
+
+class StandIn:
+    def __init__(self, mixer, show_channels, log):
+        self.mixer = mixer
+        self.decoder = StreamDecoder()
+        self.show_channels = show_channels
+        self.log = log
+        self.num_frames = 0
+        self.num_errors = 0
+        self.text = ""
+
+    def print_notes(self):
+        for note in self.mixer.take_notes():
+            print("         %s" % note)
+
+    def feed(self, now, data, where):
+        if self.log:
+            self.log.write(format_capture_line(now, "<", data) + "\n")
+        for event in self.decoder.feed(data):
+            if event[0] == "error":
+                print("%s: bad frame: %s" % (where, event[1]))
+                self.num_errors += 1
+            elif event[0] == "channel":
+                self.show_channel(event[1], event[2], where)
+            else:
+                self.num_frames += 1
+                self.mixer.advance(now)
+                self.print_notes()
+                try:
+                    self.mixer.receive(event[1], now)
+                    print("%s: %s" % (where, describe_command(event[1])))
+                except FrameError as e:
+                    print("%s: bad frame: %s" % (where, e))
+                    self.num_errors += 1
+                    continue
+                self.mixer.advance(now)
+                self.print_notes()
+                print("         %s" % self.mixer.describe())
+
+    def show_channel(self, channel, payload, where):
+        if not self.show_channels:
+            return
+        if channel == CHANNEL_DEBUG_TEXT:
+            # Long strings come in pieces - print whole lines
+            self.text += bytes(payload).decode("ascii", "replace")
+            while "\n" in self.text:
+                line, self.text = self.text.split("\n", 1)
+                print("%s: [debug] %s" % (where, line))
+        elif channel == CHANNEL_DEBUG_EVENT:
+            try:
+                print("%s: [event] %s" % (where, describe_debug_event(parse_debug_event(payload))))
+            except CaptureError as e:
+                print("%s: bad frame: %s" % (where, e))
+                self.num_errors += 1
+        else:
+            print("%s: [channel %d] %s" % (where, channel, " ".join("%02X" % b for b in payload)))
+
+    def replies(self):
+        replies = self.mixer.take_replies()
+        for stamp, frame in replies:
+            print("@%.1f: > %s" % (stamp, describe_reply(frame)))
+            if self.log:
+                self.log.write(format_capture_line(stamp, ">", frame) + "\n")
+        return replies
+
+
+def run_live(stand_in, fd):
+    start = time.monotonic()
+    while True:
+        now = (time.monotonic() - start) * 1000.0
+        readable, _, _ = select.select([fd], [], [], 0.005)
+        if readable:
+            try:
+                data = os.read(fd, 256)
+            except OSError:
+                # A pty reads as an error once the other end closes
+                data = b""
+            if not data:
+                break
+            stand_in.feed(now, list(data), "@%.1f" % now)
+        stand_in.mixer.advance(now)
+        stand_in.print_notes()
+        for _, frame in stand_in.replies():
+            os.write(fd, bytes(frame))
+        sys.stdout.flush()
+
+
+def run_capture(stand_in, source, step):
+    now = 0.0
+    for line_num, stamp, direction, data in read_capture(source):
+        if direction != "<":
+            continue
+        now = stamp if stamp is not None else now + step
+        stand_in.mixer.advance(now)
+        stand_in.print_notes()
+        stand_in.replies()
+        stand_in.feed(now, data, "line %d" % line_num)
+        stand_in.replies()
+
+    # Let the last commands take effect
+    stand_in.mixer.advance(now + stand_in.mixer.latency)
+    stand_in.print_notes()
+    stand_in.replies()
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Stand in for a WAV Trigger on a serial port or from a capture")
+    parser.add_argument("capture", nargs="?", help="capture to play back (default: stdin)")
+    parser.add_argument("--port", help="serial port to answer on")
+    parser.add_argument("--pty", action="store_true", help="answer on a new pseudo-terminal")
+    parser.add_argument("--baud", type=int, default=57600, choices=sorted(BAUD_RATES), help="default: 57600")
+    parser.add_argument("--log", help="write everything sent and received to a capture file")
+    parser.add_argument("--latency", type=float, default=0.0, metavar="MS",
+                        help="time the board takes to act on a command (default: 0)")
+    parser.add_argument("--lengths", metavar="FILE", help="track lengths, 'track ms' per line")
+    parser.add_argument("--default-length", type=int, default=2000, metavar="MS",
+                        help="length of tracks not in --lengths (default: 2000)")
+    parser.add_argument("--version-string", default="WAV Trigger v1.34", help="reply to GetVersion")
+    parser.add_argument("--num-tracks", type=int, default=4096, help="track count in the system info reply")
+    parser.add_argument("--step", type=float, default=0.0, metavar="MS",
+                        help="time between capture lines that have no timestamp (default: 0)")
+    parser.add_argument("--show-channels", action="store_true", help="print debug and telemetry frames")
+    args = parser.parse_args()
+
+    log = None
+    try:
+        lengths = read_lengths(args.lengths) if args.lengths else {}
+        mixer = Mixer(args.latency, lengths, args.default_length, args.version_string, args.num_tracks)
+        log = open(args.log, "w") if args.log else None
+        stand_in = StandIn(mixer, args.show_channels, log)
+
+        if args.port or args.pty:
+            if args.pty:
+                fd, slave = os.openpty()
+                set_raw(slave, args.baud)
+                print("WAV Trigger stand-in on %s" % os.ttyname(slave))
+            else:
+                fd = os.open(args.port, os.O_RDWR | os.O_NOCTTY)
+                set_raw(fd, args.baud)
+            try:
+                run_live(stand_in, fd)
+            except KeyboardInterrupt:
+                pass
+        else:
+            source = open(args.capture) if args.capture else sys.stdin
+            run_capture(stand_in, source, args.step)
+    except (CaptureError, IOError, OSError) as e:
+        sys.stderr.write("wavtrigger_standin: %s\n" % e)
+        return 1
+    finally:
+        if log:
+            log.close()
+
+    print("%d frames, %d bad, %d stray bytes" % (stand_in.num_frames, stand_in.num_errors,
+                                                 stand_in.decoder.stray))
+    return 1 if stand_in.num_errors else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())